@@ -0,0 +1,498 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * Benchmark of class file parsing, member formatting and panel list
+ * construction on synthetic worst-case class files (Linux). Cases
+ * utf8_ascii and utf8_mixed measure constant pool string decoding.
+ *
+ * Every stage prints one JSON object per line:
+ *   {"case":..., "stage":..., "iterations":..., "seconds":..., "mb_per_s":...,
+ *    "items_per_s":..., "allocs":..., "alloc_bytes":..., "peak_bytes":...}
+ * mb_per_s is class data for parsing and produced text for formatting,
+ * allocs, alloc_bytes and peak_bytes are per iteration (peak_bytes is the
+ * maximum of usable heap block bytes held by the stage at once). The last line
+ * reports process peak RSS.
+ *
+ * Case jar indexes a generated jar of typical classes with jindex::build
+ * for every number of worker threads from 1 to the -j value ("threads"
+ * field of the result). Stage jindex.load reads the saved index from the
+ * cache file, jindex.update is load followed by build with the loaded
+ * index as cache (unchanged jar opened again).
+ *
+ * Usage: jbench [-c case] [-t seconds] [-j threads] [-o corpus_dir]
+ *   -c  run the specified case only
+ *   -t  minimal measuring time of each stage (default 0.5)
+ *   -j  maximal number of index threads (default all hardware threads)
+ *   -o  write generated class files into directory and exit
+ */
+
+#include "jgen.h"
+#include "jtformat.h"
+#include "jutf8.h"
+#include "jindex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+#include <malloc.h>
+#include <sys/resource.h>
+
+
+//! Heap usage counters (operator new is replaced to maintain them, index stages allocate from worker threads)
+static atomic<size_t> heap_allocs(0);
+static atomic<size_t> heap_bytes(0);
+static atomic<size_t> heap_live(0);
+static atomic<size_t> heap_peak(0);
+
+//! Results of measured code are stored here to keep them alive
+static volatile size_t bench_sink = 0;
+
+/**
+ * Allocate heap block and update counters.
+ * Live bytes are counted by usable block size (malloc_usable_size), no header is
+ * placed before the block, so allocation and release stay plain malloc and free.
+ * \param size requested size
+ * \return allocated block (nullptr if out of memory)
+ */
+static void* heap_alloc(const size_t size) noexcept
+{
+	void* block = malloc(size ? size : 1);
+	if (!block)
+		return nullptr;
+	heap_allocs.fetch_add(1, memory_order_relaxed);
+	heap_bytes.fetch_add(size, memory_order_relaxed);
+	const size_t usable = malloc_usable_size(block);
+	const size_t live = heap_live.fetch_add(usable, memory_order_relaxed) + usable;
+	size_t peak = heap_peak.load(memory_order_relaxed);
+	while (live > peak && !heap_peak.compare_exchange_weak(peak, live, memory_order_relaxed))
+		;
+	return block;
+}
+
+/**
+ * Release heap block and update counters.
+ * \param block block allocated by heap_alloc (may be nullptr)
+ */
+static void heap_free(void* block) noexcept
+{
+	if (!block)
+		return;
+	heap_live.fetch_sub(malloc_usable_size(block), memory_order_relaxed);
+	free(block);
+}
+
+void* operator new(size_t size)
+{
+	void* block = heap_alloc(size);
+	if (!block)
+		throw bad_alloc();
+	return block;
+}
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+	return heap_alloc(size);
+}
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+	return heap_alloc(size);
+}
+void operator delete(void* ptr) noexcept
+{
+	heap_free(ptr);
+}
+void operator delete[](void* ptr) noexcept
+{
+	heap_free(ptr);
+}
+void operator delete(void* ptr, const nothrow_t&) noexcept
+{
+	heap_free(ptr);
+}
+void operator delete[](void* ptr, const nothrow_t&) noexcept
+{
+	heap_free(ptr);
+}
+#if __cpp_sized_deallocation
+void operator delete(void* ptr, size_t) noexcept
+{
+	heap_free(ptr);
+}
+void operator delete[](void* ptr, size_t) noexcept
+{
+	heap_free(ptr);
+}
+#endif
+
+
+//! Stage measurement result
+struct bench_result {
+	size_t iterations;	///< Number of runs
+	double seconds;		///< Total time
+	size_t items;		///< Items processed per run
+	size_t allocs;		///< Allocations per run
+	size_t alloc_bytes;	///< Allocated bytes per run
+	size_t peak_bytes;	///< Peak of bytes allocated by run
+};
+
+
+/**
+ * Run stage repeatedly for at least specified time.
+ * \param min_time minimal total time in seconds
+ * \param stage stage function, returns number of processed items
+ * \return measurement result
+ */
+static bench_result measure(const double min_time, const function<size_t()>& stage)
+{
+	typedef chrono::steady_clock clock;
+
+	bench_result rc;
+	memset(&rc, 0, sizeof(rc));
+
+	const size_t allocs = heap_allocs;
+	const size_t bytes = heap_bytes;
+	heap_peak = heap_live.load();
+	const size_t live = heap_live;
+
+	const clock::time_point start = clock::now();
+	do {
+		rc.items = stage();
+		++rc.iterations;
+		rc.seconds = chrono::duration<double>(clock::now() - start).count();
+	}
+	while (rc.seconds < min_time);
+
+	rc.allocs = (heap_allocs - allocs) / rc.iterations;
+	rc.alloc_bytes = (heap_bytes - bytes) / rc.iterations;
+	rc.peak_bytes = heap_peak - live;
+	return rc;
+}
+
+
+/**
+ * Print stage result as JSON line.
+ * \param bc bench case
+ * \param stage stage name
+ * \param rc measurement result
+ * \param bytes data size processed by one run
+ * \param threads number of worker threads
+ */
+static void report(const bench_case& bc, const char* stage, const bench_result& rc, const size_t bytes, const size_t threads = 1)
+{
+	const double per_run = rc.seconds / rc.iterations;
+	printf("{\"case\":\"%s\",\"stage\":\"%s\",\"class_bytes\":%zu,\"threads\":%zu,\"iterations\":%zu,\"seconds\":%.6f,"
+		"\"mb_per_s\":%.2f,\"items_per_s\":%.0f,\"allocs\":%zu,\"alloc_bytes\":%zu,\"peak_bytes\":%zu}\n",
+		bc.name, stage, bc.data.size(), threads, rc.iterations, rc.seconds,
+		bytes / per_run / (1 << 20), rc.items / per_run, rc.allocs, rc.alloc_bytes, rc.peak_bytes);
+	fflush(stdout);
+}
+
+
+/**
+ * Run all stages for class.
+ * \param bc bench case
+ * \param min_time minimal measuring time of each stage
+ * \return false if class can not be read
+ */
+static bool run_case(const bench_case& bc, const double min_time)
+{
+	jclass::jclassinfo info;
+	vector<jclass::jmember> members;
+
+	//Parsing with member descriptions as panel gets them
+	const bench_result read_rc = measure(min_time, [&bc, &info, &members]() {
+		jclass cls;
+		members.clear();
+		if (!cls.read(&bc.data.front(), bc.data.size(), info, members))
+			throw exception();
+		return members.size();
+	});
+	report(bc, "jclass.read", read_rc, bc.data.size());
+
+	//Parsing into member tables only (search and other bulk consumers)
+	jclass parsed;
+	const bench_result table_rc = measure(min_time, [&bc, &info, &parsed]() {
+		if (!parsed.read(&bc.data.front(), bc.data.size(), info))
+			throw exception();
+		return parsed.methods().size() + parsed.fields().size();
+	});
+	report(bc, "jclass.read_table", table_rc, bc.data.size());
+
+	//Member storage layout: the former map of structures keyed by member number against structure of arrays
+	const jclass::jmember_table* tables[] = { &parsed.methods(), &parsed.fields() };
+	struct map_member {
+		uint16_t access_flag;
+		uint16_t name_index;
+		uint16_t descriptor_index;
+	};
+	const bench_result map_rc = measure(min_time, [&tables]() {
+		size_t sum = 0, items = 0;
+		for (size_t t = 0; t < 2; ++t) {
+			map<uint16_t, map_member> members;
+			for (size_t i = 0; i < tables[t]->size(); ++i) {
+				const map_member m = { tables[t]->access_flags[i], tables[t]->name_index[i], tables[t]->descriptor_index[i] };
+				members.insert(make_pair(static_cast<uint16_t>(i), m));
+			}
+			for (map<uint16_t, map_member>::const_iterator it = members.begin(); it != members.end(); ++it)
+				sum += it->second.access_flag + it->second.name_index + it->second.descriptor_index;
+			items += members.size();
+		}
+		bench_sink = sum;
+		return items;
+	});
+	report(bc, "members.map", map_rc, 0);
+	const bench_result soa_rc = measure(min_time, [&tables]() {
+		size_t sum = 0, items = 0;
+		for (size_t t = 0; t < 2; ++t) {
+			jclass::jmember_table members;
+			const size_t count = tables[t]->size();
+			members.resize(count);
+			for (size_t i = 0; i < count; ++i) {
+				members.access_flags[i] = tables[t]->access_flags[i];
+				members.name_index[i] = tables[t]->name_index[i];
+				members.descriptor_index[i] = tables[t]->descriptor_index[i];
+			}
+			for (size_t i = 0; i < count; ++i)
+				sum += members.access_flags[i] + members.name_index[i] + members.descriptor_index[i];
+			items += count;
+		}
+		bench_sink = sum;
+		return items;
+	});
+	report(bc, "members.soa", soa_rc, 0);
+
+	jtformat jfmt;
+	jfmt.set_short_type(true);
+	jfmt.set_jo_view(true);
+	jfmt.set_access(true);
+
+	//Member text as returned to callers
+	const bench_result fmt_rc = measure(min_time, [&jfmt, &members]() {
+		size_t len = 0;
+		for (size_t i = 0; i < members.size(); ++i)
+			len += jfmt.format(members[i]).length();
+		bench_sink = len;
+		return members.size();
+	});
+	report(bc, "jtformat.format", fmt_rc, bench_sink * sizeof(wchar_t));
+
+	//The same work as panel::get_panel_list: text size pass and one block with all item strings
+	const bench_result list_rc = measure(min_time, [&jfmt, &members]() {
+		size_t text_size = 0;
+		for (size_t i = 0; i < members.size(); ++i)
+			text_size += jfmt.format(members[i], nullptr) + members[i].name.length() + members[i].description.length() + 3;
+		wchar_t* block = new wchar_t[text_size + 1];
+		wchar_t* text = block;
+		for (size_t i = 0; i < members.size(); ++i) {
+			text += jfmt.format(members[i], text) + 1;
+			wmemcpy(text, members[i].name.c_str(), members[i].name.length() + 1);
+			text += members[i].name.length() + 1;
+			wmemcpy(text, members[i].description.c_str(), members[i].description.length() + 1);
+			text += members[i].description.length() + 1;
+		}
+		bench_sink = text - block;
+		delete[] block;
+		return members.size();
+	});
+	report(bc, "panel.list", list_rc, bench_sink * sizeof(wchar_t));
+
+	return true;
+}
+
+
+/**
+ * Measure modified UTF-8 decoding of constant pool strings.
+ * \param name case name
+ * \param strings encoded strings
+ * \param min_time minimal measuring time
+ */
+static void run_utf8(const char* name, const vector<string>& strings, const double min_time)
+{
+	bench_case bc = { name, vector<unsigned char>() };
+	for (size_t i = 0; i < strings.size(); ++i)
+		bc.data.insert(bc.data.end(), strings[i].begin(), strings[i].end());
+
+	wstring out;
+	const bench_result rc = measure(min_time, [&strings, &out]() {
+		size_t len = 0;
+		for (size_t i = 0; i < strings.size(); ++i) {
+			jutf8::decode(reinterpret_cast<const unsigned char*>(strings[i].c_str()), strings[i].length(), out);
+			len += out.length();
+		}
+		bench_sink = len;
+		return strings.size();
+	});
+	report(bc, "jutf8.decode", rc, bc.data.size());
+}
+
+
+/**
+ * Measure index build of generated jar with different numbers of threads
+ * and index load from cache file.
+ * \param min_time minimal measuring time
+ * \param max_threads maximal number of worker threads
+ * \return false if jar can not be indexed
+ */
+static bool run_index(const double min_time, const size_t max_threads)
+{
+	const bench_case bc = { "jar", gen_jar(4000, false) };
+	jzip archive;
+	if (!archive.open(&bc.data.front(), bc.data.size()))
+		return false;
+
+	//Inflated class data is the processed volume
+	size_t class_bytes = 0;
+	for (size_t i = 0; i < archive.entries().size(); ++i) {
+		if (jindex::is_class_entry(archive.entries()[i]))
+			class_bytes += static_cast<size_t>(archive.entries()[i].size);
+	}
+
+	for (size_t threads = 1; threads <= max_threads; ++threads) {
+		bool valid = true;
+		const bench_result rc = measure(min_time, [&archive, threads, &valid]() {
+			jindex index;
+			if (index.build(archive, nullptr, threads) != 0)
+				valid = false;
+			return index.classes().size();
+		});
+		if (!valid)
+			return false;
+		report(bc, "jindex.build", rc, class_bytes, threads);
+	}
+
+	char cache_name[] = "/tmp/jbench_index_XXXXXX";
+	const int fd = mkstemp(cache_name);
+	if (fd < 0)
+		return false;
+	close(fd);
+	jindex saved;
+	saved.build(archive, nullptr, 1);
+	bool valid = saved.save(cache_name);
+
+	const bench_result load_rc = measure(min_time, [&cache_name, &valid]() {
+		jindex index;
+		if (!index.load(cache_name))
+			valid = false;
+		return index.classes().size();
+	});
+	if (valid)
+		report(bc, "jindex.load", load_rc, class_bytes);
+
+	const bench_result update_rc = measure(min_time, [&archive, &cache_name, &valid]() {
+		jindex cached;
+		jindex index;
+		if (!cached.load(cache_name) || index.build(archive, &cached, 1) != 0 || index.parsed() != 0)
+			valid = false;
+		return index.classes().size();
+	});
+	if (valid)
+		report(bc, "jindex.update", update_rc, class_bytes);
+
+	unlink(cache_name);
+	return valid;
+}
+
+
+int main(int argc, char* argv[])
+{
+	const char* only_case = nullptr;
+	const char* corpus_dir = nullptr;
+	double min_time = 0.5;
+	size_t max_threads = thread::hardware_concurrency();
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+			only_case = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			min_time = atof(argv[++i]);
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			max_threads = strtoul(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			corpus_dir = argv[++i];
+		else {
+			fprintf(stderr, "Usage: %s [-c case] [-t seconds] [-j threads] [-o corpus_dir]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	typedef bench_case (*generator)();
+	const generator generators[] = { gen_pool_max, gen_wide_pairs, gen_members, gen_deep_arrays, gen_large_attrs };
+
+	int rc = 0;
+	for (size_t i = 0; i < sizeof(generators) / sizeof(generators[0]); ++i) {
+		const bench_case bc = generators[i]();
+		if (only_case && strcmp(only_case, bc.name) != 0)
+			continue;
+
+		if (corpus_dir) {
+			const string file_name = string(corpus_dir) + '/' + bc.name + ".class";
+			FILE* f = fopen(file_name.c_str(), "wb");
+			if (!f || fwrite(&bc.data.front(), 1, bc.data.size(), f) != bc.data.size()) {
+				fprintf(stderr, "Unable to write %s\n", file_name.c_str());
+				rc = 1;
+			}
+			if (f)
+				fclose(f);
+			continue;
+		}
+
+		try {
+			run_case(bc, min_time);
+		}
+		catch (exception&) {
+			fprintf(stderr, "Unable to read class of case %s\n", bc.name);
+			rc = 1;
+		}
+	}
+
+	if (!corpus_dir) {
+		//Names and descriptors as in real classes (ASCII) and localized names with supplementary characters
+		vector<string> ascii, mixed;
+		for (size_t i = 0; i < 20000; ++i) {
+			ascii.push_back(descriptors[i % DESCRIPTORS_COUNT]);
+			ascii.push_back("method" + to_string(i));
+			string enc;
+			jutf8::encode(L"\u0438\u043c\u044f" + to_wstring(i) + L"\u20ac" + wstring(1, static_cast<wchar_t>(0x1f600)) + L"_value", enc);
+			mixed.push_back(enc);
+		}
+		if (!only_case || strcmp(only_case, "utf8_ascii") == 0)
+			run_utf8("utf8_ascii", ascii, min_time);
+		if (!only_case || strcmp(only_case, "utf8_mixed") == 0)
+			run_utf8("utf8_mixed", mixed, min_time);
+
+		if ((!only_case || strcmp(only_case, "jar") == 0) && !run_index(min_time, max_threads ? max_threads : 1)) {
+			fprintf(stderr, "Unable to index case jar\n");
+			rc = 1;
+		}
+
+		rusage ru;
+		getrusage(RUSAGE_SELF, &ru);
+		printf("{\"peak_rss_kb\":%ld}\n", ru.ru_maxrss);
+	}
+
+	return rc;
+}
@@ -0,0 +1,232 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * Stub decompiler host for jdhost tests (Windows).
+ *
+ * Speaks the JDHost.java framed protocol over stdin/stdout without Java
+ * and decompilers. Request strings are checked to be well formed
+ * DataOutput.writeUTF data (status 2 otherwise), known tools get status 0.
+ * Misbehavior is selected by JDHOST_STUB_MODE environment variable:
+ *   ok        responses are written at once
+ *   split     every response byte is written separately with delays
+ *   oversize  response length prefix is 0x7fffffff
+ *   badutf    response message length exceeds the payload
+ *   crash     half of the second response is written, then process exits;
+ *             only the first started process crashes (JDHOST_STUB_MARKER file)
+ *   hang      requests are never answered
+ *   noready   process exits without ready response
+ * Command line arguments (class path and script name for Java) are ignored.
+ */
+
+#include <windows.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+using namespace std;
+
+//! Maximal accepted request size
+#define STUB_MAX_REQUEST	0x100000
+
+
+//! Standard handles
+static HANDLE stub_in = nullptr;
+static HANDLE stub_out = nullptr;
+
+
+/**
+ * Read exactly size bytes from stdin.
+ * \param buf output buffer
+ * \param size number of bytes
+ * \return false if stdin is closed
+ */
+static bool read_all(void* buf, size_t size)
+{
+	unsigned char* ptr = static_cast<unsigned char*>(buf);
+	while (size) {
+		DWORD rd = 0;
+		if (!ReadFile(stub_in, ptr, static_cast<DWORD>(size), &rd, nullptr) || !rd)
+			return false;
+		ptr += rd;
+		size -= rd;
+	}
+	return true;
+}
+
+
+/**
+ * Write data to stdout.
+ * \param data data to write
+ * \param split write every byte separately (reader gets partial frames)
+ */
+static void write_all(const string& data, const bool split)
+{
+	DWORD wr = 0;
+	if (!split) {
+		WriteFile(stub_out, data.data(), static_cast<DWORD>(data.size()), &wr, nullptr);
+		return;
+	}
+	for (size_t i = 0; i < data.size(); ++i) {
+		WriteFile(stub_out, data.data() + i, 1, &wr, nullptr);
+		Sleep(2);
+	}
+}
+
+
+/**
+ * Append big endian number.
+ * \param out output buffer
+ * \param v value
+ * \param len value size in bytes
+ */
+static void put_be(string& out, const uint32_t v, const size_t len)
+{
+	for (size_t i = 0; i < len; ++i)
+		out += static_cast<char>(v >> (8 * (len - 1 - i)));
+}
+
+
+/**
+ * Build response frame.
+ * \param status response status
+ * \param msg message (ASCII)
+ * \param bad_utf write message length that exceeds the payload
+ * \return frame
+ */
+static string response(const unsigned char status, const string& msg, const bool bad_utf)
+{
+	string payload(1, static_cast<char>(status));
+	put_be(payload, static_cast<uint32_t>(msg.length() + (bad_utf ? 1000 : 0)), 2);
+	payload += msg;
+	string frame;
+	put_be(frame, static_cast<uint32_t>(payload.length()), 4);
+	return frame + payload;
+}
+
+
+/**
+ * Read string in DataInput.readUTF format and check modified UTF-8 encoding.
+ * \param data request payload
+ * \param pos current position
+ * \param val output string (encoded)
+ * \return false if string is malformed
+ */
+static bool read_utf(const string& data, size_t& pos, string& val)
+{
+	if (pos + 2 > data.size())
+		return false;
+	const size_t len = (static_cast<unsigned char>(data[pos]) << 8) | static_cast<unsigned char>(data[pos + 1]);
+	pos += 2;
+	if (len > data.size() - pos)
+		return false;
+	val = data.substr(pos, len);
+	pos += len;
+
+	//No raw NUL and no four bytes sequences (supplementary characters are surrogate pairs)
+	for (size_t i = 0; i < val.size();) {
+		const unsigned char c = static_cast<unsigned char>(val[i]);
+		size_t cont;
+		if (c == 0)
+			return false;
+		else if (c < 0x80)
+			cont = 0;
+		else if ((c & 0xe0) == 0xc0)
+			cont = 1;
+		else if ((c & 0xf0) == 0xe0)
+			cont = 2;
+		else
+			return false;
+		if (cont > val.size() - i - 1)
+			return false;
+		for (size_t j = 1; j <= cont; ++j) {
+			if ((static_cast<unsigned char>(val[i + j]) & 0xc0) != 0x80)
+				return false;
+		}
+		i += cont + 1;
+	}
+	return true;
+}
+
+
+int main()
+{
+	stub_in = GetStdHandle(STD_INPUT_HANDLE);
+	stub_out = GetStdHandle(STD_OUTPUT_HANDLE);
+
+	const char* env_mode = getenv("JDHOST_STUB_MODE");
+	const string mode = env_mode ? env_mode : "ok";
+	if (mode == "noready")
+		return 1;
+
+	//Marker file is created by the first process only
+	bool first_run = false;
+	const char* marker = getenv("JDHOST_STUB_MARKER");
+	if (marker) {
+		const HANDLE file = CreateFileA(marker, GENERIC_WRITE, 0, nullptr, CREATE_NEW, 0, nullptr);
+		if (file != INVALID_HANDLE_VALUE) {
+			first_run = true;
+			CloseHandle(file);
+		}
+	}
+
+	const bool split = (mode == "split");
+	write_all(response(0, "ping", false), split);
+
+	size_t requests = 0;
+	while (true) {
+		unsigned char len_be[4];
+		if (!read_all(len_be, sizeof(len_be)))
+			break;
+		const uint32_t len = (len_be[0] << 24) | (len_be[1] << 16) | (len_be[2] << 8) | len_be[3];
+		if (len > STUB_MAX_REQUEST)
+			return 2;
+		string payload(len, 0);
+		if (len && !read_all(&payload[0], len))
+			break;
+
+		if (mode == "hang")
+			continue;
+		if (mode == "oversize") {
+			string frame;
+			put_be(frame, 0x7fffffff, 4);
+			write_all(frame + string(16, 0), false);
+			continue;
+		}
+
+		size_t pos = 0;
+		string tool, class_file, out_path;
+		string resp;
+		if (!read_utf(payload, pos, tool) || !read_utf(payload, pos, class_file) || !read_utf(payload, pos, out_path) || pos != payload.size())
+			resp = response(2, "malformed request", false);
+		else if (tool == "ping" || tool == "cfr" || tool == "fernflower")
+			resp = response(0, tool, mode == "badutf");
+		else
+			resp = response(1, "Unknown tool: " + tool, false);
+
+		if (mode == "crash" && first_run && ++requests == 2) {
+			write_all(resp.substr(0, resp.size() / 2), false);
+			ExitProcess(3);
+		}
+		write_all(resp, split);
+	}
+
+	return 0;
+}
@@ -0,0 +1,149 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * Framed protocol test of jdhost against the stub host (Windows).
+ *
+ * jdhost_stub.exe from the directory of this program is started instead of
+ * Java, its behavior is selected with JDHOST_STUB_MODE (see jdhost_stub.cpp).
+ * Every case checks the result of decompile() calls and the time they take.
+ *
+ * Usage: jdhost_test
+ */
+
+#include "jdhost.h"
+#include <stdio.h>
+
+//! Response timeout of test calls (milliseconds)
+#define TEST_TIMEOUT	2000
+
+//! Dummy plugin globals referenced by common.h
+const GUID				_FPG = { 0 };
+PluginStartupInfo		_PSI;
+FarStandardFunctions	_FSF;
+
+//! Number of failed checks
+static size_t failures = 0;
+
+
+/**
+ * Check condition.
+ * \param name case name
+ * \param cond condition
+ * \param what description of the checked condition
+ */
+static void check(const char* name, const bool cond, const char* what)
+{
+	printf("%s: %s: %s\n", name, what, cond ? "ok" : "FAILED");
+	if (!cond)
+		++failures;
+}
+
+
+/**
+ * Run test case with new host instance.
+ * \param name case name (stub mode)
+ * \param dir test directory (with trailing slash)
+ * \param class_file class file name sent to host
+ * \param expected expected results of two consecutive calls
+ * \param max_time maximal time of both calls (milliseconds)
+ */
+static void run_case(const char* name, const wstring& dir, const wstring& class_file, const bool expected[2], const ULONGLONG max_time)
+{
+	SetEnvironmentVariableA("JDHOST_STUB_MODE", name);
+	const wstring marker = dir + L"jdhost_stub.marker";
+	DeleteFile(marker.c_str());
+	SetEnvironmentVariable(L"JDHOST_STUB_MARKER", marker.c_str());
+
+	jdhost host;
+	host.setup(dir + L"jdhost_stub.exe", dir);
+	const ULONGLONG start = GetTickCount64();
+	const bool first = host.decompile("cfr", class_file, dir + L"out.java", TEST_TIMEOUT, nullptr);
+	const bool second = host.decompile("fernflower", class_file, dir + L"out", TEST_TIMEOUT, nullptr);
+	const ULONGLONG elapsed = GetTickCount64() - start;
+	host.stop();
+	DeleteFile(marker.c_str());
+
+	check(name, first == expected[0], "first call result");
+	check(name, second == expected[1], "second call result");
+	check(name, elapsed <= max_time, "time");
+}
+
+
+int main()
+{
+	wchar_t module[MAX_PATH];
+	const DWORD len = GetModuleFileName(nullptr, module, MAX_PATH);
+	wstring dir(module, len);
+	dir.erase(dir.rfind(L'\\') + 1);
+
+	//Cyrillic and supplementary characters are sent as modified UTF-8
+	const wstring class_file = dir + L"\x0418\x043c\x044f\xd83d\xde00\\A.class";
+
+	static const bool both_ok[2] = { true, true };
+	static const bool both_failed[2] = { false, false };
+
+	//Both calls are answered by the same host
+	run_case("ok", dir, class_file, both_ok, TEST_TIMEOUT);
+
+	//Frames arrive byte by byte
+	run_case("split", dir, class_file, both_ok, 4 * TEST_TIMEOUT);
+
+	//Message is not used, malformed writeUTF in response doesn't matter
+	run_case("badutf", dir, class_file, both_ok, TEST_TIMEOUT);
+
+	//Length prefix above the limit is rejected at once, host is restarted and fails again
+	run_case("oversize", dir, class_file, both_failed, TEST_TIMEOUT);
+
+	//Host crashes in the middle of the second response, the call restarts it and succeeds
+	run_case("crash", dir, class_file, both_ok, TEST_TIMEOUT);
+
+	//Host doesn't answer: timeout without retry, next call restarts host
+	run_case("hang", dir, class_file, both_failed, 3 * TEST_TIMEOUT);
+
+	//Host can't start: marked as unsupported, second call returns at once
+	run_case("noready", dir, class_file, both_failed, TEST_TIMEOUT);
+
+	//String longer than writeUTF limit is not sent, host stays usable
+	{
+		SetEnvironmentVariableA("JDHOST_STUB_MODE", "ok");
+		jdhost host;
+		host.setup(dir + L"jdhost_stub.exe", dir);
+		const bool long_path = host.decompile("cfr", wstring(0x8000, L'\x0418'), dir + L"out.java", TEST_TIMEOUT, nullptr);
+		const bool next = host.decompile("cfr", class_file, dir + L"out.java", TEST_TIMEOUT, nullptr);
+		check("long_string", !long_path, "long string is rejected");
+		check("long_string", next, "next call result");
+		check("long_string", host.running(), "host is alive");
+	}
+
+	//Cancelled call stops the host
+	{
+		SetEnvironmentVariableA("JDHOST_STUB_MODE", "hang");
+		jdhost host;
+		host.setup(dir + L"jdhost_stub.exe", dir);
+		host.decompile("cfr", class_file, dir + L"out.java", TEST_TIMEOUT, nullptr);
+		const atomic<bool> cancel(true);
+		const ULONGLONG start = GetTickCount64();
+		const bool rc = host.decompile("cfr", class_file, dir + L"out.java", TEST_TIMEOUT, &cancel);
+		check("cancel", !rc && GetTickCount64() - start < TEST_TIMEOUT, "cancelled call returns at once");
+	}
+
+	printf("%zu failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,279 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * Mutation fuzzer of class file parser and zip reader (Linux, build with sanitizers).
+ *
+ * Generated classes are mutated (bit flips, interesting numbers, truncation,
+ * chunk copies) and parsed from an exactly sized heap buffer, so every read
+ * out of the class data is caught by address sanitizer. Accepted classes are
+ * processed as the panel does: member formatting and method line lookup.
+ * Generated jars (plain and zip64) are mutated the same way, every entry of
+ * an accepted archive is extracted.
+ *
+ * Usage: jfuzz [-n iterations] [-s seed]
+ */
+
+#include "jgen.h"
+#include "jtformat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//! Pseudo random generator (xorshift64*)
+class fuzz_random
+{
+public:
+	explicit fuzz_random(const uint64_t seed)
+	:	_state(seed ? seed : 1)
+	{
+	}
+
+	/**
+	 * Get random number.
+	 * \param limit upper limit (exclusive, must not be 0)
+	 * \return random number
+	 */
+	size_t next(const size_t limit)
+	{
+		_state ^= _state >> 12;
+		_state ^= _state << 25;
+		_state ^= _state >> 27;
+		return static_cast<size_t>((_state * 0x2545f4914f6cdd1dull) >> 11) % limit;
+	}
+
+private:
+	uint64_t _state;
+};
+
+
+/**
+ * Mutate class or archive data.
+ * \param rnd random generator
+ * \param data class data
+ * \param big_endian byte order of numbers (class file is BE, zip is LE)
+ */
+static void mutate(fuzz_random& rnd, vector<unsigned char>& data, const bool big_endian)
+{
+	static const uint64_t interesting[] = { 0, 1, 2, 0x7f, 0x80, 0xff, 0x100, 0x7fff, 0x8000, 0xfffe, 0xffff, 0x10000, 0x7fffffff, 0x80000000, 0xffffffff,
+		0x7fffffffffffffffull, 0xfffffffffffffff0ull, 0xffffffffffffffffull };
+
+	const size_t mutations = 1 + rnd.next(4);
+	for (size_t m = 0; m < mutations && !data.empty(); ++m) {
+		const size_t pos = rnd.next(data.size());
+		switch (rnd.next(5)) {
+			case 0:
+				data[pos] ^= static_cast<unsigned char>(1 << rnd.next(8));
+				break;
+			case 1:
+				data[pos] = static_cast<unsigned char>(rnd.next(256));
+				break;
+			case 2: {
+				const uint64_t v = interesting[rnd.next(sizeof(interesting) / sizeof(interesting[0]))];
+				const size_t len = static_cast<size_t>(2) << rnd.next(3);
+				for (size_t i = 0; i < len && pos + i < data.size(); ++i)
+					data[pos + i] = static_cast<unsigned char>(v >> ((big_endian ? len - 1 - i : i) * 8));
+				break;
+			}
+			case 3:
+				data.resize(pos);
+				break;
+			case 4: {
+				const size_t src = rnd.next(data.size());
+				const size_t len = rnd.next(16);
+				for (size_t i = 0; i < len && pos + i < data.size() && src + i < data.size(); ++i)
+					data[pos + i] = data[src + i];
+				break;
+			}
+		}
+	}
+}
+
+
+/**
+ * Open archive from exactly sized heap copy and extract all entries.
+ * \param data archive data
+ * \return false if archive is rejected
+ */
+static bool read_zip(const vector<unsigned char>& data)
+{
+	unsigned char* buf = new unsigned char[data.size()];
+	memcpy(buf, &data.front(), data.size());
+
+	jzip archive;
+	const bool rc = archive.open(buf, data.size());
+	if (rc) {
+		vector<unsigned char> entry;
+		for (size_t i = 0; i < archive.entries().size(); ++i)
+			archive.extract(i, entry);
+	}
+
+	delete[] buf;
+	return rc;
+}
+
+
+/**
+ * Patch little endian number in archive.
+ * \param data archive data
+ * \param pos number position
+ * \param len number size
+ * \param v new value
+ */
+static void patch_le(vector<unsigned char>& data, const size_t pos, const size_t len, const uint64_t v)
+{
+	for (size_t i = 0; i < len; ++i)
+		data[pos + i] = static_cast<unsigned char>(v >> (i * 8));
+}
+
+
+/**
+ * Check known malformed archives (offsets and sizes near 2^64 in zip64 records).
+ * \return false if any archive is accepted with its bad data
+ */
+static bool check_malformed_zips()
+{
+	const vector<unsigned char> jar = gen_jar(2, true);
+	const size_t eocd = jar.size() - 22;
+	const size_t locator = eocd - 20;
+	const size_t eocd64 = locator - 56;
+	bool rc = true;
+
+	//Zip64 locator points out of the archive
+	static const uint64_t bad_offsets[] = { 0xfffffffffffffff0ull, 0xffffffffffffffc8ull, 0xffffffffffffffffull, 0x100000000ull };
+	for (size_t i = 0; i < sizeof(bad_offsets) / sizeof(bad_offsets[0]); ++i) {
+		vector<unsigned char> data = jar;
+		patch_le(data, locator + 8, 8, bad_offsets[i]);
+		if (read_zip(data)) {
+			fprintf(stderr, "Bad zip64 locator %llx is accepted\n", static_cast<unsigned long long>(bad_offsets[i]));
+			rc = false;
+		}
+	}
+
+	//Central directory out of the archive
+	{
+		vector<unsigned char> data = jar;
+		patch_le(data, eocd64 + 48, 8, 0xfffffffffffffff0ull);
+		if (read_zip(data)) {
+			fprintf(stderr, "Bad central directory offset is accepted\n");
+			rc = false;
+		}
+	}
+
+	//Local header offsets and sizes of entries are out of range: archive is read, entries fail
+	const size_t cd_offset = static_cast<size_t>(jar[eocd64 + 48] | (jar[eocd64 + 49] << 8) | (jar[eocd64 + 50] << 16) | (jar[eocd64 + 51] << 24));
+	const size_t name_len = jar[cd_offset + 28] | (jar[cd_offset + 29] << 8);
+	static const uint64_t bad_values[] = { 0xffffffffffffffe2ull, 0xfffffffffffffff0ull, 0x7fffffffffffffffull };
+	for (size_t i = 0; i < sizeof(bad_values) / sizeof(bad_values[0]); ++i) {
+		vector<unsigned char> data = jar;
+		patch_le(data, cd_offset + 46 + name_len + 4, 8, bad_values[i]);
+		read_zip(data);
+		data = jar;
+		patch_le(data, cd_offset + 24, 4, 0xfffffff0);
+		read_zip(data);
+	}
+
+	return rc;
+}
+
+
+int main(int argc, char* argv[])
+{
+	size_t iterations = 200000;
+	uint64_t seed = 1;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			iterations = strtoul(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+		else {
+			fprintf(stderr, "Usage: %s [-n iterations] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	const bench_case seeds[] = { gen_small(), gen_wide_pairs() };
+	const size_t seeds_count = sizeof(seeds) / sizeof(seeds[0]);
+
+	//Seeds must be accepted, otherwise mutations test nothing
+	for (size_t i = 0; i < seeds_count; ++i) {
+		jclass cls;
+		jclass::jclassinfo info;
+		vector<jclass::jmember> members;
+		if (!cls.read(&seeds[i].data.front(), seeds[i].data.size(), info, members)) {
+			fprintf(stderr, "Seed %s is rejected\n", seeds[i].name);
+			return 1;
+		}
+	}
+
+	fuzz_random rnd(seed);
+	jtformat jfmt;
+	size_t accepted = 0;
+	for (size_t n = 0; n < iterations; ++n) {
+		//Small seed is mutated mostly, it is fast and has every structure
+		const bench_case& bc = seeds[rnd.next(256) ? 0 : 1];
+		vector<unsigned char> data = bc.data;
+		mutate(rnd, data, true);
+		if (data.empty())
+			continue;
+
+		//Exact size copy: any read past the end is a heap overflow
+		unsigned char* buf = new unsigned char[data.size()];
+		memcpy(buf, &data.front(), data.size());
+
+		jclass cls;
+		jclass::jclassinfo info;
+		vector<jclass::jmember> members;
+		if (cls.read(buf, data.size(), info, members)) {
+			++accepted;
+			for (size_t i = 0; i < cls.methods().size(); ++i)
+				cls.first_line(i);
+			for (size_t i = 0; i < members.size(); ++i) {
+				try {
+					jfmt.format(members[i]);
+				}
+				catch (exception&) {
+					//Malformed descriptor is reported by formatter
+				}
+			}
+		}
+
+		delete[] buf;
+	}
+
+	printf("{\"target\":\"jclass\",\"iterations\":%zu,\"accepted\":%zu,\"rejected\":%zu}\n", iterations, accepted, iterations - accepted);
+
+	if (!check_malformed_zips())
+		return 1;
+
+	//Archives are bigger, they get less iterations
+	const vector<unsigned char> zip_seeds[] = { gen_jar(3, false), gen_jar(3, true) };
+	const size_t zip_iterations = iterations / 4;
+	accepted = 0;
+	for (size_t n = 0; n < zip_iterations; ++n) {
+		vector<unsigned char> data = zip_seeds[rnd.next(2)];
+		mutate(rnd, data, false);
+		if (!data.empty() && read_zip(data))
+			++accepted;
+	}
+
+	printf("{\"target\":\"jzip\",\"iterations\":%zu,\"accepted\":%zu,\"rejected\":%zu}\n", zip_iterations, accepted, zip_iterations - accepted);
+	return 0;
+}
@@ -0,0 +1,522 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#include "jclass.h"
+#include "jzip.h"
+
+//! Synthetic class file builder (benchmark and fuzzing)
+class jgen
+{
+public:
+	jgen()
+	:	_pool_count(1), _fields_count(0), _methods_count(0), _attrs_count(0), _code_attr(0), _lnt_attr(0)
+	{
+	}
+
+	/**
+	 * Get number of used constant pool entries.
+	 * \return number of entries (with reserved zero entry)
+	 */
+	size_t pool_count() const	{ return _pool_count; }
+
+	/**
+	 * Add CONSTANT_Utf8.
+	 * \param val string value (ASCII)
+	 * \return pool index
+	 */
+	uint16_t utf8(const string& val)
+	{
+		_pool.push_back(1);
+		put_u16(_pool, static_cast<uint16_t>(val.length()));
+		_pool.insert(_pool.end(), val.begin(), val.end());
+		return static_cast<uint16_t>(_pool_count++);
+	}
+
+	/**
+	 * Add CONSTANT_Class.
+	 * \param name class name
+	 * \return pool index
+	 */
+	uint16_t class_ref(const string& name)
+	{
+		const uint16_t name_idx = utf8(name);
+		_pool.push_back(7);
+		put_u16(_pool, name_idx);
+		return static_cast<uint16_t>(_pool_count++);
+	}
+
+	/**
+	 * Add CONSTANT_Long or CONSTANT_Double (takes two pool entries).
+	 * \param dbl double type flag
+	 */
+	void wide(const bool dbl)
+	{
+		_pool.push_back(dbl ? 6 : 5);
+		for (int i = 0; i < 8; ++i)
+			_pool.push_back(static_cast<unsigned char>(_pool_count >> i));
+		_pool_count += 2;
+	}
+
+	/**
+	 * Add member.
+	 * \param method method flag (field otherwise)
+	 * \param access access flags
+	 * \param name name index
+	 * \param descr descriptor index
+	 * \param code_size size of Code attribute bytecode (methods only, 0 for abstract)
+	 * \param lines number of LineNumberTable entries
+	 */
+	void member(const bool method, const uint16_t access, const uint16_t name, const uint16_t descr, const uint32_t code_size = 0, const uint16_t lines = 0)
+	{
+		vector<unsigned char>& out = method ? _methods : _fields;
+		++(method ? _methods_count : _fields_count);
+		put_u16(out, access);
+		put_u16(out, name);
+		put_u16(out, descr);
+		if (!method || !code_size) {
+			put_u16(out, 0);
+			return;
+		}
+		const uint32_t lnt_size = 2 + lines * 4;
+		put_u16(out, 1);
+		put_u16(out, code_attr());
+		put_u32(out, 2 + 2 + 4 + code_size + 2 + 2 + 6 + lnt_size);
+		put_u16(out, 8);	//max_stack
+		put_u16(out, 8);	//max_locals
+		put_u32(out, code_size);
+		out.insert(out.end(), code_size, 0);	//nop
+		put_u16(out, 0);	//exception_table_length
+		put_u16(out, 1);
+		put_u16(out, lnt_attr());
+		put_u32(out, lnt_size);
+		put_u16(out, lines);
+		for (uint16_t i = 0; i < lines; ++i) {
+			put_u16(out, i);
+			put_u16(out, static_cast<uint16_t>(1000 - i));
+		}
+	}
+
+	/**
+	 * Add SourceFile class attribute.
+	 * \param name source file name
+	 */
+	void source_file(const string& name)
+	{
+		++_attrs_count;
+		put_u16(_attrs, utf8("SourceFile"));
+		put_u32(_attrs, 2);
+		put_u16(_attrs, utf8(name));
+	}
+
+	/**
+	 * Add unknown class attribute.
+	 * \param size attribute size
+	 */
+	void class_attr(const uint32_t size)
+	{
+		++_attrs_count;
+		put_u16(_attrs, utf8("Bench" + to_string(_attrs_count)));
+		put_u32(_attrs, size);
+		_attrs.insert(_attrs.end(), size, 0x5a);
+	}
+
+	/**
+	 * Build class file.
+	 * \param this_class this class index
+	 * \param super_class super class index
+	 * \return class file content
+	 */
+	vector<unsigned char> build(const uint16_t this_class, const uint16_t super_class) const
+	{
+		vector<unsigned char> out;
+		put_u32(out, 0xcafebabe);
+		put_u16(out, 0);
+		put_u16(out, 52);
+		put_u16(out, static_cast<uint16_t>(_pool_count));
+		out.insert(out.end(), _pool.begin(), _pool.end());
+		put_u16(out, 0x0021);
+		put_u16(out, this_class);
+		put_u16(out, super_class);
+		put_u16(out, 0);	//interfaces
+		put_u16(out, _fields_count);
+		out.insert(out.end(), _fields.begin(), _fields.end());
+		put_u16(out, _methods_count);
+		out.insert(out.end(), _methods.begin(), _methods.end());
+		put_u16(out, _attrs_count);
+		out.insert(out.end(), _attrs.begin(), _attrs.end());
+		return out;
+	}
+
+private:
+	//! Attribute names are added to pool on first use
+	uint16_t code_attr()
+	{
+		if (!_code_attr)
+			_code_attr = utf8("Code");
+		return _code_attr;
+	}
+
+	uint16_t lnt_attr()
+	{
+		if (!_lnt_attr)
+			_lnt_attr = utf8("LineNumberTable");
+		return _lnt_attr;
+	}
+
+	static void put_u16(vector<unsigned char>& out, const uint16_t v)
+	{
+		out.push_back(static_cast<unsigned char>(v >> 8));
+		out.push_back(static_cast<unsigned char>(v));
+	}
+
+	static void put_u32(vector<unsigned char>& out, const uint32_t v)
+	{
+		put_u16(out, static_cast<uint16_t>(v >> 16));
+		put_u16(out, static_cast<uint16_t>(v));
+	}
+
+private:
+	vector<unsigned char> _pool;	///< Constant pool entries
+	size_t _pool_count;				///< Constant pool count (with reserved zero entry)
+	vector<unsigned char> _fields;	///< Fields
+	vector<unsigned char> _methods;	///< Methods
+	vector<unsigned char> _attrs;	///< Class attributes
+	uint16_t _fields_count;			///< Number of fields
+	uint16_t _methods_count;		///< Number of methods
+	uint16_t _attrs_count;			///< Number of class attributes
+	uint16_t _code_attr;			///< "Code" name index
+	uint16_t _lnt_attr;				///< "LineNumberTable" name index
+};
+
+
+//! Generated class
+struct bench_case {
+	const char* name;				///< Case name
+	vector<unsigned char> data;		///< Class file content
+};
+
+
+//! Descriptors in the shape of real code: repeated short ones and long object lists
+static const char* descriptors[] = {
+	"()V",
+	"(Ljava/lang/String;)V",
+	"()Ljava/lang/String;",
+	"(I)I",
+	"(JD)Z",
+	"(Ljava/lang/Object;)Z",
+	"(Ljava/util/Map;Ljava/util/List;[Ljava/lang/String;)Ljava/util/Map;",
+	"(Lcom/google/protobuf/CodedInputStream;Lcom/google/protobuf/ExtensionRegistryLite;)Lcom/google/protobuf/GeneratedMessageV3;",
+	"[[[Ljava/lang/Object;",
+	"Ljava/util/concurrent/ConcurrentHashMap;"
+};
+#define DESCRIPTORS_COUNT (sizeof(descriptors) / sizeof(descriptors[0]))
+
+
+/**
+ * Constant pool filled up to 65535 entries, mostly strings.
+ */
+inline bench_case gen_pool_max()
+{
+	jgen g;
+	const uint16_t this_class = g.class_ref("bench/PoolMax");
+	const uint16_t super_class = g.class_ref("java/lang/Object");
+	const uint16_t name = g.utf8("value");
+	const uint16_t descr = g.utf8("I");
+	g.member(false, 0x0001, name, descr);
+	while (g.pool_count() < 0xffff)
+		g.utf8("bench/constant/String" + to_string(g.pool_count()));
+	bench_case bc = { "pool_max", g.build(this_class, super_class) };
+	return bc;
+}
+
+
+/**
+ * Constant pool of long/double pairs (every pair takes two entries).
+ */
+inline bench_case gen_wide_pairs()
+{
+	jgen g;
+	const uint16_t this_class = g.class_ref("bench/WidePairs");
+	const uint16_t super_class = g.class_ref("java/lang/Object");
+	const uint16_t name = g.utf8("value");
+	const uint16_t descr = g.utf8("J");
+	g.member(false, 0x0019, name, descr);
+	while (g.pool_count() < 0xffff - 1)
+		g.wide((g.pool_count() & 2) != 0);
+	bench_case bc = { "wide_pairs", g.build(this_class, super_class) };
+	return bc;
+}
+
+
+/**
+ * Maximal member counts with distinct names and typical descriptors.
+ */
+inline bench_case gen_members()
+{
+	jgen g;
+	const uint16_t this_class = g.class_ref("bench/Members");
+	const uint16_t super_class = g.class_ref("java/lang/Object");
+	uint16_t descr[DESCRIPTORS_COUNT];
+	for (size_t i = 0; i < DESCRIPTORS_COUNT; ++i)
+		descr[i] = g.utf8(descriptors[i]);
+	for (size_t i = 0; i < 30000; ++i)
+		g.member(true, static_cast<uint16_t>(i & 0x1f), g.utf8("method" + to_string(i)), descr[i % 8], 4, 2);
+	for (size_t i = 0; i < 30000; ++i)
+		g.member(false, static_cast<uint16_t>(i & 0x1f), g.utf8("field" + to_string(i)), descr[8 + i % 2]);
+	bench_case bc = { "members", g.build(this_class, super_class) };
+	return bc;
+}
+
+
+/**
+ * Descriptors with deep arrays (255 dimensions) and long argument lists.
+ */
+inline bench_case gen_deep_arrays()
+{
+	jgen g;
+	const uint16_t this_class = g.class_ref("bench/DeepArrays");
+	const uint16_t super_class = g.class_ref("java/lang/Object");
+	for (size_t i = 0; i < 2000; ++i) {
+		string descr = "(";
+		for (size_t j = 0; j < 16; ++j)
+			descr += string(1 + (i + j) % 255, '[') + (j & 1 ? "I" : "Ljava/lang/Object;");
+		descr += ")" + string(255, '[') + "Lbench/DeepArrays;";
+		g.member(true, 0x0009, g.utf8("deep" + to_string(i)), g.utf8(descr), 1, 1);
+	}
+	bench_case bc = { "deep_arrays", g.build(this_class, super_class) };
+	return bc;
+}
+
+
+/**
+ * Large Code, LineNumberTable and class attributes.
+ */
+inline bench_case gen_large_attrs()
+{
+	jgen g;
+	const uint16_t this_class = g.class_ref("bench/LargeAttrs");
+	const uint16_t super_class = g.class_ref("java/lang/Object");
+	const uint16_t descr = g.utf8(descriptors[0]);
+	for (size_t i = 0; i < 64; ++i)
+		g.member(true, 0x0001, g.utf8("big" + to_string(i)), descr, 65535, 8192);
+	for (size_t i = 0; i < 4; ++i)
+		g.class_attr(4 << 20);
+	bench_case bc = { "large_attrs", g.build(this_class, super_class) };
+	return bc;
+}
+
+
+/**
+ * Small class with every structure the parser handles (fuzzing seed).
+ */
+inline bench_case gen_small()
+{
+	jgen g;
+	const uint16_t this_class = g.class_ref("bench/Small");
+	const uint16_t super_class = g.class_ref("java/lang/Object");
+	g.wide(false);
+	g.wide(true);
+	for (size_t i = 0; i < 4; ++i)
+		g.member(false, 0x0002, g.utf8("f" + to_string(i)), g.utf8(descriptors[8 + i % 2]));
+	for (size_t i = 0; i < 4; ++i)
+		g.member(true, 0x0001, g.utf8("m" + to_string(i)), g.utf8(descriptors[i * 2]), 3, 2);
+	g.member(true, 0x0009, g.utf8("deep"), g.utf8("([[[I" + string(255, '[') + "Ljava/lang/Object;)" + string(255, '[') + "J"), 1, 1);
+	g.source_file("Small.java");
+	g.class_attr(8);
+	bench_case bc = { "small", g.build(this_class, super_class) };
+	return bc;
+}
+
+
+//! Synthetic jar builder (benchmark and fuzzing)
+class jargen
+{
+public:
+	/**
+	 * Add entry.
+	 * \param name entry name
+	 * \param data entry content
+	 * \param deflated compress entry (stored otherwise)
+	 */
+	void add(const string& name, const vector<unsigned char>& data, const bool deflated)
+	{
+		vector<unsigned char> packed;
+		if (deflated)
+			jzip::deflate(data.empty() ? nullptr : &data.front(), data.size(), packed);
+		else
+			packed = data;
+		const uint32_t crc = data.empty() ? 0 : jzip::crc32(&data.front(), data.size());
+
+		const uint64_t offset = _data.size();
+		put_u32(_data, 0x04034b50);
+		put_u16(_data, 20);
+		put_u16(_data, 0);
+		put_u16(_data, deflated ? 8 : 0);
+		put_u32(_data, 0);	//time and date
+		put_u32(_data, crc);
+		put_u32(_data, static_cast<uint32_t>(packed.size()));
+		put_u32(_data, static_cast<uint32_t>(data.size()));
+		put_u16(_data, static_cast<uint16_t>(name.length()));
+		put_u16(_data, 0);
+		_data.insert(_data.end(), name.begin(), name.end());
+		_data.insert(_data.end(), packed.begin(), packed.end());
+
+		central_record cr = { name, deflated, crc, packed.size(), data.size(), offset };
+		_central.push_back(cr);
+	}
+
+	/**
+	 * Build archive.
+	 * \param zip64 write zip64 end of central directory and local offsets in zip64 extra fields
+	 * \return archive content
+	 */
+	vector<unsigned char> build(const bool zip64) const
+	{
+		vector<unsigned char> out = _data;
+		const uint64_t cd_offset = out.size();
+		for (size_t i = 0; i < _central.size(); ++i) {
+			const central_record& cr = _central[i];
+			put_u32(out, 0x02014b50);
+			put_u16(out, zip64 ? 45 : 20);
+			put_u16(out, zip64 ? 45 : 20);
+			put_u16(out, 0);
+			put_u16(out, cr.deflated ? 8 : 0);
+			put_u32(out, 0);	//time and date
+			put_u32(out, cr.crc);
+			put_u32(out, static_cast<uint32_t>(cr.compressed_size));
+			put_u32(out, static_cast<uint32_t>(cr.size));
+			put_u16(out, static_cast<uint16_t>(cr.name.length()));
+			put_u16(out, zip64 ? 12 : 0);
+			put_u16(out, 0);	//comment
+			put_u16(out, 0);	//disk
+			put_u16(out, 0);	//internal attributes
+			put_u32(out, 0);	//external attributes
+			put_u32(out, zip64 ? 0xffffffff : static_cast<uint32_t>(cr.offset));
+			out.insert(out.end(), cr.name.begin(), cr.name.end());
+			if (zip64) {
+				put_u16(out, 0x0001);
+				put_u16(out, 8);
+				put_u64(out, cr.offset);
+			}
+		}
+		const uint64_t cd_size = out.size() - cd_offset;
+
+		if (zip64) {
+			const uint64_t eocd64 = out.size();
+			put_u32(out, 0x06064b50);
+			put_u64(out, 44);
+			put_u16(out, 45);
+			put_u16(out, 45);
+			put_u32(out, 0);
+			put_u32(out, 0);
+			put_u64(out, _central.size());
+			put_u64(out, _central.size());
+			put_u64(out, cd_size);
+			put_u64(out, cd_offset);
+			put_u32(out, 0x07064b50);
+			put_u32(out, 0);
+			put_u64(out, eocd64);
+			put_u32(out, 1);
+		}
+
+		put_u32(out, 0x06054b50);
+		put_u16(out, 0);
+		put_u16(out, 0);
+		put_u16(out, zip64 ? 0xffff : static_cast<uint16_t>(_central.size()));
+		put_u16(out, zip64 ? 0xffff : static_cast<uint16_t>(_central.size()));
+		put_u32(out, zip64 ? 0xffffffff : static_cast<uint32_t>(cd_size));
+		put_u32(out, zip64 ? 0xffffffff : static_cast<uint32_t>(cd_offset));
+		put_u16(out, 0);
+		return out;
+	}
+
+private:
+	//! Central directory record
+	struct central_record {
+		string		name;				///< Entry name
+		bool		deflated;			///< Compression flag
+		uint32_t	crc;				///< CRC32
+		uint64_t	compressed_size;	///< Compressed size
+		uint64_t	size;				///< Uncompressed size
+		uint64_t	offset;				///< Local header offset
+	};
+
+	//! Little endian writers (zip data is always LE)
+	static void put_u16(vector<unsigned char>& out, const uint16_t v)
+	{
+		out.push_back(static_cast<unsigned char>(v));
+		out.push_back(static_cast<unsigned char>(v >> 8));
+	}
+
+	static void put_u32(vector<unsigned char>& out, const uint32_t v)
+	{
+		put_u16(out, static_cast<uint16_t>(v));
+		put_u16(out, static_cast<uint16_t>(v >> 16));
+	}
+
+	static void put_u64(vector<unsigned char>& out, const uint64_t v)
+	{
+		put_u32(out, static_cast<uint32_t>(v));
+		put_u32(out, static_cast<uint32_t>(v >> 32));
+	}
+
+private:
+	vector<unsigned char>	_data;		///< Local headers and entry data
+	vector<central_record>	_central;	///< Central directory records
+};
+
+
+/**
+ * Typical application class: a few fields, methods with code and line numbers.
+ * \param index class number (names and hierarchy depend on it)
+ * \return class file content
+ */
+inline vector<unsigned char> gen_app_class(const size_t index)
+{
+	jgen g;
+	const uint16_t this_class = g.class_ref("bench/p" + to_string(index % 32) + "/C" + to_string(index));
+	const uint16_t super_class = g.class_ref(index % 8 ? "bench/p0/C" + to_string(index % 8) : string("java/lang/Object"));
+	uint16_t descr[DESCRIPTORS_COUNT];
+	for (size_t i = 0; i < DESCRIPTORS_COUNT; ++i)
+		descr[i] = g.utf8(descriptors[i]);
+	for (size_t i = 0; i < 8; ++i)
+		g.member(false, 0x0002, g.utf8("field" + to_string(i)), descr[8 + i % 2]);
+	for (size_t i = 0; i < 40; ++i)
+		g.member(true, 0x0001, g.utf8("method" + to_string((index + i) % 200)), descr[i % 8], 32 + i, 4);
+	g.source_file("C" + to_string(index) + ".java");
+	return g.build(this_class, super_class);
+}
+
+
+/**
+ * Jar of typical application classes.
+ * \param count number of classes
+ * \param zip64 build zip64 archive
+ * \return archive content
+ */
+inline vector<unsigned char> gen_jar(const size_t count, const bool zip64)
+{
+	jargen jar;
+	jar.add("META-INF/MANIFEST.MF", vector<unsigned char>(32, 'M'), false);
+	for (size_t i = 0; i < count; ++i)
+		jar.add("bench/p" + to_string(i % 32) + "/C" + to_string(i) + ".class", gen_app_class(i), i % 4 != 0);
+	return jar.build(zip64);
+}
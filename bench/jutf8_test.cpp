@@ -0,0 +1,216 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * Modified UTF-8 decoder tests (Linux).
+ *
+ * Known sequences (0xC0 0x80, surrogate pairs, truncated and invalid
+ * sequences) are decoded and encoded back. The vectorized decoder is
+ * compared with a byte by byte reference at every length and alignment,
+ * with a non-ASCII sequence at every position. The Makefile builds it
+ * twice: with the default instruction set (SSE2) and with AVX2.
+ *
+ * Usage: jutf8_test
+ */
+
+#include "jutf8.h"
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+#include <vector>
+
+//! Number of failed checks
+static size_t failures = 0;
+
+
+/**
+ * Reference decoder: the same rules as jutf8::decode without vector code.
+ * \param data source data
+ * \param len source data length
+ * \return decoded string
+ */
+static wstring reference_decode(const unsigned char* data, const size_t len)
+{
+	wstring out;
+	const auto put = [&out](const unsigned int cp) {
+#if WCHAR_MAX <= 0xffff
+		if (cp >= 0x10000) {
+			out += static_cast<wchar_t>(0xd800 + ((cp - 0x10000) >> 10));
+			out += static_cast<wchar_t>(0xdc00 + ((cp - 0x10000) & 0x3ff));
+			return;
+		}
+#endif
+		out += static_cast<wchar_t>(cp);
+	};
+	const auto cont = [data, len](const size_t pos) { return pos < len && (data[pos] & 0xc0) == 0x80; };
+
+	size_t pos = 0;
+	while (pos < len) {
+		const unsigned char c = data[pos];
+		if (c < 0x80) {
+			out += static_cast<wchar_t>(c);
+			++pos;
+		}
+		else if ((c & 0xe0) == 0xc0 && cont(pos + 1)) {
+			put(((c & 0x1f) << 6) | (data[pos + 1] & 0x3f));
+			pos += 2;
+		}
+		else if ((c & 0xf0) == 0xe0 && cont(pos + 1) && cont(pos + 2)) {
+			const unsigned int cp = ((c & 0x0f) << 12) | ((data[pos + 1] & 0x3f) << 6) | (data[pos + 2] & 0x3f);
+			pos += 3;
+			if (cp >= 0xd800 && cp <= 0xdbff && pos + 2 < len && data[pos] == 0xed && (data[pos + 1] & 0xf0) == 0xb0 && cont(pos + 2)) {
+				const unsigned int low = 0xd000 | ((data[pos + 1] & 0x3f) << 6) | (data[pos + 2] & 0x3f);
+				put(0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00));
+				pos += 3;
+			}
+			else
+				put(cp);
+		}
+		else if ((c & 0xf8) == 0xf0 && cont(pos + 1) && cont(pos + 2) && cont(pos + 3)) {
+			const unsigned int cp = ((c & 0x07) << 18) | ((data[pos + 1] & 0x3f) << 12) | ((data[pos + 2] & 0x3f) << 6) | (data[pos + 3] & 0x3f);
+			put(cp <= 0x10ffff ? cp : 0xfffd);
+			pos += 4;
+		}
+		else {
+			out += static_cast<wchar_t>(0xfffd);
+			++pos;
+		}
+	}
+	return out;
+}
+
+
+/**
+ * Print string as code units.
+ * \param val string
+ */
+static void dump(const wstring& val)
+{
+	for (size_t i = 0; i < val.length(); ++i)
+		fprintf(stderr, " %04x", static_cast<unsigned int>(val[i]));
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Check decoding of known sequence.
+ * \param name test name
+ * \param data source data
+ * \param len source data length
+ * \param expected expected code points
+ * \param round_trip check that encoding restores the source
+ */
+static void check(const char* name, const char* data, const size_t len, const vector<unsigned int>& expected, const bool round_trip)
+{
+	wstring exp;
+	for (size_t i = 0; i < expected.size(); ++i) {
+#if WCHAR_MAX <= 0xffff
+		if (expected[i] >= 0x10000) {
+			exp += static_cast<wchar_t>(0xd800 + ((expected[i] - 0x10000) >> 10));
+			exp += static_cast<wchar_t>(0xdc00 + ((expected[i] - 0x10000) & 0x3ff));
+			continue;
+		}
+#endif
+		exp += static_cast<wchar_t>(expected[i]);
+	}
+
+	wstring out;
+	jutf8::decode(reinterpret_cast<const unsigned char*>(data), len, out);
+	if (out != exp) {
+		fprintf(stderr, "%s: decoded:", name);
+		dump(out);
+		fprintf(stderr, "%s: expected:", name);
+		dump(exp);
+		++failures;
+	}
+
+	if (round_trip) {
+		string enc;
+		jutf8::encode(out, enc);
+		if (enc != string(data, len)) {
+			fprintf(stderr, "%s: encoded value differs from source\n", name);
+			++failures;
+		}
+	}
+}
+
+
+/**
+ * Compare decoder with reference at every length and alignment.
+ * \param max_len maximal string length
+ */
+static void check_agreement(const size_t max_len)
+{
+	static const char* inserts[] = { "", "\xc0\x80", "\xd0\x96", "\xe2\x82\xac", "\xed\xa0\xbd\xed\xb8\x80", "\x80", "\xc3", "\xe2\x82", "\xf0\x9f\x98\x80", "\xff" };
+	static const size_t max_align = 32;
+
+	vector<unsigned char> buf(max_align + max_len + 8);
+	size_t checks = 0;
+	for (size_t ins = 0; ins < sizeof(inserts) / sizeof(inserts[0]); ++ins) {
+		const size_t ins_len = strlen(inserts[ins]);
+		for (size_t len = ins_len; len <= max_len; ++len) {
+			for (size_t ins_pos = 0; ins_pos + ins_len <= len; ins_pos += (ins_len ? 1 : len + 1)) {
+				for (size_t align = 0; align < max_align; ++align) {
+					unsigned char* data = &buf[align];
+					for (size_t i = 0; i < len; ++i)
+						data[i] = static_cast<unsigned char>('!' + (i * 7 + align) % 90);
+					memcpy(data + ins_pos, inserts[ins], ins_len);
+
+					wstring out;
+					jutf8::decode(data, len, out);
+					if (out != reference_decode(data, len)) {
+						fprintf(stderr, "Mismatch: insert %zu, length %zu, position %zu, alignment %zu\n", ins, len, ins_pos, align);
+						++failures;
+						return;
+					}
+					++checks;
+				}
+			}
+		}
+	}
+	printf("{\"test\":\"agreement\",\"checks\":%zu}\n", checks);
+}
+
+
+int main()
+{
+	check("nul", "\xc0\x80", 2, { 0 }, true);
+	check("nul_in_ascii", "a\xc0\x80z", 4, { 'a', 0, 'z' }, true);
+	check("two_bytes", "\xd0\x96", 2, { 0x416 }, true);
+	check("three_bytes", "\xe2\x82\xac", 3, { 0x20ac }, true);
+	check("surrogate_pair", "\xed\xa0\xbd\xed\xb8\x80", 6, { 0x1f600 }, true);
+	check("surrogate_pair_in_ascii", "x\xed\xa0\xbd\xed\xb8\x80y", 8, { 'x', 0x1f600, 'y' }, true);
+	check("standard_four_bytes", "\xf0\x9f\x98\x80", 4, { 0x1f600 }, false);
+	check("lone_high_surrogate", "\xed\xa0\xbd" "A", 4, { 0xd83d, 'A' }, false);
+	check("lone_low_surrogate", "\xed\xb8\x80", 3, { 0xde00 }, false);
+	check("high_surrogate_at_end", "\xed\xa0\xbd", 3, { 0xd83d }, false);
+	check("truncated_two_bytes", "ab\xc3", 3, { 'a', 'b', 0xfffd }, false);
+	check("truncated_three_bytes", "\xe2\x82", 2, { 0xfffd, 0xfffd }, false);
+	check("truncated_pair", "\xed\xa0\xbd\xed\xb8", 5, { 0xd83d, 0xfffd, 0xfffd }, false);
+	check("bad_continuation", "\xc3\x41", 2, { 0xfffd, 'A' }, false);
+	check("lone_continuation", "\x80\xbf", 2, { 0xfffd, 0xfffd }, false);
+	check("invalid_bytes", "\xf8\xff", 2, { 0xfffd, 0xfffd }, false);
+	check("four_bytes_too_big", "\xf4\x90\x80\x80", 4, { 0xfffd }, false);
+	check("empty", "", 0, {}, true);
+
+	check_agreement(96);
+
+	printf("{\"test\":\"jutf8\",\"failures\":%zu}\n", failures);
+	return failures ? 1 : 0;
+}
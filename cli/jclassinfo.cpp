@@ -0,0 +1,511 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * Command line lister of class members (Linux), uses the same parser and
+ * formatter as the plug-in panel.
+ *
+ * Arguments are class files, archives (jar/zip) or directories, directories
+ * are walked recursively for class files and archives. Classes are parsed
+ * on a thread pool in batches of limited size, results of every batch are
+ * printed in input order before the next batch is collected, so memory use
+ * doesn't depend on the number of classes.
+ *
+ * Every member is printed as one line, TSV columns:
+ *   path, class, kind (method/field), line, name, descriptor, text
+ * or JSON object with the same keys. Class path of archive entries is
+ * "archive!/entry". Text is the member as shown on the panel.
+ *
+ * With -c archives are listed through the member index cache shared with
+ * the plug-in (jindex::open): only new and changed classes are parsed.
+ * Entries are printed by logical path (without multi-release prefix) and
+ * invalid classes are reported by their number.
+ *
+ * Usage: jclassinfo [-a] [-s] [-d] [-j] [-c] [-t threads] path...
+ *   -a  show access modifiers (panel "View access" option)
+ *   -s  short object names (panel "Short objects names" option)
+ *   -d  dotted object names (panel "Replace slashes to dots" option)
+ *   -j  print JSON Lines instead of TSV
+ *   -c  list archives through the member index cache
+ *   -t  number of worker threads (default is all hardware threads)
+ * Exit code is 1 if any class or archive can not be read.
+ */
+
+#include "jclass.h"
+#include "jtformat.h"
+#include "jutf8.h"
+#include "jzip.h"
+#include "jindex.h"
+#include "dir_walker.h"
+#include "work_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Number of classes parsed and printed at once
+#define CLI_BATCH_SIZE	4096
+
+
+//! Output options.
+struct cli_options {
+	bool	access;		///< Show access modifiers
+	bool	short_type;	///< Short object names
+	bool	jo_view;	///< Dotted object names
+	bool	json;		///< JSON Lines output
+	bool	cache;		///< List archives through member index cache
+};
+
+
+class lister
+{
+public:
+	/**
+	 * Constructor.
+	 * \param opt output options
+	 * \param threads number of worker threads (0 to use all hardware threads)
+	 */
+	lister(const cli_options& opt, const size_t threads);
+
+	/**
+	 * List class file, archive or directory.
+	 * \param path input path
+	 * \return false if path can not be read
+	 */
+	bool list(const native_path& path);
+
+	/**
+	 * Print pending results.
+	 */
+	void flush();
+
+	/**
+	 * Get number of failed classes and archives.
+	 * \return number of failures
+	 */
+	size_t failed() const { return _failed; }
+
+private:
+	//! Queued class.
+	struct job {
+		native_path		file_name;	///< Class file name (empty for archive entry)
+		const jzip*		archive;	///< Archive of entry (nullptr for class file)
+		size_t			entry;		///< Archive entry index
+		string			path;		///< Class path printed in output
+	};
+
+	//! Worker private state, kept between batches.
+	struct worker_state {
+		vector<unsigned char>	buffer;		///< Scratch buffer for inflated data
+		mapped_file				file;		///< Scratch mapping for class files
+		jclass					parser;		///< Class parser
+		jtformat				fmt;		///< Member formatter
+		jclass::jclassinfo		info;		///< Class description
+		vector<jclass::jmember>	members;	///< Class members
+		wstring					text;		///< Formatted member
+		string					utf8;		///< Encoded string
+	};
+
+	/**
+	 * Queue class, full batch is flushed.
+	 * \param j class job
+	 */
+	void add(const job& j);
+
+	/**
+	 * List archive classes.
+	 * \param file_name archive file name
+	 * \param path archive path printed in output
+	 * \return false if archive can not be opened
+	 */
+	bool list_archive(const native_path& file_name, const string& path);
+
+	/**
+	 * List archive classes through member index cache.
+	 * \param file_name archive file name
+	 * \param path archive path printed in output
+	 * \return false if archive can not be opened
+	 */
+	bool list_index(const native_path& file_name, const string& path);
+
+	/**
+	 * Parse class and print its members into buffer (worker thread).
+	 * \param j class job
+	 * \param ws worker state
+	 * \param out output buffer
+	 * \return false if class can not be read
+	 */
+	bool process(const job& j, worker_state& ws, string& out) const;
+
+	/**
+	 * Print class members into buffer (worker thread).
+	 * \param path class path printed in output
+	 * \param name class name
+	 * \param members class members
+	 * \param ws worker state
+	 * \param out output buffer
+	 * \return false if member descriptor is malformed
+	 */
+	bool print(const string& path, const wstring& name, const vector<jclass::jmember>& members, worker_state& ws, string& out) const;
+
+	/**
+	 * Append output field.
+	 * \param out output buffer
+	 * \param key field name (JSON)
+	 * \param val field value (UTF-8)
+	 * \param first first field flag
+	 * \param number numeric value flag (not quoted in JSON)
+	 */
+	void put_field(string& out, const char* key, const string& val, const bool first, const bool number = false) const;
+
+	/**
+	 * Check file name extension (case insensitive).
+	 * \param name file name
+	 * \param ext extension with dot
+	 * \return true if file name has the extension
+	 */
+	static bool has_ext(const string& name, const char* ext);
+
+private:
+	cli_options				_opt;		///< Output options
+	work_pool				_pool;		///< Worker threads
+	vector<worker_state>	_workers;	///< Worker states
+	vector<job>				_jobs;		///< Queued classes
+	vector<string>			_output;	///< Output of queued classes
+	vector<char>			_valid;		///< Queued class was read successfully
+	size_t					_failed;	///< Number of failures
+};
+
+
+lister::lister(const cli_options& opt, const size_t threads)
+:	_opt(opt),
+	_pool(threads),
+	_workers(_pool.size()),
+	_output(CLI_BATCH_SIZE),
+	_valid(CLI_BATCH_SIZE),
+	_failed(0)
+{
+	for (size_t i = 0; i < _workers.size(); ++i) {
+		_workers[i].fmt.set_access(opt.access);
+		_workers[i].fmt.set_short_type(opt.short_type);
+		_workers[i].fmt.set_jo_view(opt.jo_view);
+	}
+	_jobs.reserve(CLI_BATCH_SIZE);
+}
+
+
+bool lister::list(const native_path& path)
+{
+	if (dir_walker::is_dir(path)) {
+		native_path root = path;
+		while (root.length() > 1 && root[root.length() - 1] == '/')
+			root.erase(root.length() - 1);
+		return dir_walker::walk(root, nullptr, [this, &root](const dir_walker::file& f) {
+			const string name = root + '/' + f.path;
+			if (has_ext(f.path, ".class")) {
+				job j;
+				j.file_name = f.full_path;
+				j.archive = nullptr;
+				j.entry = 0;
+				j.path = name;
+				add(j);
+			}
+			else if (has_ext(f.path, ".jar") || has_ext(f.path, ".zip"))
+				list_archive(f.full_path, name);
+		});
+	}
+
+	mapped_file file;
+	if (!file.open(path.c_str())) {
+		fprintf(stderr, "jclassinfo: %s: unable to open\n", path.c_str());
+		++_failed;
+		return false;
+	}
+	if (jzip::format_supported(file.data(), file.size())) {
+		file.close();
+		return list_archive(path, path);
+	}
+
+	job j;
+	j.file_name = path;
+	j.archive = nullptr;
+	j.entry = 0;
+	j.path = path;
+	add(j);
+	return true;
+}
+
+
+void lister::flush()
+{
+	if (_jobs.empty())
+		return;
+
+	_pool.run(_jobs.size(), [this](size_t index, size_t worker) {
+		_valid[index] = process(_jobs[index], _workers[worker], _output[index]);
+	});
+
+	//Results are printed in input order
+	for (size_t i = 0; i < _jobs.size(); ++i) {
+		if (_valid[i])
+			fwrite(_output[i].c_str(), 1, _output[i].length(), stdout);
+		else {
+			fprintf(stderr, "jclassinfo: %s: invalid class file\n", _jobs[i].path.c_str());
+			++_failed;
+		}
+	}
+	_jobs.clear();
+}
+
+
+void lister::add(const job& j)
+{
+	_jobs.push_back(j);
+	if (_jobs.size() == CLI_BATCH_SIZE)
+		flush();
+}
+
+
+bool lister::list_archive(const native_path& file_name, const string& path)
+{
+	//Jobs of the archive must be finished before it is closed
+	flush();
+	if (_opt.cache)
+		return list_index(file_name, path);
+
+	jzip archive;
+	if (!archive.open(file_name.c_str())) {
+		fprintf(stderr, "jclassinfo: %s: invalid archive\n", path.c_str());
+		++_failed;
+		return false;
+	}
+
+	const vector<jzip::entry>& entries = archive.entries();
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (entries[i].shadowed || !has_ext(entries[i].path, ".class"))
+			continue;
+		job j;
+		j.archive = &archive;
+		j.entry = i;
+		j.path = path + "!/" + entries[i].name;
+		add(j);
+	}
+	flush();
+	return true;
+}
+
+
+bool lister::list_index(const native_path& file_name, const string& path)
+{
+	jindex index;
+	if (!index.open(file_name, _pool.size())) {
+		fprintf(stderr, "jclassinfo: %s: invalid archive\n", path.c_str());
+		++_failed;
+		return false;
+	}
+	if (index.failed()) {
+		fprintf(stderr, "jclassinfo: %s: %zu invalid class files\n", path.c_str(), index.failed());
+		_failed += index.failed();
+	}
+
+	//Indexed classes are printed in batches in archive order
+	const vector<jindex::jclass_entry>& classes = index.classes();
+	for (size_t first = 0; first < classes.size(); first += CLI_BATCH_SIZE) {
+		const size_t count = min(classes.size() - first, static_cast<size_t>(CLI_BATCH_SIZE));
+		_pool.run(count, [this, &classes, &path, first](size_t item, size_t worker) {
+			const jindex::jclass_entry& ce = classes[first + item];
+			_valid[item] = print(path + "!/" + ce.path, ce.info.name, ce.members, _workers[worker], _output[item]);
+		});
+		for (size_t i = 0; i < count; ++i) {
+			if (_valid[i])
+				fwrite(_output[i].c_str(), 1, _output[i].length(), stdout);
+			else {
+				fprintf(stderr, "jclassinfo: %s!/%s: invalid class file\n", path.c_str(), classes[first + i].path.c_str());
+				++_failed;
+			}
+		}
+	}
+	return true;
+}
+
+
+bool lister::process(const job& j, worker_state& ws, string& out) const
+{
+	out.clear();
+
+	const unsigned char* data;
+	size_t size;
+	if (j.archive) {
+		if (!j.archive->extract(j.entry, ws.buffer) || ws.buffer.empty())
+			return false;
+		data = &ws.buffer.front();
+		size = ws.buffer.size();
+	}
+	else {
+		if (!ws.file.open(j.file_name.c_str()))
+			return false;
+		data = ws.file.data();
+		size = ws.file.size();
+	}
+
+	ws.members.clear();
+	const bool rc = ws.parser.read(data, size, ws.info, ws.members);
+	//Line column is printed for every method, members list starts with methods
+	if (rc) {
+		for (size_t i = 0; i < ws.parser.methods().size(); ++i)
+			ws.members[i].line = ws.parser.first_line(i);
+	}
+	ws.file.close();
+	if (!rc)
+		return false;
+
+	return print(j.path, ws.info.name, ws.members, ws, out);
+}
+
+
+bool lister::print(const string& path, const wstring& name, const vector<jclass::jmember>& members, worker_state& ws, string& out) const
+{
+	out.clear();
+
+	wstring java_name = name;
+	if (_opt.jo_view)
+		jtformat::as_java_object(java_name);
+	string class_name;
+	jutf8::encode(java_name, class_name);
+
+	try {
+		for (vector<jclass::jmember>::const_iterator it = members.begin(); it != members.end(); ++it) {
+			if (_opt.json)
+				out += '{';
+			put_field(out, "path", path, true);
+			put_field(out, "class", class_name, false);
+			put_field(out, "kind", it->type == jclass::method ? "method" : "field", false);
+			char line[8];
+			sprintf(line, "%u", static_cast<unsigned int>(it->line));
+			put_field(out, "line", line, false, true);
+			jutf8::encode(it->name, ws.utf8);
+			put_field(out, "name", ws.utf8, false);
+			jutf8::encode(it->description, ws.utf8);
+			put_field(out, "descriptor", ws.utf8, false);
+			ws.text.resize(ws.fmt.format(*it, nullptr) + 1);
+			ws.text.resize(ws.fmt.format(*it, &ws.text[0]));
+			jutf8::encode(ws.text, ws.utf8);
+			put_field(out, "text", ws.utf8, false);
+			out += _opt.json ? "}\n" : "\n";
+		}
+	}
+	catch (exception&) {
+		//Malformed member descriptor
+		out.clear();
+		return false;
+	}
+
+	return true;
+}
+
+
+void lister::put_field(string& out, const char* key, const string& val, const bool first, const bool number /*= false*/) const
+{
+	if (_opt.json) {
+		if (!first)
+			out += ',';
+		out += '"';
+		out += key;
+		out += "\":";
+		if (number) {
+			out += val;
+			return;
+		}
+		out += '"';
+		for (size_t i = 0; i < val.length(); ++i) {
+			const unsigned char ch = static_cast<unsigned char>(val[i]);
+			if (ch == '"' || ch == '\\') {
+				out += '\\';
+				out += ch;
+			}
+			else if (ch < 0x20) {
+				char esc[8];
+				sprintf(esc, "\\u%04x", ch);
+				out += esc;
+			}
+			else
+				out += ch;
+		}
+		out += '"';
+	}
+	else {
+		if (!first)
+			out += '\t';
+		for (size_t i = 0; i < val.length(); ++i) {
+			const char ch = val[i];
+			if (ch == '\t')
+				out += "\\t";
+			else if (ch == '\n')
+				out += "\\n";
+			else if (ch == '\r')
+				out += "\\r";
+			else if (ch == '\\')
+				out += "\\\\";
+			else
+				out += ch;
+		}
+	}
+}
+
+
+bool lister::has_ext(const string& name, const char* ext)
+{
+	const size_t ext_len = strlen(ext);
+	return name.length() > ext_len && strcasecmp(name.c_str() + name.length() - ext_len, ext) == 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+	cli_options opt;
+	opt.access = opt.short_type = opt.jo_view = opt.json = opt.cache = false;
+	size_t threads = 0;
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+		if (strcmp(argv[arg], "-a") == 0)
+			opt.access = true;
+		else if (strcmp(argv[arg], "-s") == 0)
+			opt.short_type = true;
+		else if (strcmp(argv[arg], "-d") == 0)
+			opt.jo_view = true;
+		else if (strcmp(argv[arg], "-j") == 0)
+			opt.json = true;
+		else if (strcmp(argv[arg], "-c") == 0)
+			opt.cache = true;
+		else if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc)
+			threads = static_cast<size_t>(atoi(argv[++arg]));
+		else
+			break;
+	}
+	if (arg >= argc || argv[arg][0] == '-') {
+		fprintf(stderr, "Usage: %s [-a] [-s] [-d] [-j] [-c] [-t threads] path...\n", argv[0]);
+		return 1;
+	}
+
+	lister ls(opt, threads);
+	for (; arg < argc; ++arg)
+		ls.list(argv[arg]);
+	ls.flush();
+
+	return ls.failed() ? 1 : 0;
+}
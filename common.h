@@ -17,7 +17,9 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
  **************************************************************************/
 
+#ifdef _WIN32
 #include <plugin.hpp>
+#endif
 #include <assert.h>
 #include <exception>
 #include <string>
@@ -26,6 +28,8 @@
 
 using namespace std;
 
+#ifdef _WIN32
 extern const GUID			_FPG;
 extern PluginStartupInfo	_PSI;
 extern FarStandardFunctions	_FSF;
+#endif // _WIN32
@@ -0,0 +1,248 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include "dir_walker.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <shlobj.h>
+#else
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+
+bool dir_walker::walk(const native_path& root, const char* ext, const callback& fn)
+{
+	native_path dir = root;
+	while (dir.length() > 1 && (dir[dir.length() - 1] == '/' || dir[dir.length() - 1] == '\\'))
+		dir.erase(dir.length() - 1);
+	return walk_dir(dir, string(), ext, fn);
+}
+
+
+/**
+ * Check file name extension.
+ * \param name file name (UTF-8)
+ * \param ext extension (nullptr to match all)
+ * \return true if name has the extension
+ */
+static bool has_ext(const string& name, const char* ext)
+{
+	if (!ext)
+		return true;
+	const size_t ext_len = strlen(ext);
+	return name.length() > ext_len && name.compare(name.length() - ext_len, ext_len, ext) == 0;
+}
+
+
+#ifdef _WIN32
+
+bool dir_walker::is_dir(const native_path& path)
+{
+	const DWORD attr = GetFileAttributes(path.c_str());
+	return attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) != 0;
+}
+
+
+native_path dir_walker::cache_dir(const char* name)
+{
+	wchar_t path[MAX_PATH];
+	if (!SUCCEEDED(SHGetFolderPath(nullptr, CSIDL_LOCAL_APPDATA, nullptr, SHGFP_TYPE_CURRENT, path)))
+		return native_path();
+	native_path dir = path;
+	dir += L"\\JClassInfo";
+	CreateDirectory(dir.c_str(), nullptr);
+	dir += L'\\';
+	while (*name)
+		dir += static_cast<wchar_t>(*name++);
+	CreateDirectory(dir.c_str(), nullptr);
+	return dir;
+}
+
+
+bool dir_walker::replace_file(const native_path& file_name, const void* data, const size_t size)
+{
+	wchar_t suffix[32];
+	swprintf(suffix, sizeof(suffix) / sizeof(suffix[0]), L".%lu.tmp", GetCurrentProcessId());
+	const native_path tmp_name = file_name + suffix;
+
+	FILE* out = _wfopen(tmp_name.c_str(), L"wb");
+	if (!out)
+		return false;
+	bool rc = fwrite(data, 1, size, out) == size;
+	rc = (fclose(out) == 0) && rc;
+
+	rc = rc && MoveFileEx(tmp_name.c_str(), file_name.c_str(), MOVEFILE_REPLACE_EXISTING);
+	if (!rc)
+		DeleteFile(tmp_name.c_str());
+	return rc;
+}
+
+
+void dir_walker::touch(const native_path& file_name)
+{
+	const HANDLE file = CreateFile(file_name.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	SetFileTime(file, nullptr, nullptr, &now);
+	CloseHandle(file);
+}
+
+
+bool dir_walker::remove_file(const native_path& file_name)
+{
+	return DeleteFile(file_name.c_str()) != FALSE;
+}
+
+
+bool dir_walker::walk_dir(const native_path& dir, const string& rel, const char* ext, const callback& fn)
+{
+	WIN32_FIND_DATA fd;
+	const HANDLE find = FindFirstFile((dir + L"\\*").c_str(), &fd);
+	if (find == INVALID_HANDLE_VALUE)
+		return false;
+
+	do {
+		if (wcscmp(fd.cFileName, L".") == 0 || wcscmp(fd.cFileName, L"..") == 0)
+			continue;
+
+		string name;
+		const int req = WideCharToMultiByte(CP_UTF8, 0, fd.cFileName, -1, nullptr, 0, nullptr, nullptr);
+		if (req > 1) {
+			name.resize(static_cast<size_t>(req));
+			WideCharToMultiByte(CP_UTF8, 0, fd.cFileName, -1, &name[0], req, nullptr, nullptr);
+			name.resize(static_cast<size_t>(req - 1));
+		}
+
+		file f;
+		f.full_path = dir + L'\\' + fd.cFileName;
+		f.path = rel.empty() ? name : rel + '/' + name;
+		if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			walk_dir(f.full_path, f.path, ext, fn);
+		else if (has_ext(name, ext)) {
+			f.size = (static_cast<uint64_t>(fd.nFileSizeHigh) << 32) | fd.nFileSizeLow;
+			f.mtime = (static_cast<uint64_t>(fd.ftLastWriteTime.dwHighDateTime) << 32) | fd.ftLastWriteTime.dwLowDateTime;
+			fn(f);
+		}
+	}
+	while (FindNextFile(find, &fd));
+
+	FindClose(find);
+	return true;
+}
+
+#else // _WIN32
+
+bool dir_walker::is_dir(const native_path& path)
+{
+	struct stat st;
+	return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+
+native_path dir_walker::cache_dir(const char* name)
+{
+	const char* base = getenv("XDG_CACHE_HOME");
+	native_path dir;
+	if (base && *base)
+		dir = base;
+	else if ((base = getenv("HOME")) != nullptr && *base)
+		dir = native_path(base) + "/.cache";
+	else
+		return native_path();
+	mkdir(dir.c_str(), 0755);
+	dir += "/jclassinfo";
+	mkdir(dir.c_str(), 0755);
+	dir += '/';
+	dir += name;
+	mkdir(dir.c_str(), 0755);
+	return dir;
+}
+
+
+bool dir_walker::replace_file(const native_path& file_name, const void* data, const size_t size)
+{
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%ld.tmp", static_cast<long>(getpid()));
+	const native_path tmp_name = file_name + suffix;
+
+	FILE* out = fopen(tmp_name.c_str(), "wb");
+	if (!out)
+		return false;
+	bool rc = fwrite(data, 1, size, out) == size;
+	rc = (fclose(out) == 0) && rc;
+
+	rc = rc && rename(tmp_name.c_str(), file_name.c_str()) == 0;
+	if (!rc)
+		unlink(tmp_name.c_str());
+	return rc;
+}
+
+
+void dir_walker::touch(const native_path& file_name)
+{
+	utime(file_name.c_str(), nullptr);
+}
+
+
+bool dir_walker::remove_file(const native_path& file_name)
+{
+	return unlink(file_name.c_str()) == 0;
+}
+
+
+bool dir_walker::walk_dir(const native_path& dir, const string& rel, const char* ext, const callback& fn)
+{
+	DIR* d = opendir(dir.c_str());
+	if (!d)
+		return false;
+
+	while (const dirent* de = readdir(d)) {
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		file f;
+		f.full_path = dir + '/' + de->d_name;
+		f.path = rel.empty() ? string(de->d_name) : rel + '/' + de->d_name;
+
+		struct stat st;
+		if (stat(f.full_path.c_str(), &st) != 0)
+			continue;
+		if (S_ISDIR(st.st_mode))
+			walk_dir(f.full_path, f.path, ext, fn);
+		else if (S_ISREG(st.st_mode) && has_ext(f.path, ext)) {
+			f.size = static_cast<uint64_t>(st.st_size);
+			f.mtime = static_cast<uint64_t>(st.st_mtime);
+			fn(f);
+		}
+	}
+
+	closedir(d);
+	return true;
+}
+
+#endif // _WIN32
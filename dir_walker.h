@@ -0,0 +1,101 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#include "mapped_file.h"
+#include <stdint.h>
+#include <vector>
+#include <functional>
+
+using namespace std;
+
+
+class dir_walker
+{
+public:
+	//! Found file description.
+	struct file {
+		native_path	full_path;	///< Full file name
+		string		path;		///< Path relative to the walk root ('/' delimited, UTF-8)
+		uint64_t	size;		///< File size
+		uint64_t	mtime;		///< Last modification time (native units)
+	};
+
+	//! Callback for found files.
+	typedef function<void(const file& f)> callback;
+
+	/**
+	 * Walk directory tree recursively.
+	 * Files are reported as they are found, nothing is accumulated.
+	 * \param root root directory
+	 * \param ext file extension filter (e.g. ".class", nullptr for all files)
+	 * \param fn callback
+	 * \return false if root directory can not be read
+	 */
+	static bool walk(const native_path& root, const char* ext, const callback& fn);
+
+	/**
+	 * Check if path is a directory.
+	 * \param path path to check
+	 * \return true if path is an existing directory
+	 */
+	static bool is_dir(const native_path& path);
+
+	/**
+	 * Get per-user cache directory of the plug-in (created if missing).
+	 * \param name subdirectory name
+	 * \return directory path (empty if not available)
+	 */
+	static native_path cache_dir(const char* name);
+
+	/**
+	 * Replace file content atomically (write temporary file and rename it).
+	 * Readers that already mapped the old file keep their view.
+	 * \param file_name file name
+	 * \param data file content
+	 * \param size file content size
+	 * \return false if error
+	 */
+	static bool replace_file(const native_path& file_name, const void* data, const size_t size);
+
+	/**
+	 * Set file modification time to current time.
+	 * \param file_name file name
+	 */
+	static void touch(const native_path& file_name);
+
+	/**
+	 * Remove file.
+	 * \param file_name file name
+	 * \return false if error
+	 */
+	static bool remove_file(const native_path& file_name);
+
+private:
+	/**
+	 * Walk one directory.
+	 * \param dir directory full name
+	 * \param rel directory path relative to the walk root
+	 * \param ext file extension filter
+	 * \param fn callback
+	 * \return false if directory can not be read
+	 */
+	static bool walk_dir(const native_path& dir, const string& rel, const char* ext, const callback& fn);
+};
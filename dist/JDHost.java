@@ -0,0 +1,150 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.EOFException;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.PrintStream;
+import java.lang.reflect.InvocationTargetException;
+import java.lang.reflect.Method;
+
+/**
+ * Decompiler host: loads CFR and Fernflower once and serves decompilation
+ * requests of the plug-in over stdin/stdout.
+ * Started by the plug-in with Java 11+ source launcher:
+ *   java -cp cfr.jar;fernflower.jar JDHost.java [idle_timeout_ms]
+ *
+ * Every message is a frame: payload length (u32, big endian) and payload.
+ * Strings are in DataOutput.writeUTF format (u16 length, modified UTF-8).
+ * Request:  tool ("cfr", "fernflower" or "ping"), class file, output path
+ * Response: status (u8, 0 = success) and message
+ * Host sends a "ping" response when it is ready, exits on stdin close or
+ * when no request is received within the idle timeout.
+ */
+public class JDHost {
+	private static final PrintStream stdout = System.out;
+	private static volatile long lastRequest = System.currentTimeMillis();
+	private static volatile boolean busy;
+
+	public static void main(String[] args) throws Exception {
+		final long idleTimeout = args.length > 0 ? Long.parseLong(args[0]) : 0;
+		final DataInputStream in = new DataInputStream(System.in);
+		final DataOutputStream out = new DataOutputStream(stdout);
+
+		//Decompiler output to stdout must not break the protocol
+		System.setOut(System.err);
+
+		if (idleTimeout > 0) {
+			final Thread watchdog = new Thread(() -> {
+				while (true) {
+					try {
+						Thread.sleep(Math.min(idleTimeout, 1000));
+					}
+					catch (InterruptedException e) {
+						return;
+					}
+					if (!busy && System.currentTimeMillis() - lastRequest > idleTimeout)
+						System.exit(0);
+				}
+			});
+			watchdog.setDaemon(true);
+			watchdog.start();
+		}
+
+		//Decompiler classes are loaded and initialized before the host reports readiness
+		final Method cfr = Class.forName("org.benf.cfr.reader.Main").getMethod("main", String[].class);
+		final Method fernflower = Class.forName("org.jetbrains.java.decompiler.main.decompiler.ConsoleDecompiler").getMethod("main", String[].class);
+		respond(out, 0, "ping");
+
+		while (true) {
+			final byte[] frame;
+			try {
+				frame = new byte[in.readInt()];
+				in.readFully(frame);
+			}
+			catch (EOFException e) {
+				break;
+			}
+			busy = true;
+			try {
+				final DataInputStream req = new DataInputStream(new ByteArrayInputStream(frame));
+				final String tool = req.readUTF();
+				final String classFile = req.readUTF();
+				final String outPath = req.readUTF();
+				if (tool.equals("ping"))
+					respond(out, 0, "ping");
+				else if (tool.equals("cfr"))
+					respond(out, decompileCfr(cfr, classFile, outPath), tool);
+				else if (tool.equals("fernflower"))
+					respond(out, invoke(fernflower, new String[] { classFile, outPath }), tool);
+				else
+					respond(out, 1, "Unknown tool: " + tool);
+			}
+			catch (Throwable e) {
+				respond(out, 1, e.toString());
+			}
+			finally {
+				lastRequest = System.currentTimeMillis();
+				busy = false;
+			}
+		}
+	}
+
+	/**
+	 * CFR writes source to stdout, it is redirected into output file.
+	 */
+	private static int decompileCfr(Method cfr, String classFile, String outFile) throws IOException {
+		final PrintStream prev = System.out;
+		try (PrintStream file = new PrintStream(new FileOutputStream(outFile))) {
+			System.setOut(file);
+			return invoke(cfr, new String[] { classFile });
+		}
+		finally {
+			System.setOut(prev);
+		}
+	}
+
+	private static int invoke(Method main, String[] args) {
+		try {
+			main.invoke(null, (Object) args);
+			return 0;
+		}
+		catch (IllegalAccessException | InvocationTargetException e) {
+			e.printStackTrace();
+			return 1;
+		}
+	}
+
+	private static void respond(DataOutputStream out, int status, String msg) throws IOException {
+		//writeUTF fails for strings longer than 65535 bytes
+		if (msg.length() > 1024)
+			msg = msg.substring(0, 1024);
+		final ByteArrayOutputStream buf = new ByteArrayOutputStream();
+		final DataOutputStream payload = new DataOutputStream(buf);
+		payload.writeByte(status);
+		payload.writeUTF(msg);
+		out.writeInt(buf.size());
+		buf.writeTo(out);
+		out.flush();
+	}
+}
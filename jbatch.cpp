@@ -0,0 +1,313 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include "jbatch.h"
+#include "jindex.h"
+#include "jutf8.h"
+#include "dir_walker.h"
+#include "work_pool.h"
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <shlobj.h>
+
+//! Maximum number of classes in one shard
+#define JBATCH_SHARD_CLASSES	64
+//! Maximum length of decompiler command line (system limit is 32767)
+#define JBATCH_MAX_CMDLINE		30000
+//! Decompilation timeout for one class (milliseconds)
+#define JBATCH_CLASS_TIME		10000
+//! Progress report interval (milliseconds)
+#define JBATCH_PROGRESS_TIME	200
+
+
+jbatch::jbatch(const jdecompiler::decompiler jd, const wstring& java_exe, const wstring& module_path)
+:	_jd(jd), _java_exe(java_exe), _module_path(module_path), _from_archive(false), _total(0), _done(0), _cancel(false)
+{
+	assert(jd != jdecompiler::jd_javap);
+}
+
+
+bool jbatch::run(const wstring& source, const wstring& out_dir, const progress& fn, const size_t threads /*= 0*/)
+{
+	assert(!source.empty() && !out_dir.empty());
+
+	_classes.clear();
+	_shards.clear();
+	_failures.clear();
+	_staging.clear();
+	_total = 0;
+	_done = 0;
+	_cancel = false;
+
+	//Trailing backslash escapes closing quote in command line
+	wstring out_path = out_dir;
+	while (out_path.length() > 3 && out_path[out_path.length() - 1] == L'\\')
+		out_path.erase(out_path.length() - 1);
+
+	_from_archive = !dir_walker::is_dir(source);
+	if (_from_archive) {
+		if (!_archive.open(source.c_str()))
+			return false;
+
+		//Extracted classes keep package layout, decompilers find inner classes by it
+		wchar_t tmp_path[MAX_PATH];
+		if (!GetTempPath(MAX_PATH, tmp_path))
+			return false;
+		_staging = tmp_path;
+		_staging += L"JClassInfo." + to_wstring(GetCurrentProcessId()) + L'.' + to_wstring(GetTickCount());
+
+		const vector<jzip::entry>& entries = _archive.entries();
+		for (size_t i = 0; i < entries.size(); ++i) {
+			if (!jindex::is_class_entry(entries[i]))
+				continue;
+			class_item ci;
+			ci.path = entries[i].path;
+			ci.entry = i;
+			ci.file_name = file_under(_staging, ci.path);
+			_classes.push_back(ci);
+		}
+	}
+	else {
+		const bool rc = dir_walker::walk(source, ".class", [this](const dir_walker::file& f) {
+			class_item ci;
+			ci.path = f.path;
+			ci.entry = 0;
+			ci.file_name = f.full_path;
+			_classes.push_back(ci);
+		});
+		if (!rc)
+			return false;
+	}
+
+	//Classes of one package and one outer class must be adjacent
+	sort(_classes.begin(), _classes.end(), [](const class_item& a, const class_item& b) {
+		const size_t pa = a.path.rfind('/');
+		const size_t pb = b.path.rfind('/');
+		const int cmp = a.path.compare(0, pa == string::npos ? 0 : pa, b.path, 0, pb == string::npos ? 0 : pb);
+		return cmp != 0 ? cmp < 0 : a.path < b.path;
+	});
+	_total = _classes.size();
+	make_shards();
+
+	//Shards are processed by worker threads, progress is reported from the caller's thread
+	atomic<bool> finished(false);
+	thread worker([this, &out_path, &finished, threads]() {
+		work_pool pool(threads);
+		pool.run(_shards.size(), [this, &out_path](const size_t index, const size_t) {
+			run_shard(_shards[index], out_path);
+		});
+		finished = true;
+	});
+	while (!finished) {
+		if (!fn(_done, _total))
+			_cancel = true;
+		this_thread::sleep_for(chrono::milliseconds(JBATCH_PROGRESS_TIME));
+	}
+	worker.join();
+	fn(_total, _total);
+
+	if (!_staging.empty()) {
+		//Double null terminated list of one path
+		const wstring staging = _staging + L'\0';
+		SHFILEOPSTRUCT op;
+		ZeroMemory(&op, sizeof(op));
+		op.wFunc = FO_DELETE;
+		op.pFrom = staging.c_str();
+		op.fFlags = FOF_NO_UI;
+		SHFileOperation(&op);
+	}
+
+	sort(_failures.begin(), _failures.end());
+	return true;
+}
+
+
+void jbatch::make_shards()
+{
+	shard cur;
+	size_t cmd_len = 0;
+	size_t i = 0;
+	while (i < _classes.size()) {
+		const string& path = _classes[i].path;
+		const size_t pos = path.rfind('/');
+		const string package = (pos == string::npos ? string() : path.substr(0, pos));
+		const string outer = outer_class(path);
+
+		//Outer class is never split from its inner classes, the whole group must fit into command line
+		size_t group_end = i;
+		size_t group_len = 0;
+		do {
+			group_len += _classes[group_end].file_name.length() + 3;
+			++group_end;
+		} while (group_end < _classes.size() && outer_class(_classes[group_end].path) == outer);
+
+		const bool full = (i - cur.begin >= JBATCH_SHARD_CLASSES || cmd_len + group_len > JBATCH_MAX_CMDLINE);
+		if (i == 0 || package != cur.package || full) {
+			if (i != 0) {
+				cur.end = i;
+				_shards.push_back(cur);
+			}
+			cur.package = package;
+			cur.begin = i;
+			cmd_len = _module_path.length() + _java_exe.length() + MAX_PATH * 2;
+		}
+		cmd_len += group_len;
+		i = group_end;
+	}
+	if (!_classes.empty()) {
+		cur.end = _classes.size();
+		_shards.push_back(cur);
+	}
+}
+
+
+void jbatch::run_shard(const shard& s, const wstring& out_dir)
+{
+	if (_cancel) {
+		for (size_t i = s.begin; i < s.end; ++i)
+			fail(_classes[i].path, "cancelled");
+		_done += s.end - s.begin;
+		return;
+	}
+
+	//Classes that are already reported as failed are not passed to decompiler
+	vector<bool> failed(s.end - s.begin, false);
+	if (_from_archive) {
+		SHCreateDirectoryEx(nullptr, file_under(_staging, s.package).c_str(), nullptr);
+		vector<unsigned char> data;
+		for (size_t i = s.begin; i < s.end; ++i) {
+			const class_item& ci = _classes[i];
+			if (!_archive.extract(ci.entry, data) || data.empty() || !dir_walker::replace_file(ci.file_name, &data.front(), data.size())) {
+				fail(ci.path, "unable to extract");
+				failed[i - s.begin] = true;
+			}
+		}
+		if (find(failed.begin(), failed.end(), false) == failed.end()) {
+			_done += s.end - s.begin;
+			return;
+		}
+	}
+
+	wstring exe;
+	const wstring params = command(s, out_dir, failed, exe);
+	if (params.length() >= JBATCH_MAX_CMDLINE) {
+		//Outer class with too many inner classes for one process
+		for (size_t i = s.begin; i < s.end; ++i) {
+			if (!failed[i - s.begin])
+				fail(_classes[i].path, "command line too long");
+		}
+		_done += s.end - s.begin;
+		return;
+	}
+
+	//Fernflower writes sources flat into its output directory
+	SHCreateDirectoryEx(nullptr, _jd == jdecompiler::jd_fernflower ? file_under(out_dir, s.package).c_str() : out_dir.c_str(), nullptr);
+
+	const DWORD timeout = static_cast<DWORD>(JBATCH_CLASS_TIME * (s.end - s.begin));
+	const bool rc = jdecompiler::execute(exe.c_str(), params.c_str(), nullptr, 0xFFFFFFFF, timeout, &_cancel);
+
+	//Every outer class must have its source file
+	for (size_t i = s.begin; i < s.end; ++i) {
+		const string outer = outer_class(_classes[i].path);
+		if (i != s.begin && outer == outer_class(_classes[i - 1].path))
+			continue;
+		if (failed[i - s.begin])
+			continue;
+		const size_t pos = outer.rfind('/');
+		const string name = outer.substr(pos == string::npos ? 0 : pos + 1);
+		if (name == "module-info" || name == "package-info")
+			continue;
+		if (GetFileAttributes(file_under(out_dir, outer + ".java").c_str()) == INVALID_FILE_ATTRIBUTES)
+			fail(_classes[i].path, rc ? "no source produced" : (_cancel ? "cancelled" : "decompiler failed or timed out"));
+	}
+
+	_done += s.end - s.begin;
+}
+
+
+wstring jbatch::command(const shard& s, const wstring& out_dir, const vector<bool>& failed, wstring& exe) const
+{
+	wstring params;
+	switch (_jd) {
+		case jdecompiler::jd_jad:
+			exe = _module_path + L"jad.exe";
+			params = L" -nonlb -o -r -s java -d \"" + out_dir + L"\"";
+			break;
+		case jdecompiler::jd_fernflower:
+			exe = _java_exe;
+			params = L" -jar \"" + _module_path + L"fernflower.jar\"";
+			break;
+		case jdecompiler::jd_cfr:
+			exe = _java_exe;
+			params = L" -jar \"" + _module_path + L"cfr.jar\"";
+			break;
+		case jdecompiler::jd_javap:
+			break;
+	}
+
+	//JAD and CFR load inner classes next to the outer one, Fernflower needs them all
+	for (size_t i = s.begin; i < s.end; ++i) {
+		const class_item& ci = _classes[i];
+		if (failed[i - s.begin])
+			continue;
+		if (_jd != jdecompiler::jd_fernflower && outer_class(ci.path) + ".class" != ci.path)
+			continue;
+		params += L" \"";
+		params += ci.file_name;
+		params += L"\"";
+	}
+
+	if (_jd == jdecompiler::jd_fernflower)
+		params += L" \"" + file_under(out_dir, s.package) + L"\"";
+	else if (_jd == jdecompiler::jd_cfr)
+		params += L" --outputdir \"" + out_dir + L"\"";
+
+	return params;
+}
+
+
+void jbatch::fail(const string& path, const char* reason)
+{
+	assert(reason);
+	lock_guard<mutex> lock(_lock);
+	_failures.push_back(path + ": " + reason);
+}
+
+
+string jbatch::outer_class(const string& path)
+{
+	const size_t name_pos = path.rfind('/');
+	const size_t begin = (name_pos == string::npos ? 0 : name_pos + 1);
+	size_t end = path.find('$', begin);
+	if (end == string::npos || end == begin)
+		end = path.rfind('.');
+	if (end == string::npos || end < begin)
+		end = path.length();
+	return path.substr(0, end);
+}
+
+
+wstring jbatch::file_under(const wstring& dir, const string& path)
+{
+	wstring name;
+	jutf8::decode(reinterpret_cast<const unsigned char*>(path.c_str()), path.length(), name);
+	replace(name.begin(), name.end(), L'/', L'\\');
+	return name.empty() ? dir : dir + L'\\' + name;
+}
@@ -0,0 +1,142 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#include "jdecompiler.h"
+#include "jzip.h"
+#include <atomic>
+#include <mutex>
+#include <functional>
+
+
+class jbatch
+{
+public:
+	//! Progress callback: number of processed and total classes, returns false to cancel (called from the thread that runs the batch).
+	typedef function<bool(const size_t done, const size_t total)> progress;
+
+	/**
+	 * Constructor.
+	 * \param jd used decompilator (JAD, Fernflower or CFR)
+	 * \param java_exe java interpreter executable (not used by JAD)
+	 * \param module_path plug-in module path (decompilers location)
+	 */
+	jbatch(const jdecompiler::decompiler jd, const wstring& java_exe, const wstring& module_path);
+
+	/**
+	 * Decompile all classes of archive or directory tree into mirrored source tree.
+	 * Classes are split into shards by package (inner classes stay with their
+	 * outer class), every shard is decompiled by one decompiler process,
+	 * shards are processed in parallel. Cancel stops running decompilers,
+	 * classes of stopped and not started shards are reported as failed.
+	 * \param source archive file or directory name
+	 * \param out_dir output directory
+	 * \param fn progress callback
+	 * \param threads number of parallel processes (0 to use all hardware threads)
+	 * \return false if source can not be read
+	 */
+	bool run(const wstring& source, const wstring& out_dir, const progress& fn, const size_t threads = 0);
+
+	/**
+	 * Get number of classes processed by last run.
+	 * \return number of classes
+	 */
+	size_t total() const { return _total; }
+
+	/**
+	 * Get failed classes of last run.
+	 * \return failure descriptions ("path: reason", UTF-8)
+	 */
+	const vector<string>& failures() const { return _failures; }
+
+private:
+	//! Class file to decompile.
+	struct class_item {
+		string	path;		///< Class path ("a/b/C$D.class", UTF-8)
+		size_t	entry;		///< Archive entry index (archive mode)
+		wstring	file_name;	///< Class file name (directory mode or extracted file)
+	};
+
+	//! Group of classes decompiled by one process.
+	struct shard {
+		string		package;	///< Package path ("a/b", empty for default package)
+		size_t		begin;		///< First class index
+		size_t		end;		///< Index after last class
+	};
+
+	/**
+	 * Split sorted classes into shards.
+	 */
+	void make_shards();
+
+	/**
+	 * Decompile one shard.
+	 * \param s shard to decompile
+	 * \param out_dir output directory
+	 */
+	void run_shard(const shard& s, const wstring& out_dir);
+
+	/**
+	 * Get decompiler command line for shard.
+	 * \param s shard to decompile
+	 * \param out_dir output directory
+	 * \param failed flags of shard classes that are excluded (already failed)
+	 * \param exe output executable module
+	 * \return command line parameters
+	 */
+	wstring command(const shard& s, const wstring& out_dir, const vector<bool>& failed, wstring& exe) const;
+
+	/**
+	 * Add failure description.
+	 * \param path class path
+	 * \param reason failure reason
+	 */
+	void fail(const string& path, const char* reason);
+
+	/**
+	 * Get outer class path of class ("a/b/C$D.class" -> "a/b/C").
+	 * \param path class path
+	 * \return outer class path
+	 */
+	static string outer_class(const string& path);
+
+	/**
+	 * Convert class path to file name under directory.
+	 * \param dir directory name
+	 * \param path class path ('/' delimited)
+	 * \return file name
+	 */
+	static wstring file_under(const wstring& dir, const string& path);
+
+private:
+	jdecompiler::decompiler	_jd;			///< Used decompilator
+	wstring					_java_exe;		///< Java interpreter executable
+	wstring					_module_path;	///< Plug-in module path
+	jzip					_archive;		///< Source archive (archive mode)
+	bool					_from_archive;	///< Archive mode flag
+	wstring					_staging;		///< Directory for extracted classes (archive mode)
+	vector<class_item>		_classes;		///< Classes sorted by path
+	vector<shard>			_shards;		///< Shards
+	size_t					_total;			///< Number of classes
+	atomic<size_t>			_done;			///< Number of processed classes
+	atomic<bool>			_cancel;		///< Cancel request flag
+	mutex					_lock;			///< Failures lock
+	vector<string>			_failures;		///< Failed classes
+};
@@ -18,6 +18,8 @@
  **************************************************************************/
 
 #include "jclass.h"
+#include "jutf8.h"
+#include <string.h>
 
 // #define LOG(a) {FILE * f = fopen("c:\\tmp\\log.txt", "a");fprintf(f,a "\n");fclose(f);}
 // #define LOG1(a,p1) {FILE * f = fopen("c:\\tmp\\log.txt", "a");fprintf(f,a "\n",p1);fclose(f);}
@@ -36,230 +38,396 @@ bool jclass::format_supported(const unsigned char* file_hdr, const size_t file_h
 }
 
 
-bool jclass::read(const wchar_t* file_name, jclassinfo& class_info, vector<jmember>& members)
+bool jclass::read(const native_char* file_name, jclassinfo& class_info, vector<jmember>& members)
 {
 	assert(file_name && *file_name);
 
-	try {
-		if (!read_java_class(file_name))
-			return false;
-
-		map<uint16_t, wstring>::const_iterator it_string;
+	//Map file into memory, all data pointers refer directly to the mapped view
+	if (!_file.open(file_name))
+		return false;
 
-		//Fill output info for class description
-		assert(_class_name && _const_pool.size() > _class_name && _const_pool[_class_name - 1].type == CONSTANT_Class);
-		class_info.access = _class_access_flag;
-		class_info.name = get_string(be2le(_const_pool[_class_name - 1].cp_class->name_index));
-		if (class_info.name.empty())
-			class_info.name = UNKNOWN_NAME;
+	return read(_file.data(), _file.size(), class_info, members);
+}
 
-		assert(_super_class && _const_pool.size() > _super_class && _const_pool[_super_class - 1].type == CONSTANT_Class);
-		class_info.super = get_string(be2le(_const_pool[_super_class - 1].cp_class->name_index));
 
-		//Fill output info for methods and fields description
-		get_member_descr(method, members);
-		get_member_descr(field, members);
-	}
-	catch (...) {
+bool jclass::read(const unsigned char* data, const size_t size, jclassinfo& class_info, vector<jmember>& members)
+{
+	if (!read(data, size, class_info))
 		return false;
-	}
+
+	//Fill output info for methods and fields description
+	get_member_descr(method, members);
+	get_member_descr(field, members);
 
 	return true;
 }
 
 
-bool jclass::read_java_class(const wchar_t* file_name)
+bool jclass::read(const unsigned char* data, const size_t size, jclassinfo& class_info)
 {
-	assert(file_name && *file_name);
+	assert(data && size);
 
-	//Load file
-	HANDLE file = CreateFile(file_name, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-	if (file == INVALID_HANDLE_VALUE)
-		return false;
-	LARGE_INTEGER file_size;
-	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 || file_size.QuadPart > 1024 * 1024 * 1024 /* 1G */) {
-		CloseHandle(file);
+	_data = data;
+	_data_size = size;
+	_const_pool.clear();
+	_refs.clear();
+	_decoded.clear();
+
+	//Validation pass, malformed class is rejected here
+	if (!read_java_class())
 		return false;
-	}
-	_data_buff.resize(static_cast<size_t>(file_size.QuadPart));
-	DWORD bytes_read = 0;
-	if (!ReadFile(file, &_data_buff.front(), static_cast<DWORD>(file_size.QuadPart), &bytes_read, nullptr)) {
-		CloseHandle(file);
+
+	//Fill output info for class description
+	if (pool_type(_class_name) != CONSTANT_Class)
 		return false;
+	class_info.access = _class_access_flag;
+	class_info.name = get_string(be2le(pool_item<const_pool_class>(_class_name)->name_index));
+	if (class_info.name.empty())
+		class_info.name = UNKNOWN_NAME;
+
+	//java.lang.Object and module-info have no super class
+	if (_super_class && pool_type(_super_class) == CONSTANT_Class)
+		class_info.super = get_string(be2le(pool_item<const_pool_class>(_super_class)->name_index));
+	else
+		class_info.super.clear();
+
+	//Malformed interface references are skipped
+	class_info.interfaces.clear();
+	for (uint16_t i = 0; i < _interfaces_count; ++i) {
+		const uint16_t idx = get_num<uint16_t>(_interfaces + i * sizeof(uint16_t));
+		if (pool_type(idx) == CONSTANT_Class)
+			class_info.interfaces.push_back(get_string(be2le(pool_item<const_pool_class>(idx)->name_index)));
 	}
-	CloseHandle(file);
 
+	if (_source_file)
+		class_info.source = get_string(get_num<uint16_t>(_source_file));
+	else
+		class_info.source.clear();
+
+	return true;
+}
+
+
+bool jclass::read_java_class()
+{
 	_data_pos = 0;
 
 	//Header
-	const uint32_t jclass_hdr = read_num<uint32_t>();
-	if (jclass_hdr != JCLASS_HEADER)
+	uint32_t jclass_hdr;
+	if (!read_num(jclass_hdr) || jclass_hdr != JCLASS_HEADER)
 		return false;
 
 	//Minor and major version numbers of this class file
-	/*const uint16_t minor_version =*/ read(sizeof(uint16_t));
-	/*const uint16_t major_version =*/ read(sizeof(uint16_t));
+	if (!skip(2 * sizeof(uint16_t)))
+		return false;
 
 	//Table of structures representing various string constants, class e t.c.
-	read_constant_pool();
+	if (!read_constant_pool())
+		return false;
 
 	//Mask of flags used to denote access permissions to and properties of this class or interface
-	_class_access_flag = read_num<uint16_t>();
+	if (!read_num(_class_access_flag))
+		return false;
 
 	//The value of the this_class item must be a valid index into the constant_pool table
-	_class_name = read_num<uint16_t>();
+	if (!read_num(_class_name))
+		return false;
 
 	//Super class value must be zero or must be a valid index into the constant_pool table
-	_super_class = read_num<uint16_t>();
+	if (!read_num(_super_class))
+		return false;
 
 	//Super interfaces of this class or interface
-	read_interfaces();
+	if (!read_interfaces())
+		return false;
 
 	//Represent all fields, both class variables and instance variables, declared by this class or interface type
-	read_fields();
+	if (!read_members(_fields))
+		return false;
 
 	//The method info structures represent all methods declared by this class or interface type
-	read_methods();
-
-	//Not needed
-	//read_attributes();
+	if (!read_members(_methods))
+		return false;
 
-	return true;
+	//Only SourceFile is used, other class attributes are skipped
+	return read_attributes("SourceFile", sizeof(uint16_t), _source_file);
 }
 
 
-void jclass::read_constant_pool()
+bool jclass::read_constant_pool()
 {
-	const uint16_t constant_pool_count = read_num<uint16_t>();
-	for (uint16_t i = 1; i < constant_pool_count; ++i) {
-		j_const_pool pool;
-		pool.type = static_cast<const_pool_type>(read_num<uint8_t>());
-		pool.data = &_data_buff[_data_pos];
-		_const_pool.push_back(pool);
-		switch (pool.type) {
-			case CONSTANT_Class:				read(sizeof(const_pool_class)); break;
-			case CONSTANT_Fieldref:				read(sizeof(const_pool_fieldref)); break;
-			case CONSTANT_Methodref:			read(sizeof(const_pool_methodref)); break;
-			case CONSTANT_InterfaceMethodref:	read(sizeof(const_pool_interfmethodref)); break;
-			case CONSTANT_String:				read(sizeof(const_pool_string)); break;
-			case CONSTANT_Integer:				read(sizeof(const_pool_integer)); break;
-			case CONSTANT_Float:				read(sizeof(const_pool_float)); break;
+	//Only the item offsets are recorded here, items are decoded on demand
+	uint16_t constant_pool_count;
+	if (!read_num(constant_pool_count))
+		return false;
+	_const_pool.reserve(constant_pool_count);
+	for (size_t i = 1; i < constant_pool_count; ++i) {
+		_const_pool.push_back(static_cast<uint32_t>(_data_pos));
+		uint8_t type;
+		if (!read_num(type))
+			return false;
+		size_t size = 0;
+		switch (type) {
+			case CONSTANT_Class:				size = sizeof(const_pool_class); break;
+			case CONSTANT_Fieldref:				size = sizeof(const_pool_fieldref); _refs.push_back(static_cast<uint16_t>(i)); break;
+			case CONSTANT_Methodref:			size = sizeof(const_pool_methodref); _refs.push_back(static_cast<uint16_t>(i)); break;
+			case CONSTANT_InterfaceMethodref:	size = sizeof(const_pool_interfmethodref); _refs.push_back(static_cast<uint16_t>(i)); break;
+			case CONSTANT_String:				size = sizeof(const_pool_string); break;
+			case CONSTANT_Integer:				size = sizeof(const_pool_integer); break;
+			case CONSTANT_Float:				size = sizeof(const_pool_float); break;
 			case CONSTANT_Long:
-				read(sizeof(const_pool_long));
-				//Phantom pool item
-				_const_pool.push_back(j_const_pool());
-				i++;
-				break;
 			case CONSTANT_Double:
-				read(sizeof(const_pool_double));
+				size = sizeof(const_pool_long);
 				//Phantom pool item
-				_const_pool.push_back(j_const_pool());
+				_const_pool.push_back(0);
 				i++;
 				break;
-			case CONSTANT_NameAndType:			read(sizeof(const_pool_nameandtype)); break;
-			case CONSTANT_Utf8:					read(read_num<uint16_t>()); break;
-			case CONSTANT_MethodHandle:         read(sizeof(const_pool_method_handle)); break;
-			case CONSTANT_MethodType:           read(sizeof(const_pool_method_type)); break;
-			case CONSTANT_InvokeDynamic:        read(sizeof(const_pool_invoke_dynamic)); break;
-			default: {
-				throw exception();
+			case CONSTANT_NameAndType:			size = sizeof(const_pool_nameandtype); break;
+			case CONSTANT_Utf8: {
+				uint16_t len;
+				if (!read_num(len))
+					return false;
+				size = len;
+				break;
 			}
+			case CONSTANT_MethodHandle:         size = sizeof(const_pool_method_handle); break;
+			case CONSTANT_MethodType:           size = sizeof(const_pool_method_type); break;
+			case CONSTANT_InvokeDynamic:        size = sizeof(const_pool_invoke_dynamic); break;
+			default:
+				return false;
 		}
+		if (!skip(size))
+			return false;
 	}
+
+	//String objects are kept between classes to reuse their buffers
+	_decoded.assign(_const_pool.size(), false);
+	if (_strings.size() < _const_pool.size())
+		_strings.resize(_const_pool.size());
+
+	return true;
 }
 
 
-void jclass::read_interfaces()
+bool jclass::read_interfaces()
 {
-	const uint16_t interfaces_count = read_num<uint16_t>();
-	for (uint16_t i = 0; i < interfaces_count; ++i) {
-		//Ignore all
-		/*const uint16_t name_index =*/ read(sizeof(uint16_t));
-	}
+	//Only the table offset is recorded, names are resolved by read()
+	if (!read_num(_interfaces_count))
+		return false;
+	_interfaces = static_cast<uint32_t>(_data_pos);
+	return skip(_interfaces_count * sizeof(uint16_t));
 }
 
 
-void jclass::read_fields()
+bool jclass::read_members(jmember_table& table)
 {
-	const uint16_t fields_count = read_num<uint16_t>();
-	for (uint16_t i = 0; i < fields_count; ++i) {
-		j_field f;
-		f.access_flag = read_num<uint16_t>();
-		f.name_index = read_num<uint16_t>();
-		f.descriptor_index = read_num<uint16_t>();
-		read_attributes();
-		_fields.insert(make_pair(i, f));
+	uint16_t count;
+	if (!read_num(count))
+		return false;
+	table.resize(count);
+	for (uint16_t i = 0; i < count; ++i) {
+		if (!read_num(table.access_flags[i]) ||
+			!read_num(table.name_index[i]) ||
+			!read_num(table.descriptor_index[i]) ||
+			!read_attributes("Code", 2 * sizeof(uint16_t) + sizeof(uint32_t) + 2 * sizeof(uint16_t), table.code_offset[i]))
+			return false;
 	}
+	return true;
 }
 
 
-void jclass::read_methods()
+bool jclass::read_attributes(const char* name, const uint32_t min_size, uint32_t& offset)
 {
-	const uint16_t methods_count = read_num<uint16_t>();
-	for (uint16_t i = 0; i < methods_count; ++i) {
-		j_method m;
-		m.access_flag = read_num<uint16_t>();
-		m.name_index = read_num<uint16_t>();
-		m.descriptor_index = read_num<uint16_t>();
-		read_attributes();
-		_methods.insert(make_pair(i, m));
+	//Attribute data is not parsed here, only the offset of the requested one is recorded
+	offset = 0;
+	uint16_t attributes_count;
+	if (!read_num(attributes_count))
+		return false;
+	for (uint16_t i = 0; i < attributes_count; ++i) {
+		uint16_t attribute_name_index;
+		uint32_t attribute_length;
+		if (!read_num(attribute_name_index) || !read_num(attribute_length))
+			return false;
+		const size_t pos = _data_pos;
+		if (!skip(attribute_length))
+			return false;
+		if (!offset && attribute_length >= min_size && utf8_equal(attribute_name_index, name))
+			offset = static_cast<uint32_t>(pos);
 	}
+	return true;
 }
 
 
-void jclass::read_attributes()
+bool jclass::check_code(const size_t pos, const uint32_t size) const
 {
-	const uint16_t attributes_count = read_num<uint16_t>();
+	//Code attribute: max_stack, max_locals, code, exception table, attributes
+	const size_t end = pos + size;
+	size_t cur = pos + 2 * sizeof(uint16_t);
+	const uint32_t code_length = get_num<uint32_t>(cur);
+	cur += sizeof(uint32_t);
+	if (code_length > end - cur || sizeof(uint16_t) > end - cur - code_length)
+		return false;
+	cur += code_length;
+	const size_t exception_table_size = get_num<uint16_t>(cur) * 4 * sizeof(uint16_t);
+	cur += sizeof(uint16_t);
+	if (end - cur < exception_table_size + sizeof(uint16_t))
+		return false;
+	cur += exception_table_size;
+	const uint16_t attributes_count = get_num<uint16_t>(cur);
+	cur += sizeof(uint16_t);
 	for (uint16_t i = 0; i < attributes_count; ++i) {
-		//Ignore all
-		/*const uint16_t attribute_name_index =*/ read(sizeof(uint16_t));
-		const uint32_t attribute_length = read_num<uint32_t>();
-		/*const unsigned char* info =*/ read(attribute_length);
+		if (end - cur < sizeof(uint16_t) + sizeof(uint32_t))
+			return false;
+		const uint16_t attribute_name_index = get_num<uint16_t>(cur);
+		const uint32_t attribute_length = get_num<uint32_t>(cur + sizeof(uint16_t));
+		cur += sizeof(uint16_t) + sizeof(uint32_t);
+		if (end - cur < attribute_length)
+			return false;
+		if (utf8_equal(attribute_name_index, "LineNumberTable") &&
+			(attribute_length < sizeof(uint16_t) || sizeof(uint16_t) + get_num<uint16_t>(cur) * 2 * sizeof(uint16_t) > attribute_length))
+			return false;
+		cur += attribute_length;
 	}
+	return true;
+}
+
+
+bool jclass::utf8_equal(const uint16_t index, const char* val) const
+{
+	if (pool_type(index) != CONSTANT_Utf8)
+		return false;
+	const const_pool_utf8* utf8 = pool_item<const_pool_utf8>(index);
+	const size_t len = strlen(val);
+	return be2le(utf8->length) == len && memcmp(&utf8->bytes, val, len) == 0;
 }
 
 
-wstring jclass::get_string(const uint16_t index) const
+uint16_t jclass::first_line(const size_t index) const
 {
-	assert(index);
-	const j_const_pool& pool_item = _const_pool[index - 1];
-	assert(pool_item.type == CONSTANT_Utf8);
-	const uint16_t length = be2le(pool_item.cp_utf8->length);
-	assert(length);
-
-	wstring wide;
-	const int req = MultiByteToWideChar(CP_UTF8, 0, reinterpret_cast<const char*>(&pool_item.cp_utf8->bytes), static_cast<int>(length), nullptr, 0);
-	if (req) {
-		wide.resize(static_cast<size_t>(req));
-		MultiByteToWideChar(CP_UTF8, 0, reinterpret_cast<const char*>(&pool_item.cp_utf8->bytes), static_cast<int>(length), &wide.front(), req);
+	assert(index < _methods.size());
+
+	//Code attribute is checked here, not by validation pass: malformed one only loses line numbers
+	size_t pos = _methods.code_offset[index];
+	if (!pos || !check_code(pos, get_num<uint32_t>(pos - sizeof(uint32_t))))
+		return 0;
+
+	uint16_t line = 0;
+	pos += 2 * sizeof(uint16_t);
+	pos += sizeof(uint32_t) + get_num<uint32_t>(pos);
+	pos += sizeof(uint16_t) + get_num<uint16_t>(pos) * 4 * sizeof(uint16_t);
+	const uint16_t attributes_count = get_num<uint16_t>(pos);
+	pos += sizeof(uint16_t);
+	for (uint16_t i = 0; i < attributes_count; ++i) {
+		const uint16_t attribute_name_index = get_num<uint16_t>(pos);
+		const uint32_t attribute_length = get_num<uint32_t>(pos + sizeof(uint16_t));
+		pos += sizeof(uint16_t) + sizeof(uint32_t);
+		if (utf8_equal(attribute_name_index, "LineNumberTable")) {
+			//Table may be split into several attributes, entries are not sorted
+			const uint16_t count = get_num<uint16_t>(pos);
+			for (uint16_t j = 0; j < count; ++j) {
+				const uint16_t line_number = get_num<uint16_t>(pos + sizeof(uint16_t) + j * 2 * sizeof(uint16_t) + sizeof(uint16_t));
+				if (line_number && (!line || line_number < line))
+					line = line_number;
+			}
+		}
+		pos += attribute_length;
 	}
+
+	return line;
+}
+
+
+const wstring& jclass::get_string(const uint16_t index) const
+{
+	static const wstring empty;
+	if (pool_type(index) != CONSTANT_Utf8 || index > _decoded.size())
+		return empty;
+
+	wstring& wide = _strings[index - 1];
+	if (_decoded[index - 1])
+		return wide;
+	_decoded[index - 1] = true;
+
+	const const_pool_utf8* utf8 = pool_item<const_pool_utf8>(index);
+	jutf8::decode(reinterpret_cast<const unsigned char*>(&utf8->bytes), be2le(utf8->length), wide);
 	return wide;
 }
 
 
-void jclass::get_member_descr(const jmember_type type, vector<jmember>& members) const
+jclass::const_pool_type jclass::pool_type(const uint16_t index) const
 {
-	map<uint16_t, j_method>::const_iterator it_b = (type == method ? _methods.begin() : _fields.begin());
-	map<uint16_t, j_method>::const_iterator it_e = (type == method ? _methods.end() : _fields.end());
-	for (map<uint16_t, j_method>::const_iterator it = it_b; it != it_e; ++it) {
-		jmember met;
-		met.name = get_string(it->second.name_index);
-		if (met.name.empty())
-			met.name = UNKNOWN_NAME;
-		met.description = get_string(it->second.descriptor_index);
-		met.access = it->second.access_flag;
-		met.type = type;
-		members.push_back(met);
-	}
+	if (!index || index > _const_pool.size() || !_const_pool[index - 1])
+		return CONSTANT_Phantom;
+	return static_cast<const_pool_type>(_data[_const_pool[index - 1]]);
 }
 
 
-const unsigned char* jclass::read(const size_t len)
+void jclass::get_member(const jmember_type type, const size_t index, jmember& member) const
 {
-	if (_data_pos + len >= _data_buff.size()) {
-		throw exception();
+	const jmember_table& table = (type == method ? _methods : _fields);
+	assert(index < table.size());
+	member.name = member_name(type, index);
+	member.description = member_descriptor(type, index);
+	member.access = table.access_flags[index];
+	member.type = type;
+	//Line numbers are resolved by first_line only when they are needed
+	member.line = 0;
+}
+
+
+const wstring& jclass::member_name(const jmember_type type, const size_t index) const
+{
+	const jmember_table& table = (type == method ? _methods : _fields);
+	assert(index < table.size());
+	static const wstring unknown_name(UNKNOWN_NAME);
+	const wstring& name = get_string(table.name_index[index]);
+	return name.empty() ? unknown_name : name;
+}
+
+
+const wstring& jclass::member_descriptor(const jmember_type type, const size_t index) const
+{
+	const jmember_table& table = (type == method ? _methods : _fields);
+	assert(index < table.size());
+	return get_string(table.descriptor_index[index]);
+}
+
+
+void jclass::get_refs(vector<jref>& refs) const
+{
+	refs.reserve(refs.size() + _refs.size());
+	for (vector<uint16_t>::const_iterator it = _refs.begin(); it != _refs.end(); ++it) {
+		//Fieldref, Methodref and InterfaceMethodref have the same layout
+		const const_pool_fieldref* ref = pool_item<const_pool_fieldref>(*it);
+		const uint16_t class_index = be2le(ref->class_index);
+		const uint16_t nat_index = be2le(ref->name_and_type_index);
+		if (pool_type(class_index) != CONSTANT_Class || pool_type(nat_index) != CONSTANT_NameAndType)
+			continue;
+		const const_pool_nameandtype* nat = pool_item<const_pool_nameandtype>(nat_index);
+		jref r;
+		r.owner = get_string(be2le(pool_item<const_pool_class>(class_index)->name_index));
+		r.name = get_string(be2le(nat->name_index));
+		r.description = get_string(be2le(nat->descriptor_index));
+		if (!r.owner.empty() && !r.name.empty() && !r.description.empty())
+			refs.push_back(r);
 	}
-	const unsigned char* data = &_data_buff[_data_pos];
+}
+
+
+void jclass::get_member_descr(const jmember_type type, vector<jmember>& members) const
+{
+	const size_t count = (type == method ? _methods : _fields).size();
+	size_t idx = members.size();
+	members.resize(idx + count);
+	for (size_t i = 0; i < count; ++i)
+		get_member(type, i, members[idx++]);
+}
+
+
+bool jclass::skip(const size_t len)
+{
+	if (len > _data_size - _data_pos)
+		return false;
 	_data_pos += len;
-	return data;
+	return true;
 }
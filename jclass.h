@@ -20,8 +20,17 @@
 #pragma once
 
 #include "common.h"
-
-#pragma pack(push,1)
+#include "mapped_file.h"
+#include <stdint.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <stdlib.h>
+#define JCLASS_BSWAP16(v)	_byteswap_ushort(v)
+#define JCLASS_BSWAP32(v)	_byteswap_ulong(v)
+#else
+#define JCLASS_BSWAP16(v)	__builtin_bswap16(v)
+#define JCLASS_BSWAP32(v)	__builtin_bswap32(v)
+#endif
 
 class jclass
 {
@@ -30,6 +39,8 @@ public:
 	struct jclassinfo {
 		wstring name;		///< This class name
 		wstring super;		///< Super class name
+		vector<wstring> interfaces;	///< Direct super interface names
+		wstring source;		///< Source file name (SourceFile attribute, empty if absent)
 		uint16_t access;	///< Access (ACC_*)
 	};
 
@@ -45,6 +56,40 @@ public:
 		wstring name;			///< Method name
 		wstring description;	///< Method description
 		uint16_t access;		///< Access (ACC_*)
+		uint16_t line;			///< First source line of method (0 unless resolved with first_line)
+	};
+
+	//! Reference to field or method of (other) class (CONSTANT_Fieldref, Methodref, InterfaceMethodref).
+	struct jref {
+		wstring owner;			///< Referenced class name
+		wstring name;			///< Member name
+		wstring description;	///< Member description
+	};
+
+	//! Class members table (structure of arrays, indexed by member number).
+	struct jmember_table {
+		vector<uint16_t> access_flags;		///< Access flags (ACC_*)
+		vector<uint16_t> name_index;		///< Name index in constant pool
+		vector<uint16_t> descriptor_index;	///< Descriptor index in constant pool
+		vector<uint32_t> code_offset;		///< Code attribute data offset (0 if absent)
+
+		/**
+		 * Allocate table.
+		 * \param count number of members
+		 */
+		void resize(const size_t count)
+		{
+			access_flags.resize(count);
+			name_index.resize(count);
+			descriptor_index.resize(count);
+			code_offset.resize(count);
+		}
+
+		/**
+		 * Get number of members.
+		 * \return number of members
+		 */
+		size_t size() const { return access_flags.size(); }
 	};
 
 	/**
@@ -62,61 +107,187 @@ public:
 	 * \param members class members description array
 	 * \return false if error
 	 */
-	bool read(const wchar_t* file_name, jclassinfo& class_info, vector<jmember>& members);
+	bool read(const native_char* file_name, jclassinfo& class_info, vector<jmember>& members);
+
+	/**
+	 * Read java class from memory.
+	 * The data must stay valid while the class description is used.
+	 * \param data class file content
+	 * \param size class file content size
+	 * \param class_info class description
+	 * \param members class members description array
+	 * \return false if error
+	 */
+	bool read(const unsigned char* data, const size_t size, jclassinfo& class_info, vector<jmember>& members);
+
+	/**
+	 * Read java class from memory without member descriptions.
+	 * Members are available through methods(), fields() and member_name(),
+	 * strings are decoded only for the members actually looked at.
+	 * \param data class file content
+	 * \param size class file content size
+	 * \param class_info class description
+	 * \return false if error
+	 */
+	bool read(const unsigned char* data, const size_t size, jclassinfo& class_info);
+
+	/**
+	 * Get methods table of the last read class.
+	 * \return methods table
+	 */
+	const jmember_table& methods() const	{ return _methods; }
+
+	/**
+	 * Get fields table of the last read class.
+	 * \return fields table
+	 */
+	const jmember_table& fields() const		{ return _fields; }
+
+	/**
+	 * Get member description from the table of the last read class.
+	 * \param type member type
+	 * \param index member index in the table
+	 * \param member output member description
+	 */
+	void get_member(const jmember_type type, const size_t index, jmember& member) const;
+
+	/**
+	 * Get member name from the table of the last read class.
+	 * \param type member type
+	 * \param index member index in the table
+	 * \return member name (decoded once per constant pool entry)
+	 */
+	const wstring& member_name(const jmember_type type, const size_t index) const;
+
+	/**
+	 * Get member descriptor from the table of the last read class.
+	 * \param type member type
+	 * \param index member index in the table
+	 * \return member descriptor (decoded once per constant pool entry)
+	 */
+	const wstring& member_descriptor(const jmember_type type, const size_t index) const;
+
+	/**
+	 * Get first source line of method from the last read class.
+	 * The Code attribute is checked and LineNumberTable is parsed on every call.
+	 * \param index method index in the table
+	 * \return first source line (0 if class has no line numbers)
+	 */
+	uint16_t first_line(const size_t index) const;
+
+	/**
+	 * Get field and method references of the last read class.
+	 * Malformed references are skipped.
+	 * \param refs output references array (appended)
+	 */
+	void get_refs(vector<jref>& refs) const;
 
 private:
+	//! Constant pool types
+	enum const_pool_type {
+		CONSTANT_Phantom = 0,	//This type used as phantom item (without data)
+		CONSTANT_Class = 7,
+		CONSTANT_Fieldref = 9,
+		CONSTANT_Methodref = 10,
+		CONSTANT_InterfaceMethodref = 11,
+		CONSTANT_String = 8,
+		CONSTANT_Integer = 3,
+		CONSTANT_Float = 4,
+		CONSTANT_Long = 5,
+		CONSTANT_Double = 6,
+		CONSTANT_NameAndType = 12,
+		CONSTANT_Utf8 = 1,
+		CONSTANT_MethodHandle = 15,
+		CONSTANT_MethodType = 16,
+		CONSTANT_InvokeDynamic = 18
+	};
+
 	/**
 	 * Convert number from Big endian to Little endian.
 	 * \param v source value (BE)
 	 * \return LE value
 	 */
-	template<class T> static T be2le(const T v)
-	{
-		const unsigned char* data = reinterpret_cast<const unsigned char*>(&v);
-		T t = 0;
-		for (size_t i = 0; i < sizeof(T); ++i)
-			t |= T(data[sizeof(T) - 1 - i]) << (i << 3);
-		return t;
-	}
+	static uint8_t be2le(const uint8_t v)		{ return v; }
+	static uint16_t be2le(const uint16_t v)	{ return JCLASS_BSWAP16(v); }
+	static uint32_t be2le(const uint32_t v)	{ return JCLASS_BSWAP32(v); }
 
 	/**
-	 * Read java class file.
-	 * \param file_name class file name
-	 * \return false if error
+	 * Read java class data.
+	 * This is the validation pass: every offset recorded here is proven to be
+	 * inside the data, so the extraction reads it without bounds checks.
+	 * \return false if class is malformed
 	 */
-	bool read_java_class(const wchar_t* file_name);
+	bool read_java_class();
 
 	/**
 	 * Read constant pool description.
+	 * \return false if class is malformed
 	 */
-	void read_constant_pool();
+	bool read_constant_pool();
 
 	/**
 	 * Read interfaces description.
+	 * \return false if class is malformed
 	 */
-	void read_interfaces();
+	bool read_interfaces();
 
 	/**
-	 * Read fields description.
+	 * Read fields or methods description.
+	 * \param table output members table
+	 * \return false if class is malformed
 	 */
-	void read_fields();
+	bool read_members(jmember_table& table);
 
 	/**
-	 * Read methods description.
+	 * Read attributes description.
+	 * \param name attribute name to look for
+	 * \param min_size minimal data size of the attribute to look for
+	 * \param offset output offset of the found attribute data (0 if absent)
+	 * \return false if class is malformed
 	 */
-	void read_methods();
+	bool read_attributes(const char* name, const uint32_t min_size, uint32_t& offset);
 
 	/**
-	 * Read attributes description.
+	 * Check Code attribute structure, first_line walks it without bounds checks.
+	 * \param pos attribute data offset
+	 * \param size attribute data size
+	 * \return false if attribute is malformed
+	 */
+	bool check_code(const size_t pos, const uint32_t size) const;
+
+	/**
+	 * Check constant pool string value.
+	 * \param index string index
+	 * \param val expected value (ASCII)
+	 * \return true if string is equal to value
 	 */
-	void read_attributes();
+	bool utf8_equal(const uint16_t index, const char* val) const;
 
 	/**
 	 * Get string by index from string table.
+	 * The string is decoded on first use and cached.
 	 * \param index string index
 	 * \return value
 	 */
-	wstring get_string(const uint16_t index) const;
+	const wstring& get_string(const uint16_t index) const;
+
+	/**
+	 * Get constant pool item type.
+	 * \param index constant pool index
+	 * \return item type
+	 */
+	const_pool_type pool_type(const uint16_t index) const;
+
+	/**
+	 * Get constant pool item data.
+	 * \param index constant pool index
+	 * \return pointer to the item data (follows the tag byte)
+	 */
+	template<class T> const T* pool_item(const uint16_t index) const
+	{
+		assert(index && index <= _const_pool.size() && _const_pool[index - 1]);
+		return reinterpret_cast<const T*>(_data + _const_pool[index - 1] + 1);
+	}
 
 	/**
 	 * Get members description.
@@ -127,50 +298,42 @@ private:
 
 	/**
 	 * Read number from buffer with byte order swap (Big endian (Java) to Little endian).
+	 * \param v output number
+	 * \return false if number is out of data bounds
+	 */
+	template<class T> bool read_num(T& v)
+	{
+		if (sizeof(T) > _data_size - _data_pos)
+			return false;
+		v = get_num<T>(_data_pos);
+		_data_pos += sizeof(T);
+		return true;
+	}
+
+	/**
+	 * Get number at specified position without moving read position.
+	 * The position must be checked by validation pass.
+	 * \param pos data position
 	 * \return number
 	 */
-	template<class T> T read_num()
+	template<class T> T get_num(const size_t pos) const
 	{
-		const unsigned char* data = read(sizeof(T));
-		return be2le(*reinterpret_cast<const T*>(data));
+		assert(pos + sizeof(T) <= _data_size);
+		T v;
+		memcpy(&v, _data + pos, sizeof(T));	//Unaligned read
+		return be2le(v);
 	}
 
 	/**
-	 * Read data from buffer.
+	 * Skip data in buffer.
 	 * \param len data length
-	 * \return pointer to data
+	 * \return false if data is out of bounds
 	 */
-	const unsigned char* read(const size_t len);
+	bool skip(const size_t len);
 
 private:
-	//! Constant pool types
-	enum const_pool_type {
-		CONSTANT_Phantom = 0,	//This type used as phantom item (without data)
-		CONSTANT_Class = 7,
-		CONSTANT_Fieldref = 9,
-		CONSTANT_Methodref = 10,
-		CONSTANT_InterfaceMethodref = 11,
-		CONSTANT_String = 8,
-		CONSTANT_Integer = 3,
-		CONSTANT_Float = 4,
-		CONSTANT_Long = 5,
-		CONSTANT_Double = 6,
-		CONSTANT_NameAndType = 12,
-		CONSTANT_Utf8 = 1,
-		CONSTANT_MethodHandle = 15,
-		CONSTANT_MethodType = 16,
-		CONSTANT_InvokeDynamic = 18
-	};
-
-	//! Method description
-	struct j_method {
-		uint16_t access_flag;
-		uint16_t name_index;
-		uint16_t descriptor_index;
-	};
-
-	//! Field description
-	typedef j_method j_field;
+	//Constant pool items are read in place from class data
+#pragma pack(push,1)
 
 	//! Constant pool item description
 	struct const_pool_class {
@@ -240,40 +403,25 @@ private:
 		uint16_t name_and_type_index;
 	};
 
-	//! Constant pool description
-	struct j_const_pool {
-		j_const_pool() : type(CONSTANT_Phantom), data(NULL) {}
-		const_pool_type type;
-		union {
-			const unsigned char* data;
-			const const_pool_class* cp_class;
-			const const_pool_fieldref* cp_fieldref;
-			const const_pool_methodref* cp_methodref;
-			const const_pool_interfmethodref* cp_interfmethodref;
-			const const_pool_string* cp_string;
-			const const_pool_integer* cp_integer;
-			const const_pool_float* cp_float;
-			const const_pool_long* cp_long;
-			const const_pool_double* cp_double;
-			const const_pool_nameandtype* cp_nameandtype;
-			const const_pool_utf8* cp_utf8;
-			const const_pool_method_handle* cp_method_handle;
-			const const_pool_method_type* cp_method_type;
-			const const_pool_invoke_dynamic* cp_invoke_dynamic;
-		};
-	};
+#pragma pack(pop)
 
 private:
-	vector<unsigned char>	_data_buff;	///< File content buffer
+	mapped_file				_file;		///< Mapped class file
+	const unsigned char*	_data;		///< File content (mapped view or caller buffer)
+	size_t					_data_size;	///< File content size
 	size_t					_data_pos;	///< Position in buffer
 
 	uint16_t	_class_access_flag;		///< Class access flags
 	uint16_t	_class_name;			///< Reference to index from constant pool described this class name
 	uint16_t	_super_class;			///< Reference to index from constant pool described this super name
-
-	map<uint16_t, j_field> _fields;		///< Class fields description
-	map<uint16_t, j_method> _methods;	///< Class methods description
-	vector<j_const_pool> _const_pool;	///< Constant pool description
+	uint32_t	_source_file;			///< SourceFile attribute data offset (0 if absent)
+	uint32_t	_interfaces;			///< Interfaces table data offset
+	uint16_t	_interfaces_count;		///< Number of interfaces
+
+	jmember_table _fields;				///< Class fields description
+	jmember_table _methods;				///< Class methods description
+	vector<uint32_t> _const_pool;		///< Constant pool items offsets (0 for phantom items)
+	vector<uint16_t> _refs;				///< Constant pool indexes of field and method references
+	mutable vector<wstring> _strings;	///< Decoded strings cache (indexed as constant pool)
+	mutable vector<bool> _decoded;		///< Decoded strings bitmap (indexed as constant pool)
 };
-
-#pragma pack(pop)
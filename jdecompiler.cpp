@@ -18,53 +18,88 @@
  **************************************************************************/
 
 #include "jdecompiler.h"
-#include "jtformat.h"
+#include "jbatch.h"
+#include "jtoolchain.h"
+#include "dir_walker.h"
+#include "settings.h"
+#include "source_cache.h"
 #include "version.h"
 #include <shlobj.h>
-#include <fstream>
-#include <regex>
+#include <stdio.h>
 
-#define DECOMPILER_WAITTIME	10000
+//! Progress update interval (milliseconds)
+#define DECOMPILER_POLLTIME	100
+//! Decompiler output pipe buffer size
+#define DECOMPILER_PIPESIZE	0x10000
+
+jdhost jdecompiler::_host;
+
+
+jdecompiler::jdecompiler()
+:	_source_saved(false), _timeout(DECOMPILER_WAITTIME), _cancel(false), _finished(false), _job_rc(false), _job_jd(jd_jad), _background(false)
+{
+}
+
+
+jdecompiler::~jdecompiler()
+{
+	abandon();
+}
 
 
 bool jdecompiler::decompile(const wchar_t* file_name, const decompiler jd)
 {
 	assert(file_name && file_name[0]);
 
-	if (jd != jd_jad && _java_bin_path.empty() && !find_java_bin(_java_bin_path)) {
-		const wchar_t* msg[] = { TEXT(PLUGIN_NAME), L"Unable to decompile class file: Java interpreter not found" };
-		_PSI.Message(&_FPG, &_FPG, FMSG_WARNING | FMSG_MB_OK, nullptr, msg, sizeof(msg) / sizeof(msg[0]), 0);
-		return false;
-	}
+	//Background job for the same class is taken over unless it has already failed
+	const bool attach = _worker.joinable() && _job_file == file_name && _job_jd == jd && !(_finished && !_job_rc);
+	if (!attach) {
+		abandon();
 
-	bool rc = false;
+		//The same class decompiled by the same decompiler is taken from cache
+		if (from_cache(file_name, jd))
+			return true;
+
+		//Java is needed by per-class fallback even if the host is running
+		if (jd != jd_jad && !jtoolchain::java_bin(_java_bin_path)) {
+			const wchar_t* msg[] = { TEXT(PLUGIN_NAME), L"Unable to decompile class file: Java interpreter not found" };
+			_PSI.Message(&_FPG, &_FPG, FMSG_WARNING | FMSG_MB_OK, nullptr, msg, sizeof(msg) / sizeof(msg[0]), 0);
+			return false;
+		}
+		if (jd == jd_javap && !jtoolchain::jdk_bin(_javac_bin_path)) {
+			const wchar_t* msg[] = { TEXT(PLUGIN_NAME), L"Unable to decompile class file: JDK not found" };
+			_PSI.Message(&_FPG, &_FPG, FMSG_WARNING | FMSG_MB_OK, nullptr, msg, sizeof(msg) / sizeof(msg[0]), 0);
+			return false;
+		}
+
+		start_job(file_name, jd, false);
+	}
 
 	_PSI.AdvControl(&_FPG, ACTL_SETPROGRESSSTATE, TBPF_INDETERMINATE, nullptr);
-	const wchar_t* msg[] = { TEXT(PLUGIN_NAME), L"Decompilation in progress..." };
-	_PSI.Message(&_FPG, &_FPG, FMSG_NONE, nullptr, msg, sizeof(msg) / sizeof(msg[0]), 0);
 
-	switch (jd) {
-		case jd_jad: rc = decompile_jad(file_name); break;
-		case jd_fernflower: rc = decompile_fernflower(file_name); break;
-		case jd_cfr: rc = decompile_cfr(file_name); break;
-		case jd_javap: rc = decompile_javap(file_name); break;
+	//Decompiler runs on worker thread, UI thread reports progress and handles Esc
+	const ULONGLONG start_time = GetTickCount64();
+	while (!_finished) {
+		if (!_cancel && esc_pressed())
+			_cancel = true;
+		const wstring state = L"Decompilation in progress... " + to_wstring((GetTickCount64() - start_time) / 1000) + L" s";
+		const wchar_t* msg[] = { TEXT(PLUGIN_NAME), state.c_str(), _cancel ? L"Cancelling..." : L"Press Esc to cancel" };
+		_PSI.Message(&_FPG, &_FPG, FMSG_NONE, nullptr, msg, sizeof(msg) / sizeof(msg[0]), 0);
+		Sleep(DECOMPILER_POLLTIME);
 	}
+	_worker.join();
+	const bool rc = _job_rc && !_cancel;
 
 	_PSI.AdvControl(&_FPG, ACTL_PROGRESSNOTIFY, 0, nullptr);
 	_PSI.AdvControl(&_FPG, ACTL_SETPROGRESSSTATE, TBPF_NOPROGRESS, nullptr);
 	_PSI.PanelControl(PANEL_ACTIVE, FCTL_REDRAWPANEL, 0, nullptr);
 	_PSI.PanelControl(PANEL_PASSIVE, FCTL_REDRAWPANEL, 0, nullptr);
 
-	if (!rc) {
+	if (!rc && !_cancel) {
 		wstring err_msg = TEXT(PLUGIN_NAME);
 		err_msg += L'\n';
 		err_msg += L"Unable to decompile class file with ";
-		switch (jd) {
-			case jd_jad: err_msg += L"JAD"; break;
-			case jd_fernflower: err_msg += L"Fernflower"; break;
-			case jd_cfr: err_msg += L"CFR"; break;
-			case jd_javap: err_msg += L"javap"; break;
-		}
+		err_msg += name(jd);
 		_PSI.Message(&_FPG, &_FPG, FMSG_ALLINONE | FMSG_WARNING | FMSG_MB_OK, nullptr, reinterpret_cast<const wchar_t* const*>(err_msg.c_str()), 0, 0);
 	}
 
@@ -72,57 +107,248 @@ bool jdecompiler::decompile(const wchar_t* file_name, const decompiler jd)
 }
 
 
+void jdecompiler::prefetch(const wchar_t* file_name, const decompiler jd)
+{
+	assert(file_name && file_name[0]);
+
+	abandon();
+
+	//Runtime lookup may discover runtimes and save settings, worker thread only checks the result
+	if (jd != jd_jad && !jtoolchain::java_bin(_java_bin_path))
+		_java_bin_path.clear();
+	if (jd == jd_javap && !jtoolchain::jdk_bin(_javac_bin_path))
+		_javac_bin_path.clear();
+
+	start_job(file_name, jd, true);
+}
+
+
+void jdecompiler::start_job(const wchar_t* file_name, const decompiler jd, const bool background)
+{
+	assert(!_worker.joinable());
+
+	_job_file = file_name;
+	_job_jd = jd;
+	_background = background;
+	_job_rc = false;
+	_finished = false;
+	_cancel = false;
+	_java_file_name.clear();
+	_source.clear();
+	_source_saved = false;
+
+	//Big classes take longer, timeout grows with class file size
+	_timeout = DECOMPILER_WAITTIME;
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	if (GetFileAttributesEx(file_name, GetFileExInfoStandard, &fad))
+		_timeout += fad.nFileSizeLow / 1024 * DECOMPILER_WAITTIME_KB;
+
+	_worker = thread([this]() {
+		_job_rc = run_job();
+		_finished = true;
+	});
+}
+
+
+bool jdecompiler::run_job()
+{
+	const wchar_t* file_name = _job_file.c_str();
+
+	//Foreground job is started after cache lookup and java search with UI messages
+	if (_background) {
+		if (from_cache(file_name, _job_jd))
+			return true;
+		if (_job_jd != jd_jad && _java_bin_path.empty())
+			return false;
+		if (_job_jd == jd_javap && _javac_bin_path.empty())
+			return false;
+	}
+
+	bool rc = false;
+	_line_map.reset();
+	switch (_job_jd) {
+		case jd_jad: rc = decompile_jad(file_name); break;
+		case jd_fernflower: rc = decompile_fernflower(file_name); break;
+		case jd_cfr: rc = decompile_cfr(file_name); break;
+		case jd_javap: rc = decompile_javap(file_name); break;
+	}
+	if (!rc || _cancel)
+		return false;
+
+	if (!_cache_key.empty()) {
+		const source_cache cache(static_cast<uint64_t>(settings::source_cache_size) << 20);
+		cache.put(_cache_key, _source);
+	}
+	//Captured output is already tokenized up to the last complete line, source read from file is tokenized here
+	_line_map.update(_source.data(), _source.size(), true);
+	return true;
+}
+
+
+void jdecompiler::abandon()
+{
+	if (!_worker.joinable())
+		return;
+	_cancel = true;
+	_worker.join();
+	if (_source_saved)
+		DeleteFile(_java_file_name.c_str());
+	_java_file_name.clear();
+	_source.clear();
+	_source_saved = false;
+}
+
+
+bool jdecompiler::from_cache(const wchar_t* file_name, const decompiler jd)
+{
+	_cache_key = source_key(file_name, jd);
+	if (_cache_key.empty())
+		return false;
+
+	_java_file_name = get_tmp_path() + L'\\' + _FSF.PointToName(file_name);
+	const size_t ext_pos = _java_file_name.rfind(L'.');
+	if (ext_pos != wstring::npos)
+		_java_file_name.erase(ext_pos + 1);
+	_java_file_name += name(jd);
+	_java_file_name += L".java";
+
+	_source_saved = false;
+	const source_cache cache(static_cast<uint64_t>(settings::source_cache_size) << 20);
+	if (!cache.get(_cache_key, _source)) {
+		_java_file_name.clear();
+		return false;
+	}
+	_line_map.read(_source.data(), _source.size());
+	return true;
+}
+
+
+const wchar_t* jdecompiler::source_file()
+{
+	assert(!_java_file_name.empty());
+
+	//Source is kept in memory, editor is the only consumer that needs a file
+	if (!_source_saved) {
+		if (!dir_walker::replace_file(_java_file_name, _source.data(), _source.size()))
+			return nullptr;
+		_source_saved = true;
+	}
+	return _java_file_name.c_str();
+}
+
+
 intptr_t jdecompiler::find_line(const jclass::jmember& member) const
 {
 	assert(!_java_file_name.empty());
 
-	intptr_t line_num = 1;
-
-	const char* jam[] = { "public", "protected", "private", "static", "abstract", "final", "volatile", "super", "transient", "abstract" };
-
-	try {
-		jtformat jf;
-		string type_name = w2a(jf.get_type_name(member));
-		size_t pos = 0;
-		while ((pos = type_name.find_first_of("[]")) != string::npos)
-			type_name.erase(pos, 1);
-		string regex_tmpl = "\\s*((\\s)";
-		for (size_t i = 0; i < sizeof(jam) / sizeof(jam[0]); ++i) {
-			regex_tmpl += L'|';
-			regex_tmpl += '(';
-			regex_tmpl += jam[i];
-			regex_tmpl += ')';
-		}
-		regex_tmpl += ")*\\s*";
-		regex_tmpl += type_name;
-		regex_tmpl += "\\s*[\\[\\]]*\\s*";
-		regex_tmpl += w2a(member.name);
-		regex_tmpl += "\\s*[\\[\\]]*\\s*";
-		if (member.type == jclass::method)
-			regex_tmpl += "(.*)";
-		else
-			regex_tmpl += "\\s*(=.*;|;)";
-		regex rx(regex_tmpl.c_str());
-		ifstream file_stream;
-		string cjava_file_name(begin(_java_file_name), end(_java_file_name));
-		file_stream.open(cjava_file_name.c_str(), fstream::in);
-		if (file_stream.is_open()) {
-			int ln = 1;
-			while (line_num == 1 && !file_stream.eof()) {
-				string chk_str;
-				getline(file_stream, chk_str);
-				if (regex_match(chk_str, rx))
-					line_num = ln;
-				++ln;
-			}
-			file_stream.close();
-		}
+	const intptr_t line_num = _line_map.find(member);
+	return line_num ? line_num : 1;
+}
+
+
+bool jdecompiler::decompile_tree(const wchar_t* source, const wchar_t* out_dir, const decompiler jd)
+{
+	assert(source && source[0]);
+	assert(out_dir && out_dir[0]);
+	assert(jd != jd_javap);
+
+	if (jd != jd_jad && !jtoolchain::java_bin(_java_bin_path)) {
+		const wchar_t* msg[] = { TEXT(PLUGIN_NAME), L"Unable to decompile: Java interpreter not found" };
+		_PSI.Message(&_FPG, &_FPG, FMSG_WARNING | FMSG_MB_OK, nullptr, msg, sizeof(msg) / sizeof(msg[0]), 0);
+		return false;
 	}
-	catch (regex_error&) {
-		line_num = 1;
+
+	_PSI.AdvControl(&_FPG, ACTL_SETPROGRESSSTATE, TBPF_NORMAL, nullptr);
+
+	jbatch batch(jd, _java_bin_path + L"java.exe", module_path());
+	bool cancelled = false;
+	const bool rc = batch.run(source, out_dir, [&cancelled](const size_t done, const size_t total) {
+		if (!cancelled && esc_pressed())
+			cancelled = true;
+		const wstring state = L"Decompiled " + to_wstring(done) + L" of " + to_wstring(total) + L" classes";
+		const wchar_t* msg[] = { TEXT(PLUGIN_NAME), state.c_str(), cancelled ? L"Cancelling..." : L"Press Esc to cancel" };
+		_PSI.Message(&_FPG, &_FPG, FMSG_NONE, nullptr, msg, sizeof(msg) / sizeof(msg[0]), 0);
+		ProgressValue pv;
+		ZeroMemory(&pv, sizeof(pv));
+		pv.StructSize = sizeof(pv);
+		pv.Completed = done;
+		pv.Total = total ? total : 1;
+		_PSI.AdvControl(&_FPG, ACTL_SETPROGRESSVALUE, 0, &pv);
+		return !cancelled;
+	});
+
+	_PSI.AdvControl(&_FPG, ACTL_PROGRESSNOTIFY, 0, nullptr);
+	_PSI.AdvControl(&_FPG, ACTL_SETPROGRESSSTATE, TBPF_NOPROGRESS, nullptr);
+	_PSI.PanelControl(PANEL_ACTIVE, FCTL_REDRAWPANEL, 0, nullptr);
+	_PSI.PanelControl(PANEL_PASSIVE, FCTL_REDRAWPANEL, 0, nullptr);
+
+	//Failed classes are listed next to the sources
+	const vector<string>& failures = batch.failures();
+	if (rc && !failures.empty()) {
+		string report;
+		for (size_t i = 0; i < failures.size(); ++i)
+			report += failures[i] + "\r\n";
+		dir_walker::replace_file(wstring(out_dir) + L"\\decompile_errors.txt", report.c_str(), report.length());
 	}
 
-	return line_num;
+	wstring msg = TEXT(PLUGIN_NAME);
+	msg += L'\n';
+	if (!rc) {
+		msg += L"Unable to read classes from\n";
+		msg += source;
+	}
+	else {
+		msg += L"Decompiled " + to_wstring(batch.total()) + L" classes with ";
+		msg += name(jd);
+		if (cancelled)
+			msg += L"\nCancelled by user";
+		if (!failures.empty())
+			msg += L"\n" + to_wstring(failures.size()) + L" failed, see decompile_errors.txt";
+	}
+	_PSI.Message(&_FPG, &_FPG, FMSG_ALLINONE | FMSG_MB_OK | (!rc || !failures.empty() ? FMSG_WARNING : FMSG_NONE), nullptr, reinterpret_cast<const wchar_t* const*>(msg.c_str()), 0, 0);
+
+	return rc;
+}
+
+
+const wchar_t* jdecompiler::name(const decompiler jd)
+{
+	switch (jd) {
+		case jd_jad: return L"JAD";
+		case jd_fernflower: return L"Fernflower";
+		case jd_cfr: return L"CFR";
+		case jd_javap: return L"javap";
+	}
+	return L"";
+}
+
+
+string jdecompiler::source_key(const wchar_t* file_name, const decompiler jd) const
+{
+	if (!settings::source_cache_size)
+		return string();
+
+	//Decompiler module size and time stamp identify its version
+	wstring module = module_path();
+	switch (jd) {
+		case jd_jad: module += L"jad.exe"; break;
+		case jd_fernflower: module += L"fernflower.jar"; break;
+		case jd_cfr: module += L"cfr.jar"; break;
+		case jd_javap: return string();	//Output depends on JDK found at run time
+	}
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	if (!GetFileAttributesEx(module.c_str(), GetFileExInfoStandard, &fad))
+		return string();
+
+	//Plug-in version covers decompiler command line options
+	char tool[128];
+	snprintf(tool, sizeof(tool), "%d:%lu:%lu:%lu:%lu:" VSTR(PLUGIN_VER_MAJOR) "." VSTR(PLUGIN_VER_MINOR) "." VSTR(PLUGIN_VER_BUILD),
+		static_cast<int>(jd), fad.nFileSizeHigh, fad.nFileSizeLow, fad.ftLastWriteTime.dwHighDateTime, fad.ftLastWriteTime.dwLowDateTime);
+
+	mapped_file class_file;
+	if (!class_file.open(file_name) || !class_file.size())
+		return string();
+	return source_cache::key(class_file.data(), class_file.size(), tool);
 }
 
 
@@ -136,19 +362,19 @@ bool jdecompiler::decompile_jad(const wchar_t* file_name)
 	_java_file_name += L'\\';
 	_java_file_name += _FSF.PointToName(file_name);
 	const size_t ext_pos = _java_file_name.rfind(L'.');
-	if (ext_pos != string::npos)
+	if (ext_pos != wstring::npos)
 		_java_file_name.erase(ext_pos + 1);
 	_java_file_name += decompiler_fext;
 
 	const wstring decompiler_module = module_path() + L"jad.exe";
-	wstring decompiler_params = L" -nonlb -o -d \"";
+	wstring decompiler_params = L" -nonlb -lnc -o -d \"";
 	decompiler_params += tmp_path;
 	decompiler_params += L"\" -s \"";
 	decompiler_params += decompiler_fext;
 	decompiler_params += L"\" ";
 	decompiler_params += file_name;
 	decompiler_params += L"\"";
-	return execute(decompiler_module.c_str(), decompiler_params.c_str());
+	return execute(decompiler_module.c_str(), decompiler_params.c_str(), nullptr, 0xFFFFFFFF, _timeout, &_cancel, _background) && load_source();
 }
 
 
@@ -167,24 +393,15 @@ bool jdecompiler::decompile_cfr(const wchar_t* file_name)
 	_java_file_name = tmp_path + L'\\';
 	_java_file_name += _FSF.PointToName(file_name);
 	const size_t ext_pos = _java_file_name.rfind(L'.');
-	if (ext_pos != string::npos)
+	if (ext_pos != wstring::npos)
 		_java_file_name.erase(ext_pos + 1);
 	_java_file_name += L"java";
 
-	const wstring java_exe = _java_bin_path + L"java.exe";
-
-	SECURITY_ATTRIBUTES  sec;
-	ZeroMemory(&sec, sizeof(sec));
-	sec.nLength = sizeof(sec);
-	sec.bInheritHandle = TRUE;
-	HANDLE std_out_file = CreateFile(_java_file_name.c_str(), GENERIC_WRITE | GENERIC_READ, FILE_SHARE_READ, &sec, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-	if (std_out_file == INVALID_HANDLE_VALUE)
-		return false;
-
-	const bool rc = execute(java_exe.c_str(), decompiler_params.c_str(), std_out_file, 0);
+	if (decompile_hosted("cfr", file_name, _java_file_name))
+		return load_source();
 
-	CloseHandle(std_out_file);
-	return rc;
+	const wstring java_exe = _java_bin_path + L"java.exe";
+	return execute(java_exe.c_str(), decompiler_params.c_str(), &_source, 0, _timeout, &_cancel, _background, &_line_map);
 }
 
 bool jdecompiler::decompile_fernflower(const wchar_t* file_name)
@@ -204,24 +421,32 @@ bool jdecompiler::decompile_fernflower(const wchar_t* file_name)
 	_java_file_name = tmp_path + L'\\';
 	_java_file_name += _FSF.PointToName(file_name);
 	const size_t ext_pos = _java_file_name.rfind(L'.');
-	if (ext_pos != string::npos)
+	if (ext_pos != wstring::npos)
 		_java_file_name.erase(ext_pos + 1);
 	_java_file_name += L"java";
 
+	if (decompile_hosted("fernflower", file_name, tmp_path))
+		return load_source();
+
 	const wstring java_exe = _java_bin_path + L"java.exe";
-	return execute(java_exe.c_str(), decompiler_params.c_str(), INVALID_HANDLE_VALUE, 0);
+	return execute(java_exe.c_str(), decompiler_params.c_str(), nullptr, 0, _timeout, &_cancel, _background) && load_source();
 }
 
 
-bool jdecompiler::decompile_javap(const wchar_t* file_name)
+bool jdecompiler::decompile_hosted(const char* tool, const wchar_t* file_name, const wstring& out_path)
 {
+	assert(tool && *tool);
 	assert(file_name && file_name[0]);
 
-	if (_javac_bin_path.empty() && !find_javac_bin(_javac_bin_path)) {
-		const wchar_t* msg[] = { TEXT(PLUGIN_NAME), L"Unable to decompile class file: JDK not found" };
-		_PSI.Message(&_FPG, &_FPG, FMSG_WARNING | FMSG_MB_OK, nullptr, msg, sizeof(msg) / sizeof(msg[0]), 0);
-		return false;
-	}
+	//Java without source launcher (before 11) can not run the host, one process per class is used then
+	_host.setup(_java_bin_path + L"java.exe", module_path());
+	return _host.decompile(tool, file_name, out_path, _timeout, &_cancel);
+}
+
+
+bool jdecompiler::decompile_javap(const wchar_t* file_name)
+{
+	assert(file_name && file_name[0]);
 
 	wstring class_path = file_name;
 	const size_t cp_pos = class_path.rfind('\\');
@@ -245,26 +470,30 @@ bool jdecompiler::decompile_javap(const wchar_t* file_name)
 	decompiler_params += class_name;
 
 	const wstring javap_exe = _javac_bin_path + L"javap.exe";
+	return execute(javap_exe.c_str(), decompiler_params.c_str(), &_source, 0, _timeout, &_cancel, _background, &_line_map);
+}
 
-	SECURITY_ATTRIBUTES  sec;
-	ZeroMemory(&sec, sizeof(sec));
-	sec.nLength = sizeof(sec);
-	sec.bInheritHandle = TRUE;
-	HANDLE std_out_file = CreateFile(_java_file_name.c_str(), GENERIC_WRITE | GENERIC_READ, FILE_SHARE_READ, &sec, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-	if (std_out_file == INVALID_HANDLE_VALUE)
-		return false;
 
-	const bool rc = execute(javap_exe.c_str(), decompiler_params.c_str(), std_out_file, 0);
-	
-	CloseHandle(std_out_file);
-	return rc;
+bool jdecompiler::load_source()
+{
+	//Decompilers that write files: source is read once, the file is reused by editor
+	_source_saved = true;
+	mapped_file source;
+	if (!source.open(_java_file_name.c_str()))
+		return false;
+	if (source.size())
+		_source.assign(reinterpret_cast<const char*>(source.data()), source.size());
+	return true;
 }
 
 
-bool jdecompiler::execute(const wchar_t* exe, const wchar_t* params, HANDLE stdout_file /*= INVALID_HANDLE_VALUE*/, const DWORD expected_code /*= 0xFFFFFFFF*/) const
+bool jdecompiler::execute(const wchar_t* exe, const wchar_t* params, string* output /*= nullptr*/, const DWORD expected_code /*= 0xFFFFFFFF*/, const DWORD timeout /*= DECOMPILER_WAITTIME*/, const atomic<bool>* cancel /*= nullptr*/, const bool background /*= false*/, jlinemap* line_map /*= nullptr*/)
 {
 	assert(exe && exe[0]);
 
+	if (cancel && *cancel)
+		return false;
+
 	bool rc = false;
 
 	STARTUPINFO si;
@@ -273,19 +502,56 @@ bool jdecompiler::execute(const wchar_t* exe, const wchar_t* params, HANDLE stdo
 	si.wShowWindow = SW_HIDE;
 	si.dwFlags = STARTF_USESHOWWINDOW;
 
-	if (stdout_file != INVALID_HANDLE_VALUE) {
+	//Output is read through a pipe, only its write end is inherited by the process
+	HANDLE out_read = nullptr;
+	HANDLE out_write = nullptr;
+	if (output) {
+		output->clear();
+		if (line_map)
+			line_map->reset();
+		SECURITY_ATTRIBUTES sec;
+		ZeroMemory(&sec, sizeof(sec));
+		sec.nLength = sizeof(sec);
+		sec.bInheritHandle = TRUE;
+		if (!CreatePipe(&out_read, &out_write, &sec, DECOMPILER_PIPESIZE))
+			return false;
+		SetHandleInformation(out_read, HANDLE_FLAG_INHERIT, 0);
 		si.dwFlags |= STARTF_USESTDHANDLES;
-		si.hStdOutput = stdout_file;
-		si.hStdError = stdout_file;
+		si.hStdOutput = out_write;
+		si.hStdError = out_write;
 	}
 
 	PROCESS_INFORMATION pi;
 	ZeroMemory(&pi, sizeof(pi));
 
-	rc = CreateProcess(exe, const_cast<wchar_t*>(params), nullptr, nullptr, TRUE, CREATE_NEW_CONSOLE, nullptr, nullptr, &si, &pi) != FALSE;
-	if (rc && WaitForSingleObject(pi.hProcess, DECOMPILER_WAITTIME) == WAIT_TIMEOUT) {
-		TerminateProcess(pi.hProcess, 0);
-		rc = false;
+	rc = CreateProcess(exe, const_cast<wchar_t*>(params), nullptr, nullptr, TRUE, CREATE_NEW_CONSOLE | (background ? BELOW_NORMAL_PRIORITY_CLASS : 0), nullptr, nullptr, &si, &pi) != FALSE;
+
+	//Pipe is broken when the process exits only if we do not hold its write end
+	if (out_write)
+		CloseHandle(out_write);
+
+	if (rc) {
+		//Wait in short steps to react on cancel request, pipe is drained meanwhile to not block the writer
+		const ULONGLONG deadline = GetTickCount64() + timeout;
+		while (true) {
+			if ((cancel && *cancel) || GetTickCount64() >= deadline) {
+				TerminateProcess(pi.hProcess, 0);
+				rc = false;
+				break;
+			}
+			if (out_read && read_pipe(out_read, *output)) {
+				//Complete lines are tokenized while the process is still writing
+				if (line_map)
+					line_map->update(output->data(), output->size(), false);
+				continue;
+			}
+			if (WaitForSingleObject(pi.hProcess, DECOMPILER_POLLTIME) != WAIT_TIMEOUT)
+				break;
+		}
+		if (rc && out_read) {
+			while (read_pipe(out_read, *output))
+				;
+		}
 	}
 	if (rc && expected_code != 0xFFFFFFFF) {
 		DWORD exit_code = 0;
@@ -293,6 +559,8 @@ bool jdecompiler::execute(const wchar_t* exe, const wchar_t* params, HANDLE stdo
 			rc = false;
 	}
 
+	if (out_read)
+		CloseHandle(out_read);
 	if (pi.hThread)
 		CloseHandle(pi.hThread);
 	if (pi.hProcess)
@@ -302,144 +570,50 @@ bool jdecompiler::execute(const wchar_t* exe, const wchar_t* params, HANDLE stdo
 }
 
 
-wstring jdecompiler::module_path() const
+bool jdecompiler::read_pipe(HANDLE pipe, string& output)
 {
-	wstring path =_PSI.ModuleName;
-	path.resize(path.rfind(L'\\') + 1);
-	return path;
-}
-
+	DWORD avail = 0;
+	if (!PeekNamedPipe(pipe, nullptr, 0, nullptr, &avail, nullptr) || !avail)
+		return false;
 
-wstring jdecompiler::get_tmp_path() const
-{
-	wchar_t tmp_path[MAX_PATH];
-	if (!GetTempPath(MAX_PATH, tmp_path))
-		tmp_path[0] = 0;
-	if (tmp_path[wcslen(tmp_path) - 1] == L'\\')
-		tmp_path[wcslen(tmp_path) - 1] = 0;
-	return tmp_path;
+	const size_t pos = output.size();
+	output.resize(pos + avail);
+	DWORD rd = 0;
+	if (!ReadFile(pipe, &output[pos], avail, &rd, nullptr))
+		rd = 0;
+	output.resize(pos + rd);
+	return rd != 0;
 }
 
 
-bool jdecompiler::find_javac_bin(wstring& javac_bin_path) const
+bool jdecompiler::esc_pressed()
 {
-	const wchar_t* javac_exe = L"javac.exe";
-
-	if (execute(javac_exe, nullptr))
-		return true;
-
-	//Search in JAVA_HOME
-	wstring java_home(1024, 0);
-	java_home.resize(GetEnvironmentVariable(L"JAVA_HOME", &java_home[0], static_cast<DWORD>(java_home.size())));
-	if (!java_home.empty()) {
-		java_home += L"\\bin\\";
-		const wstring chk_path = java_home + L"javac.exe";
-		if (execute(chk_path.c_str(), nullptr)) {
-			javac_bin_path = java_home;
+	HANDLE console = GetStdHandle(STD_INPUT_HANDLE);
+	INPUT_RECORD rec;
+	DWORD count = 0;
+	while (PeekConsoleInput(console, &rec, 1, &count) && count) {
+		ReadConsoleInput(console, &rec, 1, &count);
+		if (rec.EventType == KEY_EVENT && rec.Event.KeyEvent.bKeyDown && rec.Event.KeyEvent.wVirtualKeyCode == VK_ESCAPE)
 			return true;
-		}
-	}
-
-	//Search in registry
-	const wchar_t* keys[] = {
-		L"SOFTWARE\\JavaSoft\\Java Development Kit\\1.8",
-		L"SOFTWARE\\JavaSoft\\Java Development Kit\\1.7",
-		L"SOFTWARE\\JavaSoft\\Java Development Kit\\1.6",
- 		L"SOFTWARE\\JavaSoft\\Java Runtime Environment\\1.8",
- 		L"SOFTWARE\\JavaSoft\\Java Runtime Environment\\1.7",
-		L"SOFTWARE\\JavaSoft\\Java Runtime Environment\\1.6"
-	};
-	for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
-		wstring path = get_javahome_path(keys[i]);
-		if (!path.empty()) {
-			path += L"\\bin\\";
-			const wstring chk_path = path + L"javac.exe";
-			if (execute(chk_path.c_str(), nullptr)) {
-				javac_bin_path = path;
-				return true;
-			}
-		}
 	}
-
 	return false;
 }
 
-bool jdecompiler::find_java_bin(wstring& java_bin_path) const
-{
-	const wchar_t* java_exe = L"java.exe";
-
-	if (execute(java_exe, nullptr))
-		return true;
-
-	//Search in JAVA_HOME
-	wstring java_home(1024, 0);
-	java_home.resize(GetEnvironmentVariable(L"JAVA_HOME", &java_home[0], static_cast<DWORD>(java_home.size())));
-	if (!java_home.empty()) {
-		java_home += L"\\bin\\";
-		const wstring chk_path = java_home + L"java.exe";
-		if (execute(chk_path.c_str(), nullptr)) {
-			java_bin_path = java_home;
-			return true;
-		}
-	}
 
-	//Search in registry
-	const wchar_t* keys[] = {
-		L"SOFTWARE\\JavaSoft\\Java Development Kit\\1.8",
-		L"SOFTWARE\\JavaSoft\\Java Development Kit\\1.7",
-		L"SOFTWARE\\JavaSoft\\Java Development Kit\\1.6",
- 		L"SOFTWARE\\JavaSoft\\Java Runtime Environment\\1.8",
- 		L"SOFTWARE\\JavaSoft\\Java Runtime Environment\\1.7",
-		L"SOFTWARE\\JavaSoft\\Java Runtime Environment\\1.6"
-	};
-	for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
-		wstring path = get_javahome_path(keys[i]);
-		if (!path.empty()) {
-			path += L"\\bin\\";
-			const wstring chk_path = path + L"java.exe";
-			if (execute(chk_path.c_str(), nullptr)) {
-				java_bin_path = path;
-				return true;
-			}
-		}
-	}
-
-	return false;
-}
-
-
-wstring jdecompiler::get_javahome_path(const wchar_t* key_path) const
+wstring jdecompiler::module_path() const
 {
-	assert(key_path && key_path[0]);
-
-	wstring path;
-
-	HKEY reg_key;
-	if (RegOpenKeyEx(HKEY_LOCAL_MACHINE, key_path, 0, KEY_READ, &reg_key) == ERROR_SUCCESS) {
-		const wchar_t* path_key = L"JavaHome";
-		DWORD data_len = 0;
-		if (RegQueryValueEx(reg_key, path_key, NULL, NULL, NULL, &data_len) == ERROR_SUCCESS) {
-			path.resize(data_len / sizeof(wchar_t), 0);
-			if (!RegQueryValueEx(reg_key, path_key, NULL, NULL, reinterpret_cast<LPBYTE>(&path[0]), &data_len) == ERROR_SUCCESS)
-				path.clear();
-			else if (!path.empty() && path.back() == 0)
-				path.erase(path.length() - 1);	//Remove last null
-		}
-		RegCloseKey(reg_key);
-	}
-
+	wstring path =_PSI.ModuleName;
+	path.resize(path.rfind(L'\\') + 1);
 	return path;
-
 }
 
 
-string jdecompiler::w2a(const wstring& val) const
+wstring jdecompiler::get_tmp_path() const
 {
-	string enc;
-	const int req = WideCharToMultiByte(CP_UTF8, 0, val.c_str(), static_cast<int>(val.length()), 0, 0, nullptr, nullptr);
-	if (req) {
-		enc.resize(static_cast<size_t>(req));
-		WideCharToMultiByte(CP_UTF8, 0, val.c_str(), static_cast<int>(val.length()), &enc.front(), req, nullptr, nullptr);
-	}
-	return enc;
+	wchar_t tmp_path[MAX_PATH];
+	if (!GetTempPath(MAX_PATH, tmp_path))
+		tmp_path[0] = 0;
+	if (tmp_path[wcslen(tmp_path) - 1] == L'\\')
+		tmp_path[wcslen(tmp_path) - 1] = 0;
+	return tmp_path;
 }
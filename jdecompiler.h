@@ -21,6 +21,15 @@
 
 #include "common.h"
 #include "jclass.h"
+#include "jdhost.h"
+#include "jlinemap.h"
+#include <atomic>
+#include <thread>
+
+//! Decompiler process timeout (milliseconds)
+#define DECOMPILER_WAITTIME	10000
+//! Additional decompiler timeout for every KiB of class file (milliseconds)
+#define DECOMPILER_WAITTIME_KB	1000
 
 
 class jdecompiler
@@ -34,14 +43,31 @@ public:
 		jd_javap
 	};
 
+	jdecompiler();
+
+	/**
+	 * Destructor: abandon background job.
+	 */
+	~jdecompiler();
+
 	/**
 	 * Decompile java class file.
+	 * Decompiler runs on a worker thread, the calling (UI) thread shows
+	 * progress and cancels decompilation on Esc. Background job started
+	 * for the same class and decompiler is taken over, any other is abandoned.
 	 * \param file_name java class name
 	 * \param jd used decompilator
 	 * \return false if error
 	 */
 	bool decompile(const wchar_t* file_name, const decompiler jd);
 
+	/**
+	 * Start speculative decompilation in background (low priority, no UI).
+	 * \param file_name java class name (must exist until job is finished or abandoned)
+	 * \param jd used decompilator
+	 */
+	void prefetch(const wchar_t* file_name, const decompiler jd);
+
 	/**
 	 * Get line number in source java file for specified member.
 	 * \param member member description
@@ -50,12 +76,102 @@ public:
 	intptr_t find_line(const jclass::jmember& member) const;
 
 	/**
-	 * Get decompiled source file name.
-	 * \return decompiled source file name
+	 * Get decompiled source file name, the file is written on first call.
+	 * \return decompiled source file name (nullptr if file can not be written)
+	 */
+	const wchar_t* source_file();
+
+	/**
+	 * Decompile all classes of archive or directory into mirrored source tree.
+	 * Progress is shown while decompilers run, failed classes are listed
+	 * in "decompile_errors.txt" inside output directory.
+	 * \param source archive file or directory name
+	 * \param out_dir output directory
+	 * \param jd used decompilator (javap is not supported)
+	 * \return false if error
+	 */
+	bool decompile_tree(const wchar_t* source, const wchar_t* out_dir, const decompiler jd);
+
+	/**
+	 * Execute program.
+	 * \param exe executable module
+	 * \param params execution parameters
+	 * \param output buffer for captured stdout and stderr (nullptr to ignore)
+	 * \param expected_code expected exit code by process (0xFFFFFFFF to ignore)
+	 * \param timeout process timeout in milliseconds
+	 * \param cancel cancel flag, process is terminated when it is set (may be nullptr)
+	 * \param background run process with low priority
+	 * \param line_map member lines table fed with output as it arrives (may be nullptr)
+	 * \return false if error, timeout or cancel
+	 */
+	static bool execute(const wchar_t* exe, const wchar_t* params, string* output = nullptr, const DWORD expected_code = 0xFFFFFFFF, const DWORD timeout = DECOMPILER_WAITTIME, const atomic<bool>* cancel = nullptr, const bool background = false, jlinemap* line_map = nullptr);
+
+	/**
+	 * Check for Esc key in console input (other input is dropped).
+	 * \return true if Esc was pressed
 	 */
-	const wchar_t* source_file() const { return _java_file_name.c_str(); }
+	static bool esc_pressed();
 
 private:
+	jdecompiler(const jdecompiler&);
+	jdecompiler& operator=(const jdecompiler&);
+
+	/**
+	 * Start decompilation job on worker thread.
+	 * \param file_name java class file name
+	 * \param jd used decompilator
+	 * \param background background (speculative) job flag
+	 */
+	void start_job(const wchar_t* file_name, const decompiler jd, const bool background);
+
+	/**
+	 * Decompilation job (worker thread).
+	 * \return false if error
+	 */
+	bool run_job();
+
+	/**
+	 * Cancel and wait for job, output of job that was not taken over is removed.
+	 */
+	void abandon();
+
+	/**
+	 * Take decompiled source from cache.
+	 * \param file_name java class file name
+	 * \param jd used decompilator
+	 * \return false if source is not cached
+	 */
+	bool from_cache(const wchar_t* file_name, const decompiler jd);
+
+	/**
+	 * Read source written by decompiler to destination file.
+	 * \return false if error
+	 */
+	bool load_source();
+
+	/**
+	 * Read available data from pipe without blocking.
+	 * \param pipe pipe read handle
+	 * \param output buffer to append data
+	 * \return false if no data was read
+	 */
+	static bool read_pipe(HANDLE pipe, string& output);
+
+	/**
+	 * Get decompiler name.
+	 * \param jd decompiler
+	 * \return decompiler name
+	 */
+	static const wchar_t* name(const decompiler jd);
+
+	/**
+	 * Get decompiled source cache key.
+	 * \param file_name java class file name
+	 * \param jd used decompilator
+	 * \return cache key (empty if source can not be cached)
+	 */
+	string source_key(const wchar_t* file_name, const decompiler jd) const;
+
 	/**
 	 * Decompilation with JAD.
 	 * \param file_name java class file name
@@ -78,21 +194,20 @@ private:
 	bool decompile_fernflower(const wchar_t* file_name);
 
 	/**
-	 * Decompilation with javap.
+	 * Decompilation with warm host process (started on first use).
+	 * \param tool decompiler name ("cfr", "fernflower")
 	 * \param file_name java class file name
-	 * \return false if error
+	 * \param out_path output file (CFR) or directory (Fernflower)
+	 * \return false if error or host is not supported by found java
 	 */
-	bool decompile_javap(const wchar_t* file_name);
-	
+	bool decompile_hosted(const char* tool, const wchar_t* file_name, const wstring& out_path);
+
 	/**
-	 * Execute program.
-	 * \param exe executable module
-	 * \param params execution parameters
-	 * \param stdout_file redirected stdout file handle (INVALID_HANDLE_VALUE to ignore)
-	 * \param expected_code expected exit code by process (0xFFFFFFFF to ignore)
+	 * Decompilation with javap.
+	 * \param file_name java class file name
 	 * \return false if error
 	 */
-	bool execute(const wchar_t* exe, const wchar_t* params, HANDLE stdout_file = INVALID_HANDLE_VALUE, const DWORD expected_code = 0xFFFFFFFF) const;
+	bool decompile_javap(const wchar_t* file_name);
 
 	/**
 	 * Get plug-in module path.
@@ -106,36 +221,21 @@ private:
 	 */
 	wstring get_tmp_path() const;
 
-	/**
-	 * Find javac executable module path.
-	 * \param javac_bin_path javac executable path
-	 * \return false if error (javac interpreter not found)
-	 */
-	bool find_javac_bin(wstring& javac_bin_path) const;
-
-	/**
-	 * Find java executable module path.
-	 * \param java_bin_path java executable path
-	 * \return false if error (java interpreter not found)
-	 */
-	bool find_java_bin(wstring& java_bin_path) const;
-
-	/**
-	 * Get java home path from registry.
-	 * \param key_path registry key path
-	 * \return java home path from registry
-	 */
-	wstring get_javahome_path(const wchar_t* key_path) const;
-
-	/**
-	 * Convert wide string to ansi UTF8.
-	 * \param val source wide string
-	 * \return ansi UTF8 string
-	 */
-	string w2a(const wstring& val) const;
-
 private:
 	wstring _java_bin_path;		///< Java interpreter bin directory path
-	wstring _javac_bin_path;		///< Java interpreter bin directory path
+	wstring _javac_bin_path;	///< JDK bin directory path
 	wstring _java_file_name;	///< Destination java source file
+	string _source;				///< Decompiled source
+	bool _source_saved;			///< Decompiled source is written to destination file
+	jlinemap _line_map;			///< Member declaration lines of decompiled source
+	DWORD _timeout;				///< Decompiler timeout for current class
+	atomic<bool> _cancel;		///< Cancel request flag
+	string _cache_key;			///< Source cache key of current class
+	thread _worker;				///< Job worker thread
+	atomic<bool> _finished;		///< Job finished flag
+	bool _job_rc;				///< Job result
+	wstring _job_file;			///< Job class file name
+	decompiler _job_jd;			///< Job decompilator
+	bool _background;			///< Job is speculative (low priority, no UI)
+	static jdhost _host;		///< Decompiler host process shared by all instances
 };
@@ -0,0 +1,281 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include "jdhost.h"
+#include "jutf8.h"
+#include <stdint.h>
+#include <string.h>
+
+//! Idle time after that host process exits (milliseconds)
+#define JDHOST_IDLE_TIME	600000
+//! Host start timeout, includes JDHost.java compilation (milliseconds)
+#define JDHOST_START_TIME	30000
+
+
+jdhost::jdhost()
+:	_process(nullptr), _stdin(nullptr), _stdout(nullptr), _launched(false), _unsupported(false), _exited(false), _cancel(nullptr)
+{
+}
+
+
+jdhost::~jdhost()
+{
+	shutdown();
+}
+
+
+void jdhost::setup(const wstring& java_exe, const wstring& module_path)
+{
+	lock_guard<mutex> lock(_lock);
+	if (_java_exe.empty()) {
+		_java_exe = java_exe;
+		_module_path = module_path;
+	}
+}
+
+
+bool jdhost::running()
+{
+	//Busy host is alive, UI thread must not wait for it
+	unique_lock<mutex> lock(_lock, try_to_lock);
+	return !lock.owns_lock() || alive();
+}
+
+
+void jdhost::stop()
+{
+	lock_guard<mutex> lock(_lock);
+	shutdown();
+}
+
+
+bool jdhost::alive() const
+{
+	return _process && WaitForSingleObject(_process, 0) == WAIT_TIMEOUT;
+}
+
+
+bool jdhost::launch()
+{
+	shutdown();
+
+	SECURITY_ATTRIBUTES sec;
+	ZeroMemory(&sec, sizeof(sec));
+	sec.nLength = sizeof(sec);
+	sec.bInheritHandle = TRUE;
+
+	//Only the child ends of pipes are inherited
+	HANDLE child_in = nullptr;
+	HANDLE child_out = nullptr;
+	if (!CreatePipe(&child_in, &_stdin, &sec, 0))
+		return false;
+	if (!CreatePipe(&_stdout, &child_out, &sec, 0)) {
+		CloseHandle(child_in);
+		shutdown();
+		return false;
+	}
+	SetHandleInformation(_stdin, HANDLE_FLAG_INHERIT, 0);
+	SetHandleInformation(_stdout, HANDLE_FLAG_INHERIT, 0);
+	HANDLE child_err = CreateFile(L"NUL", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, &sec, OPEN_EXISTING, 0, NULL);
+
+	STARTUPINFO si;
+	ZeroMemory(&si, sizeof(si));
+	si.cb = sizeof(STARTUPINFO);
+	si.dwFlags = STARTF_USESTDHANDLES;
+	si.hStdInput = child_in;
+	si.hStdOutput = child_out;
+	si.hStdError = child_err;
+
+	wstring params = L" -cp \"";
+	params += _module_path + L"cfr.jar;";
+	params += _module_path + L"fernflower.jar\" \"";
+	params += _module_path + L"JDHost.java\" ";
+	params += to_wstring(JDHOST_IDLE_TIME);
+
+	PROCESS_INFORMATION pi;
+	ZeroMemory(&pi, sizeof(pi));
+	const bool rc = CreateProcess(_java_exe.c_str(), &params[0], nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi) != FALSE;
+
+	CloseHandle(child_in);
+	CloseHandle(child_out);
+	if (child_err != INVALID_HANDLE_VALUE)
+		CloseHandle(child_err);
+	if (!rc) {
+		shutdown();
+		return false;
+	}
+	CloseHandle(pi.hThread);
+	_process = pi.hProcess;
+
+	//Host reports readiness when decompilers are loaded
+	unsigned char status = 1;
+	if (!read_response(JDHOST_START_TIME, status) || status != 0) {
+		shutdown();
+		return false;
+	}
+
+	_launched = true;
+	return true;
+}
+
+
+void jdhost::shutdown()
+{
+	//Host exits by itself when its stdin is closed
+	if (_stdin) {
+		CloseHandle(_stdin);
+		_stdin = nullptr;
+	}
+	if (_stdout) {
+		CloseHandle(_stdout);
+		_stdout = nullptr;
+	}
+	if (_process) {
+		if (WaitForSingleObject(_process, 1000) == WAIT_TIMEOUT)
+			TerminateProcess(_process, 0);
+		CloseHandle(_process);
+		_process = nullptr;
+	}
+}
+
+
+bool jdhost::decompile(const char* tool, const wstring& class_file, const wstring& out_path, const DWORD timeout, const atomic<bool>* cancel)
+{
+	assert(tool && *tool);
+
+	lock_guard<mutex> lock(_lock);
+	if (_unsupported || _java_exe.empty())
+		return false;
+	_cancel = cancel;
+
+	bool rc = false;
+	unsigned char status = 1;
+	const bool was_alive = alive();
+	if (was_alive && call(tool, class_file, out_path, timeout, status))
+		rc = (status == 0);
+	else if ((!was_alive || _exited) && !cancelled()) {
+		//Host is not started yet, crashed or exited by idle timeout; hung host is stopped and the call fails at once
+		if (launch()) {
+			if (call(tool, class_file, out_path, timeout, status))
+				rc = (status == 0);
+		}
+		else if (!_launched && !cancelled()) {
+			//Java without source launcher (before 11) can not run the host
+			_unsupported = true;
+		}
+	}
+
+	_cancel = nullptr;
+	return rc;
+}
+
+
+bool jdhost::call(const char* tool, const wstring& class_file, const wstring& out_path, const DWORD timeout, unsigned char& status)
+{
+	_exited = false;
+
+	//Request frame: payload length (u32, big endian) and three strings
+	string frame(sizeof(uint32_t), 0);
+	if (!put_utf(wstring(tool, tool + strlen(tool)), frame) || !put_utf(class_file, frame) || !put_utf(out_path, frame)) {
+		//String can't be sent, host is still usable
+		status = 1;
+		return true;
+	}
+	const uint32_t len = static_cast<uint32_t>(frame.size() - sizeof(uint32_t));
+	for (size_t i = 0; i < sizeof(uint32_t); ++i)
+		frame[i] = static_cast<char>(len >> (8 * (sizeof(uint32_t) - 1 - i)));
+
+	DWORD written = 0;
+	if (!WriteFile(_stdin, frame.data(), static_cast<DWORD>(frame.size()), &written, nullptr) || written != frame.size()) {
+		_exited = true;
+		shutdown();
+		return false;
+	}
+
+	if (!read_response(timeout, status)) {
+		shutdown();
+		return false;
+	}
+	return true;
+}
+
+
+bool jdhost::read_response(const DWORD timeout, unsigned char& status)
+{
+	const ULONGLONG deadline = GetTickCount64() + timeout;
+
+	unsigned char len_be[sizeof(uint32_t)];
+	if (!read_pipe(len_be, sizeof(len_be), deadline))
+		return false;
+	uint32_t len = 0;
+	for (size_t i = 0; i < sizeof(len_be); ++i)
+		len = (len << 8) | len_be[i];
+	if (!len || len > 0x10000)
+		return false;
+
+	//Status byte and message, message is not used
+	string payload(len, 0);
+	if (!read_pipe(&payload[0], len, deadline))
+		return false;
+	status = static_cast<unsigned char>(payload[0]);
+	return true;
+}
+
+
+bool jdhost::read_pipe(void* buf, size_t size, const ULONGLONG deadline)
+{
+	//Anonymous pipes do not support overlapped I/O, poll for data until deadline
+	unsigned char* ptr = static_cast<unsigned char*>(buf);
+	while (size) {
+		DWORD avail = 0;
+		if (!PeekNamedPipe(_stdout, nullptr, 0, nullptr, &avail, nullptr)) {
+			_exited = true;
+			return false;
+		}
+		if (!avail) {
+			if (cancelled() || GetTickCount64() >= deadline)
+				return false;
+			Sleep(1);
+			continue;
+		}
+		if (avail > size)
+			avail = static_cast<DWORD>(size);
+		DWORD rd = 0;
+		if (!ReadFile(_stdout, ptr, avail, &rd, nullptr) || !rd) {
+			_exited = true;
+			return false;
+		}
+		ptr += rd;
+		size -= rd;
+	}
+	return true;
+}
+
+
+bool jdhost::put_utf(const wstring& val, string& out)
+{
+	string utf;
+	jutf8::encode(val, utf);
+	if (utf.length() > 0xffff)
+		return false;
+	out += static_cast<char>(utf.length() >> 8);
+	out += static_cast<char>(utf.length() & 0xff);
+	out += utf;
+	return true;
+}
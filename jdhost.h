@@ -0,0 +1,140 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#include "common.h"
+#include <atomic>
+#include <mutex>
+
+
+class jdhost
+{
+public:
+	jdhost();
+	~jdhost();
+
+	/**
+	 * Set java interpreter used to start host (first call wins).
+	 * \param java_exe java interpreter executable
+	 * \param module_path plug-in module path
+	 */
+	void setup(const wstring& java_exe, const wstring& module_path);
+
+	/**
+	 * Check if host process is alive (doesn't wait for busy host).
+	 * \return true if host process is alive or busy
+	 */
+	bool running();
+
+	/**
+	 * Stop host process.
+	 */
+	void stop();
+
+	/**
+	 * Decompile class file with host process (may be called from any thread).
+	 * Host is started on first use (JDHost.java from plug-in directory),
+	 * host that died or stopped by idle timeout is restarted once.
+	 * Host that doesn't respond in time is stopped without retry.
+	 * Requests of several threads are serialized.
+	 * \param tool decompiler name ("cfr", "fernflower")
+	 * \param class_file java class file name
+	 * \param out_path output file (CFR) or directory (Fernflower)
+	 * \param timeout response timeout in milliseconds
+	 * \param cancel cancel flag, cancelled host is stopped (may be nullptr)
+	 * \return false if error, cancel or host is not supported by java
+	 */
+	bool decompile(const char* tool, const wstring& class_file, const wstring& out_path, const DWORD timeout, const atomic<bool>* cancel);
+
+private:
+	jdhost(const jdhost&);
+	jdhost& operator=(const jdhost&);
+
+	/**
+	 * Start host process, the process loads decompilers once and exits after idle timeout.
+	 * \return false if error
+	 */
+	bool launch();
+
+	/**
+	 * Stop host process (lock must be held).
+	 */
+	void shutdown();
+
+	/**
+	 * Check if host process is alive (lock must be held).
+	 * \return true if host process is alive
+	 */
+	bool alive() const;
+
+	/**
+	 * Check for cancel request of current call.
+	 * \return true if call is cancelled
+	 */
+	bool cancelled() const { return _cancel && *_cancel; }
+
+	/**
+	 * Send request and wait for response.
+	 * \param tool decompiler name
+	 * \param class_file java class file name
+	 * \param out_path output path
+	 * \param timeout response timeout in milliseconds
+	 * \param status output response status (0 if success)
+	 * \return false if host failed (_exited is set if host pipe is closed), true if request is processed
+	 */
+	bool call(const char* tool, const wstring& class_file, const wstring& out_path, const DWORD timeout, unsigned char& status);
+
+	/**
+	 * Read response frame.
+	 * \param timeout response timeout in milliseconds
+	 * \param status output response status
+	 * \return false if error
+	 */
+	bool read_response(const DWORD timeout, unsigned char& status);
+
+	/**
+	 * Read data from host stdout pipe.
+	 * \param buf output buffer
+	 * \param size number of bytes to read
+	 * \param deadline tick count to wait data until
+	 * \return false if error, timeout or cancel (_exited is set if host pipe is closed)
+	 */
+	bool read_pipe(void* buf, size_t size, const ULONGLONG deadline);
+
+	/**
+	 * Append string in DataOutput.writeUTF format.
+	 * \param val source string
+	 * \param out output buffer
+	 * \return false if encoded string is longer than 65535 bytes
+	 */
+	static bool put_utf(const wstring& val, string& out);
+
+private:
+	mutex				_lock;			///< Request lock
+	HANDLE				_process;		///< Host process handle
+	HANDLE				_stdin;			///< Write end of host stdin pipe
+	HANDLE				_stdout;		///< Read end of host stdout pipe
+	wstring				_java_exe;		///< Java interpreter used to (re)start host
+	wstring				_module_path;	///< Plug-in module path
+	bool				_launched;		///< Host was started at least once
+	bool				_unsupported;	///< Host can not be started by java
+	bool				_exited;		///< Host pipe was closed during last call
+	const atomic<bool>*	_cancel;		///< Cancel flag of current call
+};
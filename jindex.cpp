@@ -0,0 +1,679 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include "jindex.h"
+#include "jutf8.h"
+#include "work_pool.h"
+#include "dir_walker.h"
+#include <stdio.h>
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+
+//Cache file format
+#define INDEX_MAGIC			0x5843494a	//"JICX"
+#define INDEX_VERSION		4
+#define INDEX_HDR_SIZE		32
+#define INDEX_CLASS_SIZE	60
+#define INDEX_MEMBER_SIZE	14
+#define INDEX_REF_SIZE		12
+
+//Access flags used by hierarchy queries
+#define ACC_PRIVATE		0x0002	//Declared private; accessible only within the defining class.
+#define ACC_STATIC		0x0008	//Declared static.
+#define ACC_INTERFACE	0x0200	//Is an interface, not a class.
+#define ACC_ABSTRACT	0x0400	//Declared abstract; must not be instantiated.
+
+
+//! Little endian writers/readers for cache file
+static void put_u16(string& buf, const uint16_t v)	{ buf += static_cast<char>(v & 0xff); buf += static_cast<char>(v >> 8); }
+static void put_u32(string& buf, const uint32_t v)	{ put_u16(buf, static_cast<uint16_t>(v & 0xffff)); put_u16(buf, static_cast<uint16_t>(v >> 16)); }
+static void put_u64(string& buf, const uint64_t v)	{ put_u32(buf, static_cast<uint32_t>(v & 0xffffffff)); put_u32(buf, static_cast<uint32_t>(v >> 32)); }
+static uint16_t get_u16(const unsigned char* p)		{ return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+static uint32_t get_u32(const unsigned char* p)		{ return static_cast<uint32_t>(get_u16(p)) | (static_cast<uint32_t>(get_u16(p + 2)) << 16); }
+static uint64_t get_u64(const unsigned char* p)		{ return static_cast<uint64_t>(get_u32(p)) | (static_cast<uint64_t>(get_u32(p + 4)) << 32); }
+
+
+size_t jindex::build(const jzip& archive, jindex* cached /*= nullptr*/, const size_t threads /*= 0*/, const atomic<bool>* cancel /*= nullptr*/)
+{
+	const vector<jzip::entry>& entries = archive.entries();
+	vector<source_item> items;
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (!is_class_entry(entries[i]))
+			continue;
+		source_item si;
+		si.path = entries[i].path;
+		si.stamp = entries[i].crc;
+		si.size = entries[i].size;
+		si.entry = i;
+		items.push_back(si);
+	}
+
+	return build(items, [&archive](const source_item& si, vector<unsigned char>& buffer, mapped_file&, const unsigned char*& data, size_t& size) {
+		if (!archive.extract(si.entry, buffer) || buffer.empty())
+			return false;
+		data = &buffer.front();
+		size = buffer.size();
+		return true;
+	}, cached, threads, cancel);
+}
+
+
+size_t jindex::build(const native_path& root, jindex* cached /*= nullptr*/, const size_t threads /*= 0*/, const atomic<bool>* cancel /*= nullptr*/)
+{
+	vector<source_item> items;
+	dir_walker::walk(root, ".class", [&items](const dir_walker::file& f) {
+		source_item si;
+		si.path = f.path;
+		si.stamp = f.mtime;
+		si.size = f.size;
+		si.entry = 0;
+		si.file_name = f.full_path;
+		items.push_back(si);
+	});
+
+	return build(items, [](const source_item& si, vector<unsigned char>&, mapped_file& file, const unsigned char*& data, size_t& size) {
+		if (!file.open(si.file_name.c_str()))
+			return false;
+		data = file.data();
+		size = file.size();
+		return true;
+	}, cached, threads, cancel);
+}
+
+
+bool jindex::open(const native_path& source, const size_t threads /*= 0*/, const atomic<bool>* cancel /*= nullptr*/)
+{
+	const native_path cache_name = cache_file(source);
+	jindex cached;
+	const bool have_cache = !cache_name.empty() && cached.load(cache_name);
+
+	if (dir_walker::is_dir(source))
+		build(source, have_cache ? &cached : nullptr, threads, cancel);
+	else {
+		jzip archive;
+		if (!archive.open(source.c_str()))
+			return false;
+		build(archive, have_cache ? &cached : nullptr, threads, cancel);
+	}
+	if (cancel && *cancel)
+		return false;
+
+	//Rewrite cache only if it is outdated (another instance may already have updated it)
+	if (!cache_name.empty() && (!have_cache || _parsed || _classes.size() != cached.classes().size()))
+		save(cache_name);
+	return true;
+}
+
+
+size_t jindex::build(const vector<source_item>& items, const loader& load, jindex* cached, const size_t threads, const atomic<bool>* cancel)
+{
+	vector<jclass_entry> classes(items.size());
+	vector<bool> valid(items.size(), false);
+	vector<bool> from_cache(items.size(), false);
+	vector<vector<jclass::jref> > refs(items.size());	//References of parsed classes
+
+	//Unchanged classes are taken from previous index, only the rest is parsed
+	vector<size_t> pending;
+	_parsed = 0;
+	for (size_t i = 0; i < items.size(); ++i) {
+		if (cached) {
+			map<string, size_t>::iterator prev = cached->_paths.find(items[i].path);
+			if (prev != cached->_paths.end() && cached->_classes[prev->second].stamp == items[i].stamp && cached->_classes[prev->second].size == items[i].size) {
+				//Moved out of cache, path is removed so the entry can't be taken twice
+				classes[i] = move(cached->_classes[prev->second]);
+				cached->_paths.erase(prev);
+				valid[i] = true;
+				from_cache[i] = true;
+			}
+		}
+		if (!from_cache[i])
+			pending.push_back(i);
+	}
+
+	//Worker private state: no shared mutable data while parsing
+	struct worker_state {
+		vector<unsigned char>	buffer;		///< Scratch buffer for inflated data
+		mapped_file				file;		///< Scratch mapping for class files
+		jclass					parser;		///< Class parser (keeps its tables allocated)
+		vector<size_t>			parsed;		///< Successfully parsed items
+	};
+
+	if (!pending.empty()) {
+		work_pool pool(threads);
+		vector<worker_state> workers(pool.size());
+
+		pool.run(pending.size(), [&](const size_t index, const size_t worker) {
+			//Cancelled build skips the rest of classes, they are reported as failed
+			if (cancel && *cancel)
+				return;
+			worker_state& ws = workers[worker];
+			const size_t item = pending[index];
+			const source_item& si = items[item];
+			jclass_entry& ce = classes[item];	//Each slot is written by exactly one worker
+			const unsigned char* data = nullptr;
+			size_t size = 0;
+			if (load(si, ws.buffer, ws.file, data, size) && ws.parser.read(data, size, ce.info, ce.members)) {
+				//Line numbers are stored in the cache, so they are resolved once per changed class (members start with methods)
+				for (size_t j = 0; j < ws.parser.methods().size(); ++j)
+					ce.members[j].line = ws.parser.first_line(j);
+				ws.parser.get_refs(refs[item]);
+				ce.path = si.path;
+				ce.stamp = si.stamp;
+				ce.size = si.size;
+				ws.parsed.push_back(item);
+			}
+			ws.file.close();
+		});
+
+		//Merge per-worker results
+		for (size_t i = 0; i < workers.size(); ++i) {
+			for (size_t j = 0; j < workers[i].parsed.size(); ++j)
+				valid[workers[i].parsed[j]] = true;
+			_parsed += workers[i].parsed.size();
+		}
+	}
+
+	//References table is rebuilt, cached classes are remapped into it
+	size_t failed = 0;
+	_classes.clear();
+	_classes.reserve(items.size());
+	_refs.clear();
+	_ref_ids.clear();
+	for (size_t i = 0; i < classes.size(); ++i) {
+		if (valid[i]) {
+			jclass_entry& ce = classes[i];
+			if (from_cache[i]) {
+				for (size_t j = 0; j < ce.refs.size(); ++j)
+					ce.refs[j] = add_ref(cached->_refs[ce.refs[j]]);
+			}
+			else {
+				ce.refs.resize(refs[i].size());
+				for (size_t j = 0; j < refs[i].size(); ++j)
+					ce.refs[j] = add_ref(refs[i][j]);
+				vector<jclass::jref>().swap(refs[i]);
+			}
+			_classes.push_back(jclass_entry());
+			swap(_classes.back(), ce);
+		}
+		else
+			++failed;
+	}
+
+	update_paths();
+	update_refs();
+	update_hierarchy();
+	_failed = failed;
+	return failed;
+}
+
+
+const jindex::jclass_entry* jindex::find(const string& path) const
+{
+	map<string, size_t>::const_iterator it = _paths.find(path);
+	return it == _paths.end() ? nullptr : &_classes[it->second];
+}
+
+
+void jindex::referrers(const wstring& owner, const jclass::jmember& member, vector<size_t>& classes) const
+{
+	classes.clear();
+
+	//Owner and all its subtypes known to the index
+	vector<size_t> subclasses;
+	subtypes(owner, subclasses);
+	set<wstring> owners;
+	owners.insert(owner);
+	for (size_t i = 0; i < subclasses.size(); ++i)
+		owners.insert(_classes[subclasses[i]].info.name);
+
+	for (set<wstring>::const_iterator oit = owners.begin(); oit != owners.end(); ++oit) {
+		map<wstring, uint32_t>::const_iterator it = _ref_ids.find(ref_key(*oit, member.name, member.description));
+		if (it != _ref_ids.end())
+			classes.insert(classes.end(), _ref_classes[it->second].begin(), _ref_classes[it->second].end());
+	}
+	sort(classes.begin(), classes.end());
+	classes.erase(unique(classes.begin(), classes.end()), classes.end());
+}
+
+
+void jindex::subtypes(const wstring& name, vector<size_t>& classes) const
+{
+	classes.clear();
+	map<wstring, uint32_t>::const_iterator it = _type_ids.find(name);
+	if (it == _type_ids.end())
+		return;
+
+	//Breadth first walk over reverse edges, every type is expanded once (cycles of malformed classes stop here)
+	vector<bool> visited(_types.size(), false);
+	vector<uint32_t> queue(1, it->second);
+	visited[it->second] = true;
+	for (size_t i = 0; i < queue.size(); ++i) {
+		for (uint32_t j = _sub_offsets[queue[i]]; j < _sub_offsets[queue[i] + 1]; ++j) {
+			const uint32_t cls = _sub_classes[j];
+			classes.push_back(cls);
+			const uint32_t type = _class_types[cls];
+			if (!visited[type]) {
+				visited[type] = true;
+				queue.push_back(type);
+			}
+		}
+	}
+
+	//Class implementing several interfaces of the tree is reached more than once
+	sort(classes.begin(), classes.end());
+	classes.erase(unique(classes.begin(), classes.end()), classes.end());
+}
+
+
+void jindex::implementors(const wstring& name, vector<size_t>& classes) const
+{
+	subtypes(name, classes);
+	size_t count = 0;
+	for (size_t i = 0; i < classes.size(); ++i) {
+		if (!(_classes[classes[i]].info.access & ACC_INTERFACE))
+			classes[count++] = classes[i];
+	}
+	classes.resize(count);
+}
+
+
+size_t jindex::overriders(const wstring& owner, const jclass::jmember& method) const
+{
+	vector<size_t> classes;
+	subtypes(owner, classes);
+
+	size_t count = 0;
+	for (size_t i = 0; i < classes.size(); ++i) {
+		const vector<jclass::jmember>& members = _classes[classes[i]].members;
+		for (size_t j = 0; j < members.size(); ++j) {
+			const jclass::jmember& m = members[j];
+			if (m.type == jclass::method && !(m.access & (ACC_ABSTRACT | ACC_STATIC | ACC_PRIVATE)) &&
+				m.name == method.name && m.description == method.description) {
+				++count;
+				break;
+			}
+		}
+	}
+	return count;
+}
+
+
+void jindex::supertypes(const size_t index, vector<wstring>& names) const
+{
+	assert(index < _classes.size());
+
+	names.clear();
+	vector<bool> visited(_types.size(), false);
+	vector<uint32_t> queue(1, _class_types[index]);
+	visited[queue.front()] = true;
+	for (size_t i = 0; i < queue.size(); ++i) {
+		const uint32_t cls = _type_classes[queue[i]];
+		if (cls == JINDEX_NO_CLASS)
+			continue;
+		for (uint32_t j = _super_offsets[cls]; j < _super_offsets[cls + 1]; ++j) {
+			const uint32_t type = _super_types[j];
+			if (!visited[type]) {
+				visited[type] = true;
+				queue.push_back(type);
+				names.push_back(_types[type]);
+			}
+		}
+	}
+}
+
+
+bool jindex::load(const native_path& file_name)
+{
+	_classes.clear();
+	_paths.clear();
+	_refs.clear();
+	_ref_ids.clear();
+	_ref_classes.clear();
+	update_hierarchy();
+
+	mapped_file file;
+	if (!file.open(file_name.c_str()) || file.size() < INDEX_HDR_SIZE)
+		return false;
+	const unsigned char* data = file.data();
+	const size_t size = file.size();
+
+	if (get_u32(data) != INDEX_MAGIC || get_u32(data + 4) != INDEX_VERSION)
+		return false;
+	const uint64_t class_count = get_u32(data + 8);
+	const uint64_t member_count = get_u32(data + 12);
+	const uint64_t strings_size = get_u32(data + 16);
+	const uint64_t ref_count = get_u32(data + 20);
+	const uint64_t class_ref_count = get_u32(data + 24);
+	const uint64_t iface_count = get_u32(data + 28);
+	const uint64_t classes_offset = INDEX_HDR_SIZE;
+	const uint64_t members_offset = classes_offset + class_count * INDEX_CLASS_SIZE;
+	const uint64_t refs_offset = members_offset + member_count * INDEX_MEMBER_SIZE;
+	const uint64_t class_refs_offset = refs_offset + ref_count * INDEX_REF_SIZE;
+	const uint64_t ifaces_offset = class_refs_offset + class_ref_count * sizeof(uint32_t);
+	const uint64_t strings_offset = ifaces_offset + iface_count * sizeof(uint32_t);
+	if (strings_offset + strings_size != size)
+		return false;
+
+	const unsigned char* strings = data + strings_offset;
+	bool valid = true;
+	const auto get_str = [strings, strings_size, &valid](const uint32_t offset, string& val) {
+		if (offset + 2ull > strings_size || offset + 2ull + get_u16(strings + offset) > strings_size) {
+			valid = false;
+			return;
+		}
+		val.assign(reinterpret_cast<const char*>(strings + offset + 2), get_u16(strings + offset));
+	};
+	//Names and descriptors repeat a lot, every string of the table is decoded once
+	unordered_map<uint32_t, wstring> decoded;
+	const auto get_wstr = [strings, strings_size, &valid, &decoded](const uint32_t offset, wstring& val) {
+		unordered_map<uint32_t, wstring>::const_iterator it = decoded.find(offset);
+		if (it == decoded.end()) {
+			if (offset + 2ull > strings_size || offset + 2ull + get_u16(strings + offset) > strings_size) {
+				valid = false;
+				return;
+			}
+			wstring wide;
+			jutf8::decode(strings + offset + 2, get_u16(strings + offset), wide);
+			it = decoded.insert(make_pair(offset, wide)).first;
+		}
+		val = it->second;
+	};
+
+	_refs.resize(static_cast<size_t>(ref_count));
+	for (size_t i = 0; i < _refs.size() && valid; ++i) {
+		const unsigned char* rrec = data + refs_offset + i * INDEX_REF_SIZE;
+		get_wstr(get_u32(rrec), _refs[i].owner);
+		get_wstr(get_u32(rrec + 4), _refs[i].name);
+		get_wstr(get_u32(rrec + 8), _refs[i].description);
+		_ref_ids.insert(make_pair(ref_key(_refs[i].owner, _refs[i].name, _refs[i].description), static_cast<uint32_t>(i)));
+	}
+
+	_classes.resize(static_cast<size_t>(class_count));
+	for (size_t i = 0; i < _classes.size() && valid; ++i) {
+		const unsigned char* rec = data + classes_offset + i * INDEX_CLASS_SIZE;
+		jclass_entry& ce = _classes[i];
+		get_str(get_u32(rec), ce.path);
+		get_wstr(get_u32(rec + 4), ce.info.name);
+		get_wstr(get_u32(rec + 8), ce.info.super);
+		get_wstr(get_u32(rec + 12), ce.info.source);
+		ce.stamp = get_u64(rec + 16);
+		ce.size = get_u64(rec + 24);
+		const uint64_t first = get_u32(rec + 32);
+		const uint64_t count = get_u32(rec + 36);
+		ce.info.access = get_u16(rec + 40);
+		const uint64_t first_ref = get_u32(rec + 44);
+		const uint64_t refs_count = get_u32(rec + 48);
+		const uint64_t first_iface = get_u32(rec + 52);
+		const uint64_t ifaces = get_u32(rec + 56);
+		if (first + count > member_count || first_ref + refs_count > class_ref_count || first_iface + ifaces > iface_count) {
+			valid = false;
+			break;
+		}
+		ce.info.interfaces.resize(static_cast<size_t>(ifaces));
+		for (size_t j = 0; j < ce.info.interfaces.size(); ++j)
+			get_wstr(get_u32(data + ifaces_offset + (first_iface + j) * sizeof(uint32_t)), ce.info.interfaces[j]);
+		ce.refs.resize(static_cast<size_t>(refs_count));
+		for (size_t j = 0; j < ce.refs.size(); ++j) {
+			ce.refs[j] = get_u32(data + class_refs_offset + (first_ref + j) * sizeof(uint32_t));
+			if (ce.refs[j] >= ref_count) {
+				valid = false;
+				break;
+			}
+		}
+		ce.members.resize(static_cast<size_t>(count));
+		for (size_t j = 0; j < ce.members.size(); ++j) {
+			const unsigned char* mrec = data + members_offset + (first + j) * INDEX_MEMBER_SIZE;
+			jclass::jmember& m = ce.members[j];
+			get_wstr(get_u32(mrec), m.name);
+			get_wstr(get_u32(mrec + 4), m.description);
+			m.access = get_u16(mrec + 8);
+			m.line = get_u16(mrec + 10);
+			m.type = mrec[12] ? jclass::method : jclass::field;
+		}
+	}
+
+	if (!valid) {
+		_classes.clear();
+		_refs.clear();
+		_ref_ids.clear();
+		_ref_classes.clear();
+		update_hierarchy();
+		return false;
+	}
+
+	update_paths();
+	update_refs();
+	update_hierarchy();
+	return true;
+}
+
+
+bool jindex::save(const native_path& file_name) const
+{
+	//String table with deduplication (descriptors and names repeat a lot)
+	string strings;
+	map<string, uint32_t> string_ids;
+	const auto add_str = [&strings, &string_ids](const string& val) -> uint32_t {
+		const string v = val.length() > 0xffff ? val.substr(0, 0xffff) : val;
+		map<string, uint32_t>::const_iterator it = string_ids.find(v);
+		if (it != string_ids.end())
+			return it->second;
+		const uint32_t id = static_cast<uint32_t>(strings.length());
+		put_u16(strings, static_cast<uint16_t>(v.length()));
+		strings += v;
+		string_ids.insert(make_pair(v, id));
+		return id;
+	};
+	const auto add_wstr = [&add_str](const wstring& val) -> uint32_t {
+		string enc;
+		jutf8::encode(val, enc);
+		return add_str(enc);
+	};
+
+	string classes, members, refs, class_refs, ifaces;
+	uint32_t member_count = 0;
+	uint32_t class_ref_count = 0;
+	uint32_t iface_count = 0;
+	for (size_t i = 0; i < _classes.size(); ++i) {
+		const jclass_entry& ce = _classes[i];
+		put_u32(classes, add_str(ce.path));
+		put_u32(classes, add_wstr(ce.info.name));
+		put_u32(classes, add_wstr(ce.info.super));
+		put_u32(classes, add_wstr(ce.info.source));
+		put_u64(classes, ce.stamp);
+		put_u64(classes, ce.size);
+		put_u32(classes, member_count);
+		put_u32(classes, static_cast<uint32_t>(ce.members.size()));
+		put_u16(classes, ce.info.access);
+		put_u16(classes, 0);
+		put_u32(classes, class_ref_count);
+		put_u32(classes, static_cast<uint32_t>(ce.refs.size()));
+		for (size_t j = 0; j < ce.refs.size(); ++j)
+			put_u32(class_refs, ce.refs[j]);
+		class_ref_count += static_cast<uint32_t>(ce.refs.size());
+		put_u32(classes, iface_count);
+		put_u32(classes, static_cast<uint32_t>(ce.info.interfaces.size()));
+		for (size_t j = 0; j < ce.info.interfaces.size(); ++j)
+			put_u32(ifaces, add_wstr(ce.info.interfaces[j]));
+		iface_count += static_cast<uint32_t>(ce.info.interfaces.size());
+		for (size_t j = 0; j < ce.members.size(); ++j) {
+			const jclass::jmember& m = ce.members[j];
+			put_u32(members, add_wstr(m.name));
+			put_u32(members, add_wstr(m.description));
+			put_u16(members, m.access);
+			put_u16(members, m.line);
+			members += static_cast<char>(m.type == jclass::method ? 1 : 0);
+			members += '\0';
+		}
+		member_count += static_cast<uint32_t>(ce.members.size());
+	}
+	for (size_t i = 0; i < _refs.size(); ++i) {
+		put_u32(refs, add_wstr(_refs[i].owner));
+		put_u32(refs, add_wstr(_refs[i].name));
+		put_u32(refs, add_wstr(_refs[i].description));
+	}
+
+	string hdr;
+	put_u32(hdr, INDEX_MAGIC);
+	put_u32(hdr, INDEX_VERSION);
+	put_u32(hdr, static_cast<uint32_t>(_classes.size()));
+	put_u32(hdr, member_count);
+	put_u32(hdr, static_cast<uint32_t>(strings.length()));
+	put_u32(hdr, static_cast<uint32_t>(_refs.size()));
+	put_u32(hdr, class_ref_count);
+	put_u32(hdr, iface_count);
+	hdr.resize(INDEX_HDR_SIZE, '\0');
+
+	//Replace the cache atomically, concurrent readers keep the old file
+	string data;
+	data.reserve(hdr.size() + classes.size() + members.size() + refs.size() + class_refs.size() + ifaces.size() + strings.size());
+	data += hdr;
+	data += classes;
+	data += members;
+	data += refs;
+	data += class_refs;
+	data += ifaces;
+	data += strings;
+	return dir_walker::replace_file(file_name, data.data(), data.size());
+}
+
+
+native_path jindex::cache_file(const native_path& source)
+{
+	//FNV-1a hash of the source path names the cache file
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < source.length(); ++i) {
+		hash ^= static_cast<uint64_t>(source[i]);
+		hash *= 0x100000001b3ull;
+	}
+
+	const native_path dir = dir_walker::cache_dir("index");
+	if (dir.empty())
+		return dir;
+#ifdef _WIN32
+	wchar_t name[32];
+	swprintf(name, sizeof(name) / sizeof(name[0]), L"\\%016llx.jcx", static_cast<unsigned long long>(hash));
+#else
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.jcx", static_cast<unsigned long long>(hash));
+#endif
+
+	return dir + name;
+}
+
+
+bool jindex::is_class_entry(const jzip::entry& e)
+{
+	static const char* ext = ".class";
+	static const size_t ext_len = 6;
+	return !e.shadowed && e.path.length() > ext_len && e.path.compare(e.path.length() - ext_len, ext_len, ext) == 0;
+}
+
+
+void jindex::update_paths()
+{
+	_paths.clear();
+	for (size_t i = 0; i < _classes.size(); ++i)
+		_paths.insert(make_pair(_classes[i].path, i));
+}
+
+
+uint32_t jindex::add_ref(const jclass::jref& r)
+{
+	const pair<map<wstring, uint32_t>::iterator, bool> it = _ref_ids.insert(make_pair(ref_key(r.owner, r.name, r.description), static_cast<uint32_t>(_refs.size())));
+	if (it.second)
+		_refs.push_back(r);
+	return it.first->second;
+}
+
+
+void jindex::update_refs()
+{
+	//Classes are visited in order, so every list is sorted
+	_ref_classes.clear();
+	_ref_classes.resize(_refs.size());
+	for (size_t i = 0; i < _classes.size(); ++i) {
+		const vector<uint32_t>& refs = _classes[i].refs;
+		for (size_t j = 0; j < refs.size(); ++j) {
+			vector<size_t>& rc = _ref_classes[refs[j]];
+			if (rc.empty() || rc.back() != i)
+				rc.push_back(i);
+		}
+	}
+}
+
+
+void jindex::update_hierarchy()
+{
+	_types.clear();
+	_type_ids.clear();
+	_type_classes.clear();
+
+	//Forward edges: direct super class and interfaces of every class
+	const size_t class_count = _classes.size();
+	_class_types.resize(class_count);
+	for (size_t i = 0; i < class_count; ++i) {
+		_class_types[i] = add_type(_classes[i].info.name);
+		if (_type_classes[_class_types[i]] == JINDEX_NO_CLASS)
+			_type_classes[_class_types[i]] = static_cast<uint32_t>(i);
+	}
+	_super_offsets.resize(class_count + 1);
+	_super_types.clear();
+	for (size_t i = 0; i < class_count; ++i) {
+		const jclass::jclassinfo& info = _classes[i].info;
+		_super_offsets[i] = static_cast<uint32_t>(_super_types.size());
+		if (!info.super.empty())
+			_super_types.push_back(add_type(info.super));
+		for (size_t j = 0; j < info.interfaces.size(); ++j)
+			_super_types.push_back(add_type(info.interfaces[j]));
+	}
+	_super_offsets[class_count] = static_cast<uint32_t>(_super_types.size());
+
+	//Reverse edges by counting sort of forward edges, classes are visited in order, so every list is sorted
+	_sub_offsets.assign(_types.size() + 1, 0);
+	for (size_t i = 0; i < _super_types.size(); ++i)
+		++_sub_offsets[_super_types[i] + 1];
+	for (size_t i = 1; i < _sub_offsets.size(); ++i)
+		_sub_offsets[i] += _sub_offsets[i - 1];
+	vector<uint32_t> pos(_sub_offsets.begin(), _sub_offsets.end() - 1);
+	_sub_classes.resize(_super_types.size());
+	for (size_t i = 0; i < class_count; ++i) {
+		for (uint32_t j = _super_offsets[i]; j < _super_offsets[i + 1]; ++j)
+			_sub_classes[pos[_super_types[j]]++] = static_cast<uint32_t>(i);
+	}
+}
+
+
+uint32_t jindex::add_type(const wstring& name)
+{
+	const pair<map<wstring, uint32_t>::iterator, bool> it = _type_ids.insert(make_pair(name, static_cast<uint32_t>(_types.size())));
+	if (it.second) {
+		_types.push_back(name);
+		_type_classes.push_back(JINDEX_NO_CLASS);
+	}
+	return it.first->second;
+}
+
+
+wstring jindex::ref_key(const wstring& owner, const wstring& name, const wstring& description)
+{
+	//Names can't contain '.', ';' and '[' (JVMS 4.2.2)
+	return owner + L'.' + name + L';' + description;
+}
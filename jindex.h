@@ -0,0 +1,259 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#include "jclass.h"
+#include "jzip.h"
+#include <functional>
+#include <atomic>
+
+//! Type of hierarchy without indexed class
+#define JINDEX_NO_CLASS		0xffffffff
+
+
+class jindex
+{
+public:
+	//! Indexed class description.
+	struct jclass_entry {
+		string						path;		///< Class path (archive entry or file path relative to root)
+		uint64_t					stamp;		///< Change stamp (CRC32 for archive entries, mtime for files)
+		uint64_t					size;		///< Class file size
+		jclass::jclassinfo			info;		///< Class description
+		vector<jclass::jmember>		members;	///< Class members
+		vector<uint32_t>			refs;		///< Referenced fields and methods (indexes in references table)
+	};
+
+	jindex() : _parsed(0), _failed(0) {}
+
+	/**
+	 * Build members index of all classes in archive.
+	 * Entries are inflated and parsed in parallel, every worker uses its own
+	 * scratch buffer and parser, results are merged in archive order.
+	 * \param archive opened archive
+	 * \param cached previous index, classes with unchanged stamp and size are moved out of it (may be nullptr)
+	 * \param threads number of worker threads (0 to use all hardware threads)
+	 * \param cancel cancel flag, classes are not parsed after it is set (may be nullptr)
+	 * \return number of classes that failed to parse
+	 */
+	size_t build(const jzip& archive, jindex* cached = nullptr, const size_t threads = 0, const atomic<bool>* cancel = nullptr);
+
+	/**
+	 * Build members index of all classes in directory tree.
+	 * \param root root directory
+	 * \param cached previous index, classes with unchanged stamp and size are moved out of it (may be nullptr)
+	 * \param threads number of worker threads (0 to use all hardware threads)
+	 * \param cancel cancel flag, classes are not parsed after it is set (may be nullptr)
+	 * \return number of classes that failed to parse
+	 */
+	size_t build(const native_path& root, jindex* cached = nullptr, const size_t threads = 0, const atomic<bool>* cancel = nullptr);
+
+	/**
+	 * Open index of archive or class directory through the persistent cache.
+	 * The cache file is loaded first, only new or changed classes are parsed,
+	 * the cache is rewritten if anything was parsed or removed.
+	 * \param source full path of archive or directory
+	 * \param threads number of worker threads (0 to use all hardware threads)
+	 * \param cancel cancel flag, cancelled index is incomplete and is not saved (may be nullptr)
+	 * \return false if source can not be opened or build is cancelled
+	 */
+	bool open(const native_path& source, const size_t threads = 0, const atomic<bool>* cancel = nullptr);
+
+	/**
+	 * Get number of classes parsed by the last build (not taken from cache).
+	 * \return number of parsed classes
+	 */
+	size_t parsed() const { return _parsed; }
+
+	/**
+	 * Get number of classes that failed to parse in the last build (they are not indexed).
+	 * \return number of failed classes
+	 */
+	size_t failed() const { return _failed; }
+
+	/**
+	 * Get indexed classes.
+	 * \return classes array
+	 */
+	const vector<jclass_entry>& classes() const { return _classes; }
+
+	/**
+	 * Find class by path.
+	 * \param path class path
+	 * \return class description (nullptr if not found)
+	 */
+	const jclass_entry* find(const string& path) const;
+
+	/**
+	 * Get table of fields and methods referenced by indexed classes.
+	 * \return references table
+	 */
+	const vector<jclass::jref>& refs() const { return _refs; }
+
+	/**
+	 * Find classes that reference member.
+	 * References through subclasses of the owner are included (the JVM
+	 * resolves them upwards), the subclasses are taken from the index.
+	 * \param owner class name of member
+	 * \param member member description
+	 * \param classes output indexes of referencing classes (ascending)
+	 */
+	void referrers(const wstring& owner, const jclass::jmember& member, vector<size_t>& classes) const;
+
+	/**
+	 * Find all subtypes of class or interface.
+	 * \param name class or interface name (need not be indexed itself)
+	 * \param classes output indexes of classes that extend or implement it directly or indirectly (ascending)
+	 */
+	void subtypes(const wstring& name, vector<size_t>& classes) const;
+
+	/**
+	 * Find all implementors of interface (or subclasses of class).
+	 * \param name interface or class name
+	 * \param classes output indexes of subtypes that are not interfaces (ascending)
+	 */
+	void implementors(const wstring& name, vector<size_t>& classes) const;
+
+	/**
+	 * Count overriders of method.
+	 * Subtypes that declare a non-abstract instance method with the same name
+	 * and descriptor are counted, the owner's own implementation is not.
+	 * \param owner class or interface name of method
+	 * \param method method description
+	 * \return number of overriding classes
+	 */
+	size_t overriders(const wstring& owner, const jclass::jmember& method) const;
+
+	/**
+	 * Get all supertypes of indexed class.
+	 * Supertypes of classes that are not indexed are unknown.
+	 * \param index class index
+	 * \param names output super class and interface names (breadth first order)
+	 */
+	void supertypes(const size_t index, vector<wstring>& names) const;
+
+	/**
+	 * Load index from cache file.
+	 * \param file_name cache file name
+	 * \return false if file doesn't exist or has incompatible format
+	 */
+	bool load(const native_path& file_name);
+
+	/**
+	 * Save index to cache file.
+	 * The file is replaced atomically, so concurrent readers keep their mapping.
+	 * \param file_name cache file name
+	 * \return false if error
+	 */
+	bool save(const native_path& file_name) const;
+
+	/**
+	 * Get cache file name for archive or class directory.
+	 * \param source full path of archive or directory
+	 * \return cache file name (empty if cache directory is not available)
+	 */
+	static native_path cache_file(const native_path& source);
+
+	/**
+	 * Check for class entry name.
+	 * \param e archive entry
+	 * \return true if entry is a visible class file
+	 */
+	static bool is_class_entry(const jzip::entry& e);
+
+private:
+	//! Class source for indexing.
+	struct source_item {
+		string		path;		///< Class path
+		uint64_t	stamp;		///< Change stamp
+		uint64_t	size;		///< Class file size
+		size_t		entry;		///< Archive entry index
+		native_path	file_name;	///< Class file name (directory mode)
+	};
+
+	//! Class data loader: item index, scratch buffer, scratch mapping, output data pointer and size.
+	typedef function<bool(const source_item&, vector<unsigned char>&, mapped_file&, const unsigned char*&, size_t&)> loader;
+
+	/**
+	 * Index classes in parallel.
+	 * \param items class sources
+	 * \param load class data loader
+	 * \param cached previous index, reused classes are moved out of it (may be nullptr)
+	 * \param threads number of worker threads
+	 * \param cancel cancel flag (may be nullptr)
+	 * \return number of classes that failed to parse
+	 */
+	size_t build(const vector<source_item>& items, const loader& load, jindex* cached, const size_t threads, const atomic<bool>* cancel);
+
+	/**
+	 * Rebuild path lookup table.
+	 */
+	void update_paths();
+
+	/**
+	 * Add reference to references table.
+	 * \param r reference
+	 * \return reference index in table
+	 */
+	uint32_t add_ref(const jclass::jref& r);
+
+	/**
+	 * Rebuild inverted table of referencing classes.
+	 */
+	void update_refs();
+
+	/**
+	 * Get reference lookup key.
+	 * \param owner class name
+	 * \param name member name
+	 * \param description member description
+	 * \return key
+	 */
+	static wstring ref_key(const wstring& owner, const wstring& name, const wstring& description);
+
+	/**
+	 * Rebuild class hierarchy tables.
+	 */
+	void update_hierarchy();
+
+	/**
+	 * Add type name to hierarchy types table.
+	 * \param name type name
+	 * \return type index in table
+	 */
+	uint32_t add_type(const wstring& name);
+
+private:
+	vector<jclass_entry>	_classes;	///< Indexed classes
+	map<string, size_t>		_paths;		///< Class path to index map
+	vector<jclass::jref>	_refs;		///< Referenced fields and methods
+	map<wstring, uint32_t>	_ref_ids;	///< Reference key to index in references table map
+	vector<vector<size_t> >	_ref_classes;	///< Referencing classes of every reference (inverted index)
+	vector<wstring>			_types;			///< Hierarchy type names (indexed classes and their supertypes)
+	map<wstring, uint32_t>	_type_ids;		///< Type name to index in types table map
+	vector<uint32_t>		_type_classes;	///< Indexed class of every type (JINDEX_NO_CLASS if not indexed)
+	vector<uint32_t>		_class_types;	///< Type of every indexed class
+	vector<uint32_t>		_super_offsets;	///< Class i extends _super_types[_super_offsets[i], _super_offsets[i + 1])
+	vector<uint32_t>		_super_types;	///< Direct supertypes of classes (type indexes)
+	vector<uint32_t>		_sub_offsets;	///< Type t is extended by _sub_classes[_sub_offsets[t], _sub_offsets[t + 1])
+	vector<uint32_t>		_sub_classes;	///< Direct subtypes of types (class indexes, ascending for every type)
+	size_t					_parsed;	///< Number of classes parsed (not taken from cache) by last build
+	size_t					_failed;	///< Number of classes failed to parse by last build
+};
@@ -0,0 +1,568 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include "jlinemap.h"
+#include "jtformat.h"
+#include "jutf8.h"
+#include <algorithm>
+
+
+/**
+ * Check for identifier character (non-ASCII bytes are treated as letters).
+ * \param c character to check
+ * \return true if character can be part of identifier
+ */
+static bool is_ident_char(const char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$' || (c & 0x80);
+}
+
+
+/**
+ * Check for java keyword that can not be a member or type name.
+ * \param val identifier
+ * \return true if identifier is a keyword
+ */
+static bool is_keyword(const string& val)
+{
+	static const char* keywords[] = {
+		"abstract", "case", "class", "default", "else", "enum", "extends", "final", "implements", "import", "instanceof",
+		"interface", "native", "new", "package", "private", "protected", "public", "return", "static", "strictfp",
+		"super", "synchronized", "this", "throw", "throws", "transient", "volatile"
+	};
+	for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); ++i) {
+		if (val == keywords[i])
+			return true;
+	}
+	return false;
+}
+
+
+bool jlinemap::read(const native_char* file_name)
+{
+	assert(file_name && *file_name);
+
+	mapped_file file;
+	if (!file.open(file_name)) {
+		read(nullptr, 0);
+		return false;
+	}
+	read(reinterpret_cast<const char*>(file.data()), file.size());
+	return true;
+}
+
+
+void jlinemap::read(const char* data, const size_t size)
+{
+	reset();
+	update(data, size, true);
+}
+
+
+void jlinemap::reset()
+{
+	_lines.clear();
+	_methods.clear();
+	_src_lines.clear();
+	_tokens.clear();
+	_tokenized = 0;
+	_tok_line = 1;
+	_tok_line_start = true;
+}
+
+
+void jlinemap::update(const char* data, const size_t size, const bool last)
+{
+	assert(size >= _tokenized);
+
+	tokenize(data, size, last);
+	if (last) {
+		parse(_tokens);
+		vector<token>().swap(_tokens);
+	}
+}
+
+
+intptr_t jlinemap::find(const jclass::jmember& member) const
+{
+	string name;
+	jutf8::encode(member.name, name);
+
+	if (member.type == jclass::field)
+		return find("f:" + name);
+
+	const string key = "m:" + name;
+
+	//Source line number comment leads to the method body, declaration is the nearest one above it
+	if (member.line) {
+		map<unsigned long, intptr_t>::const_iterator it = _src_lines.lower_bound(member.line);
+		if (it != _src_lines.end()) {
+			map<string, vector<intptr_t> >::const_iterator decl = _methods.find(key);
+			if (decl == _methods.end())
+				return it->second;
+			vector<intptr_t>::const_iterator ln = upper_bound(decl->second.begin(), decl->second.end(), it->second);
+			if (ln != decl->second.begin())
+				return *(--ln);
+		}
+	}
+
+	//Parameter types in the same form as params_key builds them
+	string args;
+	try {
+		jutf8::encode(jtformat().get_args(member), args);
+	}
+	catch (exception&) {
+		args.clear();
+	}
+	string params;
+	size_t arity = 0;
+	size_t pos = 0;
+	while (pos < args.length()) {
+		const size_t next = args.find_first_of(",)", pos);
+		string type = args.substr(pos, next == string::npos ? string::npos : next - pos);
+		type.erase(0, type.find_first_not_of(" ("));
+		const size_t nested = type.rfind('$');
+		if (nested != string::npos)
+			type.erase(0, nested + 1);
+		if (!type.empty()) {
+			if (arity++)
+				params += ',';
+			params += type;
+		}
+		pos = (next == string::npos ? next : next + 1);
+	}
+
+	intptr_t line = find(key + '(' + params + ')');
+	if (!line)
+		line = find(key + '/' + to_string(arity));
+	if (!line)
+		line = find(key);
+	return line;
+}
+
+
+void jlinemap::tokenize(const char* data, const size_t size, const bool last)
+{
+	intptr_t line = _tok_line;
+	bool line_start = _tok_line_start;	//Only white spaces from the beginning of line
+
+	//Tokens never span new lines, except block comments and text blocks
+	size_t limit = size;
+	if (!last) {
+		while (limit > _tokenized && data[limit - 1] != '\n')
+			--limit;
+	}
+
+	size_t pos = _tokenized;
+	while (pos < limit) {
+		const char c = data[pos];
+
+		if (c == '\n') {
+			++line;
+			line_start = true;
+			++pos;
+			continue;
+		}
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\f') {
+			++pos;
+			continue;
+		}
+
+		//Line comment
+		if (c == '/' && pos + 1 < limit && data[pos + 1] == '/') {
+			while (pos < limit && data[pos] != '\n')
+				++pos;
+			continue;
+		}
+
+		//Block comment, a number alone at the beginning of line is a source line (JAD -lnc)
+		if (c == '/' && pos + 1 < limit && data[pos + 1] == '*') {
+			const size_t begin = pos + 2;
+			const intptr_t begin_line = line;
+			pos = begin;
+			while (pos + 1 < limit && !(data[pos] == '*' && data[pos + 1] == '/')) {
+				if (data[pos] == '\n')
+					++line;
+				++pos;
+			}
+			if (!last && pos + 1 >= limit) {
+				//Not closed yet, wait for more data
+				pos = begin - 2;
+				line = begin_line;
+				break;
+			}
+			const size_t end = pos;
+			pos = min(pos + 2, limit);
+			if (line_start && line == begin_line) {
+				unsigned long num = 0;
+				bool valid = end > begin;
+				for (size_t i = begin; valid && i < end; ++i) {
+					if (data[i] >= '0' && data[i] <= '9')
+						num = num * 10 + (data[i] - '0');
+					else
+						valid = (data[i] == ' ');
+				}
+				if (valid && num)
+					_src_lines.insert(make_pair(num, line));
+			}
+			line_start = false;
+			continue;
+		}
+
+		line_start = false;
+
+		token t;
+		t.line = line;
+
+		if (c == '"' || c == '\'') {
+			t.type = tt_literal;
+			if (c == '"' && pos + 2 < limit && data[pos + 1] == '"' && data[pos + 2] == '"') {
+				//Text block
+				const size_t begin = pos;
+				pos += 3;
+				while (pos + 2 < limit && !(data[pos] == '"' && data[pos + 1] == '"' && data[pos + 2] == '"')) {
+					if (data[pos] == '\\')
+						++pos;
+					if (data[pos] == '\n')
+						++line;
+					++pos;
+				}
+				if (!last && pos + 2 >= limit) {
+					//Not closed yet, wait for more data
+					pos = begin;
+					line = t.line;
+					break;
+				}
+				pos = min(pos + 3, limit);
+			}
+			else {
+				++pos;
+				while (pos < limit && data[pos] != c && data[pos] != '\n') {
+					if (data[pos] == '\\')
+						++pos;
+					++pos;
+				}
+				if (pos < limit && data[pos] == c)
+					++pos;
+			}
+		}
+		else if (is_ident_char(c)) {
+			const size_t begin = pos;
+			while (pos < limit && is_ident_char(data[pos]))
+				++pos;
+			if (c >= '0' && c <= '9')
+				t.type = tt_literal;
+			else {
+				t.type = tt_ident;
+				t.text.assign(data + begin, pos - begin);
+			}
+		}
+		else if (c == '.' && pos + 2 < limit && data[pos + 1] == '.' && data[pos + 2] == '.') {
+			t.type = tt_punct;
+			t.text = "...";
+			pos += 3;
+		}
+		else {
+			t.type = tt_punct;
+			t.text = c;
+			++pos;
+		}
+
+		_tokens.push_back(t);
+	}
+
+	_tokenized = pos;
+	_tok_line = line;
+	_tok_line_start = line_start;
+}
+
+
+void jlinemap::parse(const vector<token>& tokens)
+{
+	string class_name;			//Top level type name
+	bool enum_body = false;		//Enum constants are expected
+	bool method_hdr = false;	//Method declaration parsed, waiting for its body
+	bool field_decl = false;	//Field declaration parsed, more declarators may follow
+	vector<size_t> hdr;			//Significant tokens of current declaration
+	size_t depth = 0;			//Braces depth
+
+	for (size_t i = 0; i < tokens.size(); ++i) {
+		const token& t = tokens[i];
+
+		if (depth == 0) {
+			if (t.type == tt_ident && class_name.empty() && (t.text == "class" || t.text == "interface" || t.text == "enum") &&
+				(i == 0 || tokens[i - 1].text != ".") && i + 1 < tokens.size() && tokens[i + 1].type == tt_ident) {
+				//javap prints qualified name
+				class_name = tokens[++i].text;
+				while (i + 2 < tokens.size() && tokens[i + 1].text == "." && tokens[i + 2].type == tt_ident) {
+					i += 2;
+					class_name = tokens[i].text;
+				}
+				enum_body = (t.text == "enum");
+			}
+			else if (t.type == tt_punct && t.text == "{" && !class_name.empty()) {
+				depth = 1;
+				hdr.clear();
+			}
+			continue;
+		}
+
+		//Only members of the top level type are indexed, bodies are skipped
+		if (depth > 1) {
+			if (t.type != tt_punct)
+				continue;
+			if (t.text == "{")
+				++depth;
+			else if (t.text == "}" && --depth == 1) {
+				hdr.clear();
+				method_hdr = field_decl = false;
+			}
+			continue;
+		}
+
+		if (t.type == tt_punct && t.text == "@") {
+			i = skip_annotation(tokens, i) - 1;
+			continue;
+		}
+
+		//Enum constants: "A, B(1), C { ... };"
+		if (enum_body) {
+			if (t.type == tt_ident && i + 1 < tokens.size()) {
+				const string& next = tokens[i + 1].text;
+				if (next == "(" || next == "," || next == ";" || next == "{" || next == "}") {
+					add("f:" + t.text, t.line);
+					if (next == "(")
+						i = group_end(tokens, i + 1);
+					continue;
+				}
+			}
+			if (t.text == ",")
+				continue;
+			if (t.text == "{") {
+				depth = 2;
+				continue;
+			}
+			enum_body = false;
+			if (t.text == ";")
+				continue;
+		}
+
+		if (t.type != tt_punct) {
+			hdr.push_back(i);
+			continue;
+		}
+
+		if (t.text == "(") {
+			const size_t end = group_end(tokens, i);
+			if (!method_hdr && !hdr.empty() && tokens[hdr.back()].type == tt_ident && !is_keyword(tokens[hdr.back()].text)) {
+				const token& name = tokens[hdr.back()];
+				const bool ctor = (name.text == class_name);
+				if (ctor || (hdr.size() > 1 && is_type_end(tokens[hdr[hdr.size() - 2]]))) {
+					size_t arity = 0;
+					const string params = params_key(tokens, i + 1, end, arity);
+					const string key = "m:" + (ctor ? string("<init>") : name.text);
+					add(key + '(' + params + ')', name.line);
+					add(key + '/' + to_string(arity), name.line);
+					add(key, name.line);
+					_methods[key].push_back(name.line);
+					method_hdr = true;
+				}
+			}
+			i = end;
+		}
+		else if (t.text == "{") {
+			//Static initializer
+			if (!method_hdr && hdr.size() == 1 && tokens[hdr[0]].text == "static") {
+				add("m:<clinit>", tokens[hdr[0]].line);
+				_methods["m:<clinit>"].push_back(tokens[hdr[0]].line);
+			}
+			depth = 2;
+			hdr.clear();
+			method_hdr = field_decl = false;
+		}
+		else if (t.text == "}") {
+			depth = 0;
+			hdr.clear();
+			method_hdr = field_decl = false;
+		}
+		else if (t.text == ";" || t.text == "=" || t.text == ",") {
+			bool field = false;
+			if (!method_hdr) {
+				//Old style array declaration: "int a[];"
+				size_t n = hdr.size();
+				while (n >= 2 && tokens[hdr[n - 1]].text == "]" && tokens[hdr[n - 2]].text == "[")
+					n -= 2;
+				if (n && tokens[hdr[n - 1]].type == tt_ident && !is_keyword(tokens[hdr[n - 1]].text) &&
+					((n > 1 && is_type_end(tokens[hdr[n - 2]])) || (n == 1 && field_decl))) {
+					add("f:" + tokens[hdr[n - 1]].text, tokens[hdr[n - 1]].line);
+					field = field_decl = true;
+				}
+			}
+
+			if (t.text == ";") {
+				hdr.clear();
+				method_hdr = field_decl = false;
+			}
+			else if (!field)
+				hdr.push_back(i);	//Comma in type arguments or throws list
+			else if (t.text == ",")
+				hdr.clear();
+			else {
+				//Skip initializer up to the next declarator
+				int nested = 0;
+				size_t j = i + 1;
+				for (; j < tokens.size(); ++j) {
+					const string& s = tokens[j].text;
+					if (tokens[j].type != tt_punct)
+						continue;
+					if (nested == 0 && (s == "," || s == ";" || s == "}"))
+						break;
+					if (s == "(" || s == "[" || s == "{")
+						++nested;
+					else if (s == ")" || s == "]" || s == "}")
+						--nested;
+				}
+				hdr.clear();
+				if (j < tokens.size() && tokens[j].text == ";")
+					field_decl = false;
+				i = (j < tokens.size() && tokens[j].text == "}") ? j - 1 : j;
+			}
+		}
+		else
+			hdr.push_back(i);
+	}
+}
+
+
+size_t jlinemap::group_end(const vector<token>& tokens, const size_t begin)
+{
+	const string& open = tokens[begin].text;
+	const char* close = (open == "(" ? ")" : (open == "[" ? "]" : "}"));
+	int nested = 0;
+	for (size_t i = begin; i < tokens.size(); ++i) {
+		if (tokens[i].type != tt_punct)
+			continue;
+		if (tokens[i].text == open)
+			++nested;
+		else if (tokens[i].text == close && --nested == 0)
+			return i;
+	}
+	return tokens.size() - 1;
+}
+
+
+size_t jlinemap::skip_annotation(const vector<token>& tokens, const size_t begin)
+{
+	//"@Name", "@pkg.Name", "@Name(...)"
+	size_t i = begin + 1;
+	if (i < tokens.size() && tokens[i].type == tt_ident && tokens[i].text != "interface") {
+		++i;
+		while (i + 1 < tokens.size() && tokens[i].text == "." && tokens[i + 1].type == tt_ident)
+			i += 2;
+		if (i < tokens.size() && tokens[i].type == tt_punct && tokens[i].text == "(")
+			i = group_end(tokens, i) + 1;
+	}
+	return i;
+}
+
+
+bool jlinemap::is_type_end(const token& t)
+{
+	if (t.type == tt_ident)
+		return !is_keyword(t.text);
+	return t.type == tt_punct && (t.text == ">" || t.text == "]");
+}
+
+
+string jlinemap::params_key(const vector<token>& tokens, const size_t begin, const size_t end, size_t& arity)
+{
+	string key;
+	arity = 0;
+
+	size_t pos = begin;
+	while (pos < end) {
+		//Parameter tokens outside of type arguments, without annotations and modifiers
+		vector<const token*> param;
+		int angle = 0;
+		for (; pos < end; ++pos) {
+			const token& t = tokens[pos];
+			if (t.type == tt_punct) {
+				if (t.text == "<")
+					++angle;
+				else if (t.text == ">")
+					--angle;
+				else if (angle == 0 && t.text == ",")
+					break;
+				else if (angle == 0 && t.text == "@")
+					pos = skip_annotation(tokens, pos) - 1;
+				else if (angle == 0)
+					param.push_back(&t);
+			}
+			else if (angle == 0 && !(t.type == tt_ident && t.text == "final"))
+				param.push_back(&t);
+		}
+		++pos;
+
+		size_t n = param.size();
+		size_t dims = 0;
+		while (n >= 2 && param[n - 1]->text == "]" && param[n - 2]->text == "[") {
+			++dims;
+			n -= 2;
+		}
+
+		//Declarations from javap have no parameter names
+		if (n >= 2 && param[n - 1]->type == tt_ident &&
+			(param[n - 2]->type == tt_ident || param[n - 2]->text == "]" || param[n - 2]->text == "..."))
+			--n;
+
+		string type;
+		for (size_t i = 0; i < n; ++i) {
+			if (param[i]->type == tt_ident)
+				type = param[i]->text;
+			else if (param[i]->text == "[" || param[i]->text == "...")
+				++dims;
+		}
+		if (type.empty())
+			continue;
+		const size_t nested = type.rfind('$');
+		if (nested != string::npos)
+			type.erase(0, nested + 1);
+		for (size_t i = 0; i < dims; ++i)
+			type += "[]";
+
+		if (arity++)
+			key += ',';
+		key += type;
+	}
+
+	return key;
+}
+
+
+void jlinemap::add(const string& key, const intptr_t line)
+{
+	_lines.insert(make_pair(key, line));
+}
+
+
+intptr_t jlinemap::find(const string& key) const
+{
+	map<string, intptr_t>::const_iterator it = _lines.find(key);
+	return it == _lines.end() ? 0 : it->second;
+}
@@ -0,0 +1,154 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#include "jclass.h"
+
+
+class jlinemap
+{
+public:
+	jlinemap() : _tokenized(0), _tok_line(1), _tok_line_start(true) {}
+
+	/**
+	 * Build member to line table from decompiled java source file.
+	 * The file is tokenized once, declarations of the top level type are
+	 * recorded together with source line number comments (JAD -lnc).
+	 * \param file_name decompiled source file name
+	 * \return false if file can not be read
+	 */
+	bool read(const native_char* file_name);
+
+	/**
+	 * Build member to line table from decompiled java source.
+	 * \param data source text
+	 * \param size source text size
+	 */
+	void read(const char* data, const size_t size);
+
+	/**
+	 * Clear table before source is passed in parts with update().
+	 */
+	void reset();
+
+	/**
+	 * Build member to line table from decompiled java source that arrives in parts.
+	 * Complete lines are tokenized as they arrive, the table is built by the last call.
+	 * \param data source text received so far (previous text with new data appended)
+	 * \param size source text size
+	 * \param last no more data follows
+	 */
+	void update(const char* data, const size_t size, const bool last);
+
+	/**
+	 * Find declaration line of member.
+	 * \param member member description
+	 * \return line number (0 if not found)
+	 */
+	intptr_t find(const jclass::jmember& member) const;
+
+private:
+	//! Token type.
+	enum token_type {
+		tt_ident,	///< Identifier or keyword
+		tt_punct,	///< Punctuation (one character or "...")
+		tt_literal	///< Number, string or char literal
+	};
+
+	//! Source token.
+	struct token {
+		token_type	type;	///< Token type
+		string		text;	///< Token text (empty for literals)
+		intptr_t	line;	///< Line number
+	};
+
+	/**
+	 * Split not yet tokenized source text into tokens, comments are dropped.
+	 * Unless it is the last part, text after the last new line is left for
+	 * the next call, as well as a block comment or text block that is not closed.
+	 * \param data source text received so far
+	 * \param size source text size
+	 * \param last no more data follows
+	 */
+	void tokenize(const char* data, const size_t size, const bool last);
+
+	/**
+	 * Record member declarations of the top level type body.
+	 * \param tokens source tokens
+	 */
+	void parse(const vector<token>& tokens);
+
+	/**
+	 * Find end of bracket group.
+	 * \param tokens source tokens
+	 * \param begin opening bracket token
+	 * \return closing bracket token (or last token if group is not closed)
+	 */
+	static size_t group_end(const vector<token>& tokens, const size_t begin);
+
+	/**
+	 * Skip annotation.
+	 * \param tokens source tokens
+	 * \param begin '@' token
+	 * \return first token after annotation
+	 */
+	static size_t skip_annotation(const vector<token>& tokens, const size_t begin);
+
+	/**
+	 * Check if token can end a type name ("int", "String", "List<T>", "int[]").
+	 * \param t token to check
+	 * \return true if token can end a type name
+	 */
+	static bool is_type_end(const token& t);
+
+	/**
+	 * Build parameter types key from declaration parameter list.
+	 * \param tokens source tokens
+	 * \param begin first token after '('
+	 * \param end closing ')' token
+	 * \param arity output number of parameters
+	 * \return parameter types key ("int,String[]")
+	 */
+	static string params_key(const vector<token>& tokens, const size_t begin, const size_t end, size_t& arity);
+
+	/**
+	 * Add declaration to table (first declaration wins).
+	 * \param key member key
+	 * \param line declaration line
+	 */
+	void add(const string& key, const intptr_t line);
+
+	/**
+	 * Find line by key.
+	 * \param key member key
+	 * \return line number (0 if not found)
+	 */
+	intptr_t find(const string& key) const;
+
+private:
+	map<string, intptr_t>			_lines;			///< Member key to declaration line
+	map<string, vector<intptr_t> >	_methods;		///< Method name to all its declaration lines
+	map<unsigned long, intptr_t>	_src_lines;		///< Original source line to decompiled line (line comments)
+
+	vector<token>	_tokens;			///< Tokens of source received so far
+	size_t			_tokenized;			///< Size of tokenized source text
+	intptr_t		_tok_line;			///< Line number at the end of tokenized text
+	bool			_tok_line_start;	///< Only white spaces from the beginning of line at the end of tokenized text
+};
@@ -0,0 +1,301 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include "jsearch.h"
+#include "dir_walker.h"
+#include <string.h>
+#include <thread>
+#include <chrono>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JSEARCH_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//! Number of classes scanned at once
+#define JSEARCH_BATCH_SIZE		1024
+//! Maximum number of found members
+#define JSEARCH_MAX_MATCHES		100000
+//! Progress report interval (milliseconds)
+#define JSEARCH_PROGRESS_TIME	200
+
+
+jsearch::jsearch(const wstring& pattern)
+:	_pattern(pattern), _pool(nullptr), _workers(nullptr), _scanned(0), _parsed(0), _found(0), _cancel(false), _truncated(false)
+{
+	//Modified UTF-8 of class file differs from UTF-8 for NUL and supplementary
+	//characters, so only the longest ASCII run is used to reject classes
+	size_t best_pos = 0, best_len = 0;
+	for (size_t pos = 0; pos < pattern.length();) {
+		size_t len = 0;
+		while (pos + len < pattern.length() && pattern[pos + len] > 0 && pattern[pos + len] < 0x80)
+			++len;
+		if (len > best_len) {
+			best_pos = pos;
+			best_len = len;
+		}
+		pos += len + 1;
+	}
+	for (size_t i = best_pos; i < best_pos + best_len; ++i)
+		_needle += static_cast<char>(pattern[i]);
+}
+
+
+bool jsearch::run(const vector<native_path>& sources, const progress& fn, const size_t threads /*= 0*/)
+{
+	_matches.clear();
+	_items.clear();
+	_scanned = 0;
+	_parsed = 0;
+	_found = 0;
+	_cancel = false;
+	_truncated = false;
+
+	//Sources are walked and scanned by worker threads, progress is reported from the caller's thread
+	atomic<bool> finished(false);
+	bool rc = false;
+	thread worker([this, &sources, &finished, &rc, threads]() {
+		work_pool pool(threads);
+		vector<worker_state> workers(pool.size());
+		_pool = &pool;
+		_workers = &workers;
+		_batch.resize(JSEARCH_BATCH_SIZE);
+		for (size_t i = 0; i < sources.size() && !_cancel; ++i) {
+			if (search(sources[i]))
+				rc = true;
+		}
+		flush();
+		_pool = nullptr;
+		_workers = nullptr;
+		finished = true;
+	});
+	while (!finished) {
+		if (!fn(_scanned, _found))
+			_cancel = true;
+		this_thread::sleep_for(chrono::milliseconds(JSEARCH_PROGRESS_TIME));
+	}
+	worker.join();
+	fn(_scanned, _found);
+
+	_batch.clear();
+	return rc;
+}
+
+
+const unsigned char* jsearch::find(const unsigned char* data, const size_t size, const char* needle, const size_t needle_len)
+{
+	if (!needle_len)
+		return data;
+	if (needle_len > size)
+		return nullptr;
+
+	const unsigned char first = static_cast<unsigned char>(needle[0]);
+	const unsigned char last = static_cast<unsigned char>(needle[needle_len - 1]);
+	const size_t end = size - needle_len + 1;	//Last possible start + 1
+	size_t pos = 0;
+
+#ifdef JSEARCH_SSE2
+	//Candidates are positions where both first and last needle bytes match
+	const __m128i vfirst = _mm_set1_epi8(static_cast<char>(first));
+	const __m128i vlast = _mm_set1_epi8(static_cast<char>(last));
+	while (pos + 16 <= end) {
+		const __m128i bfirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+		const __m128i blast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + needle_len - 1));
+		unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(bfirst, vfirst), _mm_cmpeq_epi8(blast, vlast))));
+		while (mask) {
+#ifdef _MSC_VER
+			unsigned long bit;
+			_BitScanForward(&bit, mask);
+#else
+			const unsigned int bit = static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+			if (memcmp(data + pos + bit + 1, needle + 1, needle_len - 1) == 0)
+				return data + pos + bit;
+			mask &= mask - 1;
+		}
+		pos += 16;
+	}
+#endif // JSEARCH_SSE2
+
+	for (; pos < end; ++pos) {
+		if (data[pos] == first && data[pos + needle_len - 1] == last && memcmp(data + pos + 1, needle + 1, needle_len - 1) == 0)
+			return data + pos;
+	}
+	return nullptr;
+}
+
+
+bool jsearch::search(const native_path& source)
+{
+	if (dir_walker::is_dir(source)) {
+		return dir_walker::walk(source, nullptr, [this](const dir_walker::file& f) {
+			if (_cancel)
+				return;
+			if (has_ext(f.path, ".class")) {
+				item it;
+				it.file_name = f.full_path;
+				it.archive = nullptr;
+				it.entry = 0;
+				add(it);
+			}
+			else if (has_ext(f.path, ".jar") || has_ext(f.path, ".zip"))
+				search_archive(f.full_path);
+		});
+	}
+
+	mapped_file file;
+	if (!file.open(source.c_str()))
+		return false;
+	if (jzip::format_supported(file.data(), file.size())) {
+		file.close();
+		return search_archive(source);
+	}
+
+	item it;
+	it.file_name = source;
+	it.archive = nullptr;
+	it.entry = 0;
+	add(it);
+	return true;
+}
+
+
+bool jsearch::search_archive(const native_path& file_name)
+{
+	//Classes of the archive must be processed before it is closed
+	flush();
+
+	jzip archive;
+	if (!archive.open(file_name.c_str()))
+		return false;
+	_archive_name = file_name;
+
+	const vector<jzip::entry>& entries = archive.entries();
+	for (size_t i = 0; i < entries.size() && !_cancel; ++i) {
+		if (entries[i].shadowed || !has_ext(entries[i].path, ".class"))
+			continue;
+		item it;
+		it.archive = &archive;
+		it.entry = i;
+		add(it);
+	}
+	flush();
+	_archive_name.clear();
+	return true;
+}
+
+
+void jsearch::add(const item& it)
+{
+	_items.push_back(it);
+	if (_items.size() == JSEARCH_BATCH_SIZE)
+		flush();
+}
+
+
+void jsearch::flush()
+{
+	if (_items.empty())
+		return;
+
+	_pool->run(_items.size(), [this](const size_t index, const size_t worker) {
+		_batch[index].clear();
+		if (!_cancel)
+			scan(_items[index], (*_workers)[worker], _batch[index]);
+	});
+
+	//Matches are collected in source order
+	for (size_t i = 0; i < _items.size() && !_truncated; ++i) {
+		for (size_t j = 0; j < _batch[i].size(); ++j) {
+			if (_matches.size() == JSEARCH_MAX_MATCHES) {
+				_truncated = true;
+				_cancel = true;
+				break;
+			}
+			_matches.push_back(_batch[i][j]);
+		}
+		_batch[i].clear();
+	}
+	_items.clear();
+}
+
+
+void jsearch::scan(const item& it, worker_state& ws, vector<match>& found)
+{
+	const unsigned char* data;
+	size_t size;
+	if (it.archive) {
+		if (!it.archive->extract(it.entry, ws.buffer) || ws.buffer.empty())
+			return;
+		data = &ws.buffer.front();
+		size = ws.buffer.size();
+	}
+	else {
+		if (!ws.file.open(it.file_name.c_str()))
+			return;
+		data = ws.file.data();
+		size = ws.file.size();
+	}
+	++_scanned;
+
+	//Member names and descriptors are stored as is in the constant pool
+	if (find(data, size, _needle.c_str(), _needle.length())) {
+		++_parsed;
+		if (ws.parser.read(data, size, ws.info)) {
+			//Members are matched on the parser tables, only found ones are copied out
+			static const jclass::jmember_type types[] = { jclass::method, jclass::field };
+			for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t) {
+				const size_t count = (types[t] == jclass::method ? ws.parser.methods() : ws.parser.fields()).size();
+				for (size_t i = 0; i < count; ++i) {
+					if (ws.parser.member_name(types[t], i).find(_pattern) == wstring::npos &&
+						ws.parser.member_descriptor(types[t], i).find(_pattern) == wstring::npos)
+						continue;
+					match m;
+					m.source = it.archive ? _archive_name : it.file_name;
+					if (it.archive)
+						m.entry = it.archive->entries()[it.entry].path;
+					m.class_name = ws.info.name;
+					ws.parser.get_member(types[t], i, m.member);
+					found.push_back(m);
+				}
+			}
+			_found += found.size();
+		}
+	}
+
+	ws.file.close();
+}
+
+
+bool jsearch::has_ext(const string& name, const char* ext)
+{
+	const size_t ext_len = strlen(ext);
+	if (name.length() <= ext_len)
+		return false;
+	const char* tail = name.c_str() + name.length() - ext_len;
+	for (size_t i = 0; i < ext_len; ++i) {
+		const char ch = (tail[i] >= 'A' && tail[i] <= 'Z') ? static_cast<char>(tail[i] - 'A' + 'a') : tail[i];
+		if (ch != ext[i])
+			return false;
+	}
+	return true;
+}
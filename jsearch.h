@@ -0,0 +1,166 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#include "jclass.h"
+#include "jzip.h"
+#include "work_pool.h"
+#include <atomic>
+#include <functional>
+
+
+class jsearch
+{
+public:
+	//! Progress callback: number of scanned classes and matches, returns false to cancel (called from the thread that runs the search).
+	typedef function<bool(const size_t scanned, const size_t found)> progress;
+
+	//! Found member.
+	struct match {
+		native_path		source;		///< Class file or archive name
+		string			entry;		///< Archive entry path (see jzip::find, empty for class file)
+		wstring			class_name;	///< Class name
+		jclass::jmember	member;		///< Member description
+	};
+
+	/**
+	 * Constructor.
+	 * \param pattern substring of member name or descriptor ("()Ljava/util/concurrent/Future;")
+	 */
+	explicit jsearch(const wstring& pattern);
+
+	/**
+	 * Search members in class files, archives and directory trees.
+	 * Directories are walked for class files and archives. Raw data of every
+	 * class is scanned for the pattern first, only classes that contain it
+	 * are parsed. Classes are processed in batches of limited size.
+	 * \param sources class files, archives and directories
+	 * \param fn progress callback
+	 * \param threads number of worker threads (0 to use all hardware threads)
+	 * \return false if no source can be read
+	 */
+	bool run(const vector<native_path>& sources, const progress& fn, const size_t threads = 0);
+
+	/**
+	 * Get found members in source order.
+	 * \return found members
+	 */
+	const vector<match>& matches() const { return _matches; }
+
+	/**
+	 * Get number of scanned classes.
+	 * \return number of classes
+	 */
+	size_t scanned() const { return _scanned; }
+
+	/**
+	 * Get number of parsed classes (passed raw data scan).
+	 * \return number of classes
+	 */
+	size_t parsed() const { return _parsed; }
+
+	/**
+	 * Check if search was stopped by matches limit.
+	 * \return true if not all matches are returned
+	 */
+	bool truncated() const { return _truncated; }
+
+	/**
+	 * Find substring in raw data.
+	 * \param data data to scan
+	 * \param size data size
+	 * \param needle substring
+	 * \param needle_len substring length
+	 * \return pointer to the first occurrence (nullptr if not found)
+	 */
+	static const unsigned char* find(const unsigned char* data, const size_t size, const char* needle, const size_t needle_len);
+
+private:
+	//! Queued class.
+	struct item {
+		native_path		file_name;	///< Class file name (empty for archive entry)
+		const jzip*		archive;	///< Archive of entry (nullptr for class file)
+		size_t			entry;		///< Archive entry index
+	};
+
+	//! Worker private state, kept between batches.
+	struct worker_state {
+		vector<unsigned char>	buffer;		///< Scratch buffer for inflated data
+		mapped_file				file;		///< Scratch mapping for class files
+		jclass					parser;		///< Class parser
+		jclass::jclassinfo		info;		///< Class description
+	};
+
+	/**
+	 * Search in one source (worker thread of run).
+	 * \param source class file, archive or directory
+	 * \return false if source can not be read
+	 */
+	bool search(const native_path& source);
+
+	/**
+	 * Search in archive classes.
+	 * \param file_name archive file name
+	 * \return false if archive can not be opened
+	 */
+	bool search_archive(const native_path& file_name);
+
+	/**
+	 * Queue class, full batch is processed.
+	 * \param it class item
+	 */
+	void add(const item& it);
+
+	/**
+	 * Process queued classes in parallel and collect their matches.
+	 */
+	void flush();
+
+	/**
+	 * Scan and parse one class (worker thread).
+	 * \param it class item
+	 * \param ws worker state
+	 * \param found output matches
+	 */
+	void scan(const item& it, worker_state& ws, vector<match>& found);
+
+	/**
+	 * Check file name extension (case insensitive).
+	 * \param name file name
+	 * \param ext extension with dot (lower case)
+	 * \return true if file name has the extension
+	 */
+	static bool has_ext(const string& name, const char* ext);
+
+private:
+	wstring				_pattern;		///< Searched substring
+	string				_needle;		///< Raw data prefilter (longest ASCII part of pattern)
+	vector<item>		_items;			///< Queued classes
+	vector<vector<match> >	_batch;		///< Matches of queued classes
+	work_pool*			_pool;			///< Worker threads (while running)
+	vector<worker_state>*	_workers;	///< Worker states (while running)
+	native_path			_archive_name;	///< Name of archive being searched
+	vector<match>		_matches;		///< Found members
+	atomic<size_t>		_scanned;		///< Number of scanned classes
+	atomic<size_t>		_parsed;		///< Number of parsed classes
+	atomic<size_t>		_found;			///< Number of found members
+	atomic<bool>		_cancel;		///< Cancel request flag
+	bool				_truncated;		///< Matches limit reached
+};
@@ -48,6 +48,31 @@
 #define BTYPE_REF		'['		//'reference': one array dimension
 #define BTYPE_VOID		'V'		//'void'
 
+//! Access names in output order
+static const struct {
+	uint16_t flag;
+	const wchar_t* name;
+} access_names[] = {
+	{ ACC_PUBLIC,		L"public" },
+	{ ACC_PRIVATE,		L"private" },
+	{ ACC_PROTECTED,	L"protected" },
+	{ ACC_STATIC,		L"static" },
+	{ ACC_FINAL,		L"final" },
+	{ ACC_VOLATILE,		L"volatile" },
+	{ ACC_SUPER,		L"super" },
+	{ ACC_TRANSIENT,	L"transient" },
+	{ ACC_INTERFACE,	L"interface" },
+	{ ACC_ABSTRACT,		L"abstract" },
+	{ ACC_SYNTHETIC,	L"synthetic" },
+	{ ACC_ANNOTATION,	L"annotation" },
+	{ ACC_ENUM,			L"enum" }
+};
+
+//! Parsed descriptions limit of one generation (current one becomes previous when it is reached)
+#define JTFORMAT_MAX_DESCRS	0x8000
+
+thread_local jtformat::jdescr_cache jtformat::_descrs;
+
 
 jtformat::jtformat()
 :	_short_type(true),
@@ -59,24 +84,42 @@ jtformat::jtformat()
 
 wstring jtformat::format(const jclass::jmember& info) const
 {
-	wstring rv, args;
-	parse_description(info.description, rv, args);
+	wstring val(format(info, nullptr) + 1, 0);
+	val.resize(format(info, &val[0]));
+	return val;
+}
+
+
+size_t jtformat::format(const jclass::jmember& info, wchar_t* buf) const
+{
+	size_t len = 0;
+	const auto put = [buf, &len](const wchar_t* text, const size_t text_len) {
+		if (buf)
+			wmemcpy(buf + len, text, text_len);
+		len += text_len;
+	};
 
-	wstring val;
 	if (_access) {
-		const wstring acc_name = access_name(info.access);
-		if (!acc_name.empty()) {
-			val = acc_name;
-			val += L' ';
+		for (size_t i = 0; i < sizeof(access_names) / sizeof(access_names[0]); ++i) {
+			if (info.access & access_names[i].flag) {
+				put(access_names[i].name, wcslen(access_names[i].name));
+				put(L" ", 1);
+			}
 		}
 	}
-	val += rv;
-	val += L' ';
-	val += info.name;
-	if (info.type != jclass::field)
-		val += args;
 
-	return val;
+	const jdescr* descr = info.description.empty() ? nullptr : &describe(info.description);
+	const size_t idx = view();
+	if (descr)
+		put(descr->ret_names[idx].c_str(), descr->ret_names[idx].length());
+	put(L" ", 1);
+	put(info.name.c_str(), info.name.length());
+	if (descr && info.type != jclass::field)
+		put(descr->arg_names[idx].c_str(), descr->arg_names[idx].length());
+
+	if (buf)
+		buf[len] = 0;
+	return len;
 }
 
 
@@ -88,6 +131,14 @@ wstring jtformat::get_type_name(const jclass::jmember& info) const
 }
 
 
+wstring jtformat::get_args(const jclass::jmember& info) const
+{
+	wstring rv, args;
+	parse_description(info.description, rv, args);
+	return args;
+}
+
+
 bool jtformat::is_public(const jclass::jmember& info)
 {
 	return (info.access & ACC_PUBLIC) != 0;
@@ -102,66 +153,35 @@ void jtformat::as_java_object(wstring& val)
 }
 
 
-wstring jtformat::access_name(const uint16_t val) const
+const wchar_t* jtformat::parse_type(const wchar_t* token, jtype& type)
 {
-	wstring acc;
-	if (val & ACC_PUBLIC)		acc += L"public ";
-	if (val & ACC_PRIVATE)		acc += L"private ";
-	if (val & ACC_PROTECTED)	acc += L"protected ";
-	if (val & ACC_STATIC)		acc += L"static ";
-	if (val & ACC_FINAL)		acc += L"final ";
-	if (val & ACC_VOLATILE)		acc += L"volatile ";
-	if (val & ACC_SUPER)		acc += L"super ";
-	if (val & ACC_TRANSIENT)	acc += L"transient ";
-	if (val & ACC_INTERFACE)	acc += L"interface ";
-	if (val & ACC_ABSTRACT)		acc += L"abstract ";
-	if (val & ACC_SYNTHETIC)	acc += L"synthetic ";
-	if (val & ACC_ANNOTATION)	acc += L"annotation ";
-	if (val & ACC_ENUM)			acc += L"enum ";
-	if (!acc.empty())
-		acc.erase(acc.length() - 1);
-	return acc;
-}
-
+	assert(token);
 
-const wchar_t* jtformat::type_name(const wchar_t* token, wstring& name) const
-{
-	assert(token && *token);
-
-	switch (*token) {
-		case BTYPE_BYTE:	name = L"byte";    return ++token;
-		case BTYPE_CHAR:	name = L"char";	   return ++token;
-		case BTYPE_DBL:		name = L"double";  return ++token;
-		case BTYPE_FLOAT:	name = L"float";   return ++token;
-		case BTYPE_INT:		name = L"int";	   return ++token;
-		case BTYPE_LONG:	name = L"long";	   return ++token;
-		case BTYPE_SHORT:	name = L"short";   return ++token;
-		case BTYPE_BOOL:	name = L"boolean"; return ++token;
-		case BTYPE_VOID:	name = L"void";	   return ++token;
+	type.dims = 0;
+	while (*token == BTYPE_REF) {
+		++type.dims;
+		++token;
 	}
 
-	if (*token == BTYPE_REF) {
-		char arr_num = 1;
-		while (*(++token) == BTYPE_REF)
-			++arr_num;
-		token = type_name(token, name);
-		for (char i = 0; i < arr_num; ++i)
-			name += L"[]";
-		return token;
+	type.base = *token;
+	switch (*token) {
+		case BTYPE_BYTE:
+		case BTYPE_CHAR:
+		case BTYPE_DBL:
+		case BTYPE_FLOAT:
+		case BTYPE_INT:
+		case BTYPE_LONG:
+		case BTYPE_SHORT:
+		case BTYPE_BOOL:
+		case BTYPE_VOID:
+			return ++token;
 	}
 
 	if (*token == BTYPE_OBJ) {
 		const wchar_t* token_end = wcschr(token, L';');
 		if (!token_end)
 			throw exception();
-		name.assign(++token, token_end);
-		if (_jo_view)
-			as_java_object(name);
-		if (_short_type) {
-			const size_t ldp = name.rfind(_jo_view ? L'.' : L'/');
-			if (ldp != string::npos)
-				name.erase(0, ldp + 1);
-		}
+		type.object.assign(++token, token_end);
 		return ++token_end;
 	}
 
@@ -169,28 +189,110 @@ const wchar_t* jtformat::type_name(const wchar_t* token, wstring& name) const
 }
 
 
-void jtformat::parse_description(const wstring& descr, wstring& ret_val, wstring& args) const
+wstring jtformat::type_name(const jtype& type) const
 {
-	if (descr.empty())
-		return;
+	wstring name;
+	switch (type.base) {
+		case BTYPE_BYTE:	name = L"byte";    break;
+		case BTYPE_CHAR:	name = L"char";	   break;
+		case BTYPE_DBL:		name = L"double";  break;
+		case BTYPE_FLOAT:	name = L"float";   break;
+		case BTYPE_INT:		name = L"int";	   break;
+		case BTYPE_LONG:	name = L"long";	   break;
+		case BTYPE_SHORT:	name = L"short";   break;
+		case BTYPE_BOOL:	name = L"boolean"; break;
+		case BTYPE_VOID:	name = L"void";	   break;
+		case BTYPE_OBJ:
+			name = type.object;
+			if (_jo_view)
+				as_java_object(name);
+			if (_short_type) {
+				const size_t ldp = name.rfind(_jo_view ? L'.' : L'/');
+				if (ldp != string::npos)
+					name.erase(0, ldp + 1);
+			}
+			break;
+	}
 
-	const wchar_t* token = descr.c_str();
+	for (size_t i = 0; i < type.dims; ++i)
+		name += L"[]";
+	return name;
+}
 
-	if (*token == L'(') {
-		//Parse arguments
-		++token;
-		args = L'(';
-		while (*token && *token != L')') {
-			wstring t_name;
-			token = type_name(token, t_name);
-			if (args.size() != 1)
-				args += L", ";
-			args += t_name;
+
+const jtformat::jdescr& jtformat::describe(const wstring& descr) const
+{
+	assert(!descr.empty());
+
+	unordered_map<wstring, jdescr>& current = _descrs.current;
+	unordered_map<wstring, jdescr>& previous = _descrs.previous;
+	unordered_map<wstring, jdescr>::iterator it = current.find(descr);
+	bool found = (it != current.end());
+	if (!found) {
+		if (current.size() >= JTFORMAT_MAX_DESCRS) {
+			previous.swap(current);
+			current.clear();
+		}
+		//Description used in the previous generation is moved to the current one
+		unordered_map<wstring, jdescr>::iterator prev_it = previous.find(descr);
+		if (prev_it != previous.end()) {
+			it = current.insert(make_pair(descr, move(prev_it->second))).first;
+			previous.erase(prev_it);
+			found = true;
 		}
-		args += L')';
-		++token;
 	}
+	if (!found) {
+		jdescr parsed;
+		const wchar_t* token = descr.c_str();
+		parsed.method = (*token == L'(');
+		if (parsed.method) {
+			//Parse arguments
+			++token;
+			while (*token && *token != L')') {
+				jtype arg;
+				token = parse_type(token, arg);
+				parsed.args.push_back(arg);
+			}
+			if (*token != L')')
+				throw exception();
+			++token;
+		}
+		//Parse return value
+		parse_type(token, parsed.ret_val);
+		for (size_t i = 0; i < sizeof(parsed.rendered) / sizeof(parsed.rendered[0]); ++i)
+			parsed.rendered[i] = false;
+
+		it = current.insert(make_pair(descr, move(parsed))).first;
+	}
+
+	//Rendered forms depend on view flags only
+	jdescr& parsed = it->second;
+	const size_t idx = view();
+	if (!parsed.rendered[idx]) {
+		parsed.ret_names[idx] = type_name(parsed.ret_val);
+		if (parsed.method) {
+			wstring& names = parsed.arg_names[idx];
+			names = L'(';
+			for (size_t i = 0; i < parsed.args.size(); ++i) {
+				if (i)
+					names += L", ";
+				names += type_name(parsed.args[i]);
+			}
+			names += L')';
+		}
+		parsed.rendered[idx] = true;
+	}
+
+	return parsed;
+}
+
+
+void jtformat::parse_description(const wstring& descr, wstring& ret_val, wstring& args) const
+{
+	if (descr.empty())
+		return;
 
-	//Parse return value
-	type_name(token, ret_val);
+	const jdescr& parsed = describe(descr);
+	ret_val = parsed.ret_names[view()];
+	args = parsed.arg_names[view()];
 }
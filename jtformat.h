@@ -20,6 +20,7 @@
 #pragma once
 
 #include "jclass.h"
+#include <unordered_map>
 
 
 class jtformat
@@ -52,6 +53,14 @@ public:
 	 */
 	wstring format(const jclass::jmember& info) const;
 
+	/**
+	 * Format member info as text into buffer
+	 * \param info member info structure description
+	 * \param buf output buffer (nullptr to get text length only)
+	 * \return text length (without last null)
+	 */
+	size_t format(const jclass::jmember& info, wchar_t* buf) const;
+
 	/**
 	 * Get type name of member
 	 * \param info member
@@ -59,6 +68,13 @@ public:
 	 */
 	wstring get_type_name(const jclass::jmember& info) const;
 
+	/**
+	 * Get arguments of method
+	 * \param info member
+	 * \return arguments list ("(int, String)", empty for fields)
+	 */
+	wstring get_args(const jclass::jmember& info) const;
+
 	/**
 	 * Check for member access type
 	 * \param info member info structure description
@@ -73,20 +89,57 @@ public:
 	static void as_java_object(wstring& val);
 
 private:
-	/**
-	 * Get access name for specified type
-	 * \param val access type
-	 * \return access name
-	 */
-	wstring access_name(const uint16_t val) const;
+	//! Parsed type of description
+	struct jtype {
+		wchar_t base;		///< Base type (primitive or object)
+		wstring object;		///< Object class name as in description
+		size_t dims;		///< Array dimensions
+	};
+
+	//! Parsed member description with rendered forms
+	struct jdescr {
+		vector<jtype> args;		///< Method arguments
+		jtype ret_val;			///< Return value (for methods) or type (for fields)
+		bool method;			///< Method description flag
+		bool rendered[4];		///< Rendered form is ready (index by view flags)
+		wstring ret_names[4];	///< Rendered return value
+		wstring arg_names[4];	///< Rendered arguments
+	};
+
+	//! Parsed descriptions of one thread, recently used ones survive the size limit
+	struct jdescr_cache {
+		unordered_map<wstring, jdescr> current;	///< Descriptions used since the last generation switch
+		unordered_map<wstring, jdescr> previous;	///< Descriptions of the previous generation
+	};
 
 	/**
-	 * Parse member description
+	 * Parse type of member description
 	 * \param token token (start description)
-	 * \param name type name
+	 * \param type parsed type
 	 * \return end token
 	 */
-	const wchar_t* type_name(const wchar_t* token, wstring& name) const;
+	static const wchar_t* parse_type(const wchar_t* token, jtype& type);
+
+	/**
+	 * Get type name in current view
+	 * \param type parsed type
+	 * \return type name
+	 */
+	wstring type_name(const jtype& type) const;
+
+	/**
+	 * Get parsed member description rendered in current view, every
+	 * distinct description is parsed and rendered in each view once per thread
+	 * \param descr member description
+	 * \return parsed description
+	 */
+	const jdescr& describe(const wstring& descr) const;
+
+	/**
+	 * Get view index of rendered forms
+	 * \return view index
+	 */
+	size_t view() const					{ return (_short_type ? 1 : 0) | (_jo_view ? 2 : 0); }
 
 	/**
 	 * Parse member description
@@ -100,4 +153,6 @@ private:
 	bool _short_type;
 	bool _jo_view;
 	bool _access;
+
+	static thread_local jdescr_cache _descrs;	///< Parsed descriptions (per thread, no locking)
 };
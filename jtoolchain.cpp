@@ -0,0 +1,249 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include "jtoolchain.h"
+#include "mapped_file.h"
+#include "settings.h"
+#include <algorithm>
+#include <string.h>
+
+vector<jtoolchain::runtime> jtoolchain::_runtimes;
+bool jtoolchain::_loaded = false;
+bool jtoolchain::_discovered = false;
+
+
+bool jtoolchain::java_bin(wstring& bin_path)
+{
+	return find_bin(L"java.exe", bin_path);
+}
+
+
+bool jtoolchain::jdk_bin(wstring& bin_path)
+{
+	return find_bin(L"javap.exe", bin_path);
+}
+
+
+const vector<jtoolchain::runtime>& jtoolchain::runtimes()
+{
+	load();
+	if (_runtimes.empty() && !_discovered)
+		discover();
+	return _runtimes;
+}
+
+
+bool jtoolchain::find_bin(const wchar_t* tool, wstring& bin_path)
+{
+	assert(tool && *tool);
+
+	load();
+	for (int pass = 0; pass < 2; ++pass) {
+		if (!settings::java_home.empty() && has_tool(settings::java_home, tool)) {
+			bin_path = settings::java_home + L"\\bin\\";
+			return true;
+		}
+		for (size_t i = 0; i < _runtimes.size(); ++i) {
+			if (has_tool(_runtimes[i].home, tool)) {
+				bin_path = _runtimes[i].home + L"\\bin\\";
+				return true;
+			}
+		}
+		//Runtime was installed or removed since the last discovery
+		if (_discovered)
+			break;
+		discover();
+	}
+
+	return false;
+}
+
+
+bool jtoolchain::has_tool(const wstring& home, const wchar_t* tool)
+{
+	const wstring path = home + L"\\bin\\" + tool;
+	const DWORD attr = GetFileAttributes(path.c_str());
+	return attr != INVALID_FILE_ATTRIBUTES && !(attr & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+
+void jtoolchain::discover()
+{
+	_discovered = true;
+	_runtimes.clear();
+
+	//Java 9+ registers under "JDK" and "JRE" keys, older versions under long names
+	const wchar_t* keys[] = {
+		L"SOFTWARE\\JavaSoft\\JDK",
+		L"SOFTWARE\\JavaSoft\\Java Development Kit",
+		L"SOFTWARE\\JavaSoft\\JRE",
+		L"SOFTWARE\\JavaSoft\\Java Runtime Environment"
+	};
+	for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+		add_registry(keys[i], KEY_WOW64_64KEY);
+		add_registry(keys[i], KEY_WOW64_32KEY);
+	}
+
+	wstring java_home(1024, 0);
+	java_home.resize(GetEnvironmentVariable(L"JAVA_HOME", &java_home[0], static_cast<DWORD>(java_home.size())));
+	if (!java_home.empty())
+		add(java_home, wstring());
+
+	//Runtime from PATH is usable only if it has a home layout (not a launcher stub)
+	wchar_t exe_path[MAX_PATH];
+	if (SearchPath(nullptr, L"java.exe", nullptr, MAX_PATH, exe_path, nullptr)) {
+		wstring home = exe_path;
+		home.resize(home.rfind(L'\\'));
+		const size_t bin_pos = home.rfind(L'\\');
+		if (bin_pos != wstring::npos && _wcsicmp(home.c_str() + bin_pos + 1, L"bin") == 0) {
+			home.erase(bin_pos);
+			add(home, wstring());
+		}
+	}
+
+	stable_sort(_runtimes.begin(), _runtimes.end(), [](const runtime& a, const runtime& b) { return newer(a.version, b.version); });
+
+	settings::java_runtimes.clear();
+	for (size_t i = 0; i < _runtimes.size(); ++i) {
+		settings::java_runtimes += _runtimes[i].version + L'\t' + _runtimes[i].home;
+		settings::java_runtimes += L'\n';
+	}
+	settings::save();
+}
+
+
+void jtoolchain::add_registry(const wchar_t* key_path, const REGSAM view)
+{
+	assert(key_path && key_path[0]);
+
+	HKEY reg_key;
+	if (RegOpenKeyEx(HKEY_LOCAL_MACHINE, key_path, 0, KEY_READ | view, &reg_key) != ERROR_SUCCESS)
+		return;
+
+	wchar_t version[256];
+	DWORD version_len = sizeof(version) / sizeof(version[0]);
+	for (DWORD idx = 0; RegEnumKeyEx(reg_key, idx, version, &version_len, nullptr, nullptr, nullptr, nullptr) == ERROR_SUCCESS; ++idx) {
+		version_len = sizeof(version) / sizeof(version[0]);
+		HKEY ver_key;
+		if (RegOpenKeyEx(reg_key, version, 0, KEY_READ | view, &ver_key) != ERROR_SUCCESS)
+			continue;
+		const wchar_t* path_key = L"JavaHome";
+		DWORD data_len = 0;
+		if (RegQueryValueEx(ver_key, path_key, nullptr, nullptr, nullptr, &data_len) == ERROR_SUCCESS && data_len) {
+			wstring home(data_len / sizeof(wchar_t), 0);
+			if (RegQueryValueEx(ver_key, path_key, nullptr, nullptr, reinterpret_cast<LPBYTE>(&home[0]), &data_len) == ERROR_SUCCESS) {
+				home.resize(wcslen(home.c_str()));	//Remove last null
+				add(home, version);
+			}
+		}
+		RegCloseKey(ver_key);
+	}
+
+	RegCloseKey(reg_key);
+}
+
+
+void jtoolchain::add(wstring home, const wstring& version)
+{
+	while (!home.empty() && (home.back() == L'\\' || home.back() == L'/'))
+		home.erase(home.length() - 1);
+	if (home.empty() || !has_tool(home, L"java.exe"))
+		return;
+
+	for (size_t i = 0; i < _runtimes.size(); ++i) {
+		if (_wcsicmp(_runtimes[i].home.c_str(), home.c_str()) == 0)
+			return;
+	}
+
+	runtime rt;
+	rt.home = home;
+	rt.version = read_version(home);
+	if (rt.version.empty())
+		rt.version = version;
+	_runtimes.push_back(rt);
+}
+
+
+wstring jtoolchain::read_version(const wstring& home)
+{
+	mapped_file release;
+	const wstring release_file = home + L"\\release";
+	if (!release.open(release_file.c_str()) || !release.size())
+		return wstring();
+
+	//JAVA_VERSION="11.0.2"
+	const string content(reinterpret_cast<const char*>(release.data()), release.size());
+	const char* tag = "JAVA_VERSION=\"";
+	const size_t start = content.find(tag);
+	if (start == string::npos)
+		return wstring();
+	const size_t begin = start + strlen(tag);
+	const size_t end = content.find('"', begin);
+	if (end == string::npos)
+		return wstring();
+	return wstring(content.begin() + begin, content.begin() + end);
+}
+
+
+bool jtoolchain::newer(const wstring& a, const wstring& b)
+{
+	//Version numbers are compared component by component, "1.x" means major version x
+	const wchar_t* pa = a.c_str();
+	const wchar_t* pb = b.c_str();
+	if (wcsncmp(pa, L"1.", 2) == 0)
+		pa += 2;
+	if (wcsncmp(pb, L"1.", 2) == 0)
+		pb += 2;
+	while (*pa || *pb) {
+		wchar_t* ea;
+		wchar_t* eb;
+		const unsigned long va = wcstoul(pa, &ea, 10);
+		const unsigned long vb = wcstoul(pb, &eb, 10);
+		if (va != vb)
+			return va > vb;
+		pa = *ea ? ea + 1 : ea;
+		pb = *eb ? eb + 1 : eb;
+	}
+	return false;
+}
+
+
+void jtoolchain::load()
+{
+	if (_loaded)
+		return;
+	_loaded = true;
+
+	//One runtime per line: version and home separated by tab
+	const wstring& list = settings::java_runtimes;
+	size_t pos = 0;
+	while (pos < list.length()) {
+		size_t eol = list.find(L'\n', pos);
+		if (eol == wstring::npos)
+			eol = list.length();
+		const size_t tab = list.find(L'\t', pos);
+		if (tab != wstring::npos && tab < eol) {
+			runtime rt;
+			rt.version = list.substr(pos, tab - pos);
+			rt.home = list.substr(tab + 1, eol - tab - 1);
+			_runtimes.push_back(rt);
+		}
+		pos = eol + 1;
+	}
+}
@@ -0,0 +1,118 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#include "common.h"
+#include <vector>
+
+
+class jtoolchain
+{
+public:
+	//! Installed Java runtime.
+	struct runtime {
+		wstring home;		///< Java home directory
+		wstring version;	///< Java version
+	};
+
+	/**
+	 * Get bin directory of Java runtime for decompilers.
+	 * Installed runtimes are discovered once and kept in settings,
+	 * later lookups check the executable file only.
+	 * \param bin_path bin directory path (with trailing slash)
+	 * \return false if Java runtime not found
+	 */
+	static bool java_bin(wstring& bin_path);
+
+	/**
+	 * Get bin directory of JDK (javap is required).
+	 * \param bin_path bin directory path (with trailing slash)
+	 * \return false if JDK not found
+	 */
+	static bool jdk_bin(wstring& bin_path);
+
+	/**
+	 * Get installed Java runtimes (newest first).
+	 * \return runtimes list
+	 */
+	static const vector<runtime>& runtimes();
+
+private:
+	/**
+	 * Find runtime with specified tool, preferred runtime from settings is checked first.
+	 * Runtimes are discovered again once per session if no one fits.
+	 * \param tool executable file name in bin directory
+	 * \param bin_path bin directory path (with trailing slash)
+	 * \return false if not found
+	 */
+	static bool find_bin(const wchar_t* tool, wstring& bin_path);
+
+	/**
+	 * Check for tool in runtime bin directory (file check, no process is started).
+	 * \param home Java home directory
+	 * \param tool executable file name in bin directory
+	 * \return false if tool not found
+	 */
+	static bool has_tool(const wstring& home, const wchar_t* tool);
+
+	/**
+	 * Discover installed runtimes (registry, JAVA_HOME and PATH) and save them to settings.
+	 */
+	static void discover();
+
+	/**
+	 * Add runtimes registered in registry.
+	 * \param key_path registry key path with version subkeys
+	 * \param view registry view (32 or 64 bit)
+	 */
+	static void add_registry(const wchar_t* key_path, const REGSAM view);
+
+	/**
+	 * Add runtime to list (duplicates and invalid homes are skipped).
+	 * \param home Java home directory
+	 * \param version version from registry (release file takes precedence)
+	 */
+	static void add(wstring home, const wstring& version);
+
+	/**
+	 * Read version from "release" file of Java home.
+	 * \param home Java home directory
+	 * \return version (empty if unknown)
+	 */
+	static wstring read_version(const wstring& home);
+
+	/**
+	 * Compare versions ("1.8.0_201" is older than "11.0.2").
+	 * \param a first version
+	 * \param b second version
+	 * \return true if a is newer than b
+	 */
+	static bool newer(const wstring& a, const wstring& b);
+
+	/**
+	 * Load runtimes list from settings.
+	 */
+	static void load();
+
+private:
+	static vector<runtime> _runtimes;	///< Installed runtimes
+	static bool _loaded;				///< Runtimes list was loaded from settings
+	static bool _discovered;			///< Runtimes were discovered in this session
+};
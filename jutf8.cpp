@@ -0,0 +1,205 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include "jutf8.h"
+#include <wchar.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JUTF8_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JUTF8_SSE2
+#endif
+
+//! Replacement character for invalid sequences
+#define REPLACEMENT_CHAR 0xfffd
+
+
+void jutf8::decode(const unsigned char* data, const size_t len, wstring& out)
+{
+	if (!data || !len) {
+		out.clear();
+		return;
+	}
+
+	//Each source byte produces at most one output unit
+	out.resize(len);
+	wchar_t* const dst_begin = &out[0];
+	wchar_t* dst = dst_begin;
+
+	size_t pos = 0;
+	while (pos < len) {
+		//Vectorized conversion for ASCII runs (nearly all class and member names)
+		if (data[pos] < 0x80) {
+			const size_t cnt = decode_ascii(data + pos, len - pos, dst);
+			pos += cnt;
+			dst += cnt;
+			while (pos < len && data[pos] < 0x80)
+				*dst++ = static_cast<wchar_t>(data[pos++]);
+			continue;
+		}
+
+		const unsigned char c = data[pos];
+		if ((c & 0xe0) == 0xc0) {
+			//Two bytes sequence (including modified UTF-8 NUL: 0xc0 0x80)
+			if (pos + 1 < len && (data[pos + 1] & 0xc0) == 0x80) {
+				put(((c & 0x1f) << 6) | (data[pos + 1] & 0x3f), dst);
+				pos += 2;
+				continue;
+			}
+		}
+		else if ((c & 0xf0) == 0xe0) {
+			//Three bytes sequence, surrogates are encoded separately in modified UTF-8
+			if (pos + 2 < len && (data[pos + 1] & 0xc0) == 0x80 && (data[pos + 2] & 0xc0) == 0x80) {
+				const unsigned int cp = ((c & 0x0f) << 12) | ((data[pos + 1] & 0x3f) << 6) | (data[pos + 2] & 0x3f);
+				pos += 3;
+				if (cp >= 0xd800 && cp <= 0xdbff && pos + 2 < len &&
+					data[pos] == 0xed && (data[pos + 1] & 0xf0) == 0xb0 && (data[pos + 2] & 0xc0) == 0x80) {
+					//Surrogate pair
+					const unsigned int low = ((data[pos + 1] & 0x3f) << 6) | (data[pos + 2] & 0x3f) | 0xd000;
+					put(0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00), dst);
+					pos += 3;
+				}
+				else
+					put(cp, dst);
+				continue;
+			}
+		}
+		else if ((c & 0xf8) == 0xf0) {
+			//Four bytes sequence is not valid in modified UTF-8, but accept standard encoding
+			if (pos + 3 < len && (data[pos + 1] & 0xc0) == 0x80 && (data[pos + 2] & 0xc0) == 0x80 && (data[pos + 3] & 0xc0) == 0x80) {
+				const unsigned int cp = ((c & 0x07) << 18) | ((data[pos + 1] & 0x3f) << 12) | ((data[pos + 2] & 0x3f) << 6) | (data[pos + 3] & 0x3f);
+				put(cp <= 0x10ffff ? cp : REPLACEMENT_CHAR, dst);
+				pos += 4;
+				continue;
+			}
+		}
+
+		//Invalid byte
+		*dst++ = static_cast<wchar_t>(REPLACEMENT_CHAR);
+		++pos;
+	}
+
+	out.resize(static_cast<size_t>(dst - dst_begin));
+}
+
+
+void jutf8::encode(const wstring& val, string& out)
+{
+	out.clear();
+	out.reserve(val.length());
+
+	for (size_t i = 0; i < val.length(); ++i) {
+		unsigned int cp = static_cast<unsigned int>(val[i]);
+		if (cp && cp < 0x80) {
+			out += static_cast<char>(cp);
+			continue;
+		}
+		if (cp < 0x800) {
+			//Including NUL as 0xc0 0x80
+			out += static_cast<char>(0xc0 | (cp >> 6));
+			out += static_cast<char>(0x80 | (cp & 0x3f));
+			continue;
+		}
+		if (cp >= 0x10000) {
+			//Supplementary character: encode each surrogate separately
+			const unsigned int high = 0xd800 + ((cp - 0x10000) >> 10);
+			out += static_cast<char>(0xe0 | (high >> 12));
+			out += static_cast<char>(0x80 | ((high >> 6) & 0x3f));
+			out += static_cast<char>(0x80 | (high & 0x3f));
+			cp = 0xdc00 + ((cp - 0x10000) & 0x3ff);
+		}
+		out += static_cast<char>(0xe0 | (cp >> 12));
+		out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+		out += static_cast<char>(0x80 | (cp & 0x3f));
+	}
+}
+
+
+size_t jutf8::decode_ascii(const unsigned char* src, const size_t len, wchar_t* dst)
+{
+	size_t pos = 0;
+
+#ifdef JUTF8_AVX2
+	const __m256i zero256 = _mm256_setzero_si256();
+	while (pos + 32 <= len) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + pos));
+		if (_mm256_movemask_epi8(chunk))
+			break;
+		//Unpack works within 128-bit lanes, fix the lane order first
+		const __m256i ordered = _mm256_permute4x64_epi64(chunk, 0xd8);
+		const __m256i lo = _mm256_unpacklo_epi8(ordered, zero256);
+		const __m256i hi = _mm256_unpackhi_epi8(ordered, zero256);
+#if WCHAR_MAX <= 0xffff
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + pos), lo);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + pos + 16), hi);
+#else
+		const __m256i lo_ordered = _mm256_permute4x64_epi64(lo, 0xd8);
+		const __m256i hi_ordered = _mm256_permute4x64_epi64(hi, 0xd8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + pos), _mm256_unpacklo_epi16(lo_ordered, zero256));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + pos + 8), _mm256_unpackhi_epi16(lo_ordered, zero256));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + pos + 16), _mm256_unpacklo_epi16(hi_ordered, zero256));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + pos + 24), _mm256_unpackhi_epi16(hi_ordered, zero256));
+#endif
+		pos += 32;
+	}
+#endif // JUTF8_AVX2
+
+#ifdef JUTF8_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	while (pos + 16 <= len) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + pos));
+		if (_mm_movemask_epi8(chunk))
+			break;
+		const __m128i lo = _mm_unpacklo_epi8(chunk, zero);
+		const __m128i hi = _mm_unpackhi_epi8(chunk, zero);
+#if WCHAR_MAX <= 0xffff
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos), lo);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos + 8), hi);
+#else
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos), _mm_unpacklo_epi16(lo, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos + 4), _mm_unpackhi_epi16(lo, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos + 8), _mm_unpacklo_epi16(hi, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos + 12), _mm_unpackhi_epi16(hi, zero));
+#endif
+		pos += 16;
+	}
+#else
+	(void)src;
+	(void)len;
+	(void)dst;
+#endif // JUTF8_SSE2
+
+	return pos;
+}
+
+
+void jutf8::put(const unsigned int cp, wchar_t*& dst)
+{
+#if WCHAR_MAX <= 0xffff
+	if (cp >= 0x10000) {
+		*dst++ = static_cast<wchar_t>(0xd800 + ((cp - 0x10000) >> 10));
+		*dst++ = static_cast<wchar_t>(0xdc00 + ((cp - 0x10000) & 0x3ff));
+		return;
+	}
+#endif
+	*dst++ = static_cast<wchar_t>(cp);
+}
@@ -0,0 +1,64 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+using namespace std;
+
+
+class jutf8
+{
+public:
+	/**
+	 * Decode Java modified UTF-8 string (CONSTANT_Utf8 data).
+	 * Output is UTF-16 if wchar_t is 16 bit wide and UTF-32 otherwise.
+	 * Invalid sequences are replaced with U+FFFD.
+	 * \param data source data
+	 * \param len source data length in bytes
+	 * \param out decoded string
+	 */
+	static void decode(const unsigned char* data, const size_t len, wstring& out);
+
+	/**
+	 * Encode string as Java modified UTF-8 (inverse of decode).
+	 * \param val source string
+	 * \param out encoded string
+	 */
+	static void encode(const wstring& val, string& out);
+
+private:
+	/**
+	 * Widen leading ASCII bytes (SIMD fast path).
+	 * \param src source data
+	 * \param len source data length in bytes
+	 * \param dst destination buffer
+	 * \return number of converted bytes (multiple of the vector width)
+	 */
+	static size_t decode_ascii(const unsigned char* src, const size_t len, wchar_t* dst);
+
+	/**
+	 * Store code point into output buffer.
+	 * \param cp code point
+	 * \param dst destination buffer pointer
+	 */
+	static void put(const unsigned int cp, wchar_t*& dst);
+};
@@ -0,0 +1,719 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include "jzip.h"
+#include <string.h>
+#include <stdlib.h>
+
+//Zip signatures
+#define ZIP_LOCAL_HDR_SIG		0x04034b50
+#define ZIP_CENTRAL_HDR_SIG		0x02014b50
+#define ZIP_EOCD_SIG			0x06054b50
+#define ZIP64_EOCD_SIG			0x06064b50
+#define ZIP64_LOCATOR_SIG		0x07064b50
+
+//Structure sizes
+#define ZIP_LOCAL_HDR_SIZE		30
+#define ZIP_CENTRAL_HDR_SIZE	46
+#define ZIP_EOCD_SIZE			22
+#define ZIP64_EOCD_SIZE			56
+#define ZIP64_LOCATOR_SIZE		20
+
+//Compression methods
+#define ZIP_METHOD_STORED		0
+#define ZIP_METHOD_DEFLATED		8
+
+//Deflate can't compress better than 1032:1
+#define ZIP_MAX_DEFLATE_RATIO	1032
+
+//Zip64 extended information extra field
+#define ZIP64_EXTRA_ID			0x0001
+
+//Multi-release jar entries prefix
+static const char* MR_PREFIX = "META-INF/versions/";
+
+
+//! Little endian readers (zip data is always LE)
+static inline uint16_t get_u16(const unsigned char* p)	{ return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+static inline uint32_t get_u32(const unsigned char* p)	{ return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+static inline uint64_t get_u64(const unsigned char* p)	{ return static_cast<uint64_t>(get_u32(p)) | (static_cast<uint64_t>(get_u32(p + 4)) << 32); }
+
+
+bool jzip::format_supported(const unsigned char* file_hdr, const size_t file_hdr_len)
+{
+	return (file_hdr && file_hdr_len >= 4 && get_u32(file_hdr) == ZIP_LOCAL_HDR_SIG);
+}
+
+
+bool jzip::open(const native_char* file_name)
+{
+	assert(file_name && *file_name);
+
+	_entries.clear();
+	_paths.clear();
+	_data = nullptr;
+	_data_size = 0;
+
+	if (!_file.open(file_name) || !open(_file.data(), _file.size())) {
+		_file.close();
+		return false;
+	}
+	return true;
+}
+
+
+bool jzip::open(const unsigned char* data, const size_t size)
+{
+	_entries.clear();
+	_paths.clear();
+	_data = data;
+	_data_size = size;
+
+	if (!data || !read_central_dir()) {
+		_data = nullptr;
+		_data_size = 0;
+		_entries.clear();
+		return false;
+	}
+
+	resolve_releases();
+	return true;
+}
+
+
+ptrdiff_t jzip::find(const string& path) const
+{
+	map<string, size_t>::const_iterator it = _paths.find(path);
+	return it == _paths.end() ? -1 : static_cast<ptrdiff_t>(it->second);
+}
+
+
+bool jzip::extract(const size_t index, vector<unsigned char>& data) const
+{
+	assert(index < _entries.size());
+
+	const entry& e = _entries[index];
+	const unsigned char* arc = _data;
+	const size_t arc_size = _data_size;
+
+	//Locate data by local header (name and extra lengths may differ from central directory),
+	//offsets come from the archive and may be anything up to 2^64
+	if (e.local_offset > arc_size || ZIP_LOCAL_HDR_SIZE > arc_size - e.local_offset || get_u32(arc + e.local_offset) != ZIP_LOCAL_HDR_SIG)
+		return false;
+	const unsigned char* lh = arc + e.local_offset;
+	const uint64_t data_offset = e.local_offset + ZIP_LOCAL_HDR_SIZE + get_u16(lh + 26) + get_u16(lh + 28);
+	if (data_offset > arc_size || e.compressed_size > arc_size - data_offset)
+		return false;
+	if (e.size > static_cast<size_t>(-1) / 2)
+		return false;
+	//Declared size must be reachable from the compressed data, so a corrupted header can't request a huge buffer
+	if (e.method == ZIP_METHOD_STORED ? e.size != e.compressed_size : e.size / ZIP_MAX_DEFLATE_RATIO > e.compressed_size)
+		return false;
+
+	data.resize(static_cast<size_t>(e.size));
+	if (e.size == 0)
+		return true;
+
+	const unsigned char* src = arc + data_offset;
+	const size_t src_len = static_cast<size_t>(e.compressed_size);
+	switch (e.method) {
+		case ZIP_METHOD_STORED:
+			if (src_len != e.size)
+				return false;
+			memcpy(&data.front(), src, src_len);
+			break;
+		case ZIP_METHOD_DEFLATED:
+			if (!inflate(src, src_len, &data.front(), data.size()))
+				return false;
+			break;
+		default:
+			return false;
+	}
+
+	return crc32(&data.front(), data.size()) == e.crc;
+}
+
+
+bool jzip::read_central_dir()
+{
+	const unsigned char* arc = _data;
+	const size_t arc_size = _data_size;
+	if (arc_size < ZIP_EOCD_SIZE)
+		return false;
+
+	//End of central directory record is followed by a comment (up to 64K)
+	size_t eocd = arc_size - ZIP_EOCD_SIZE;
+	const size_t eocd_min = arc_size > ZIP_EOCD_SIZE + 0xffff ? arc_size - ZIP_EOCD_SIZE - 0xffff : 0;
+	while (get_u32(arc + eocd) != ZIP_EOCD_SIG) {
+		if (eocd == eocd_min)
+			return false;
+		--eocd;
+	}
+
+	uint64_t entries_count = get_u16(arc + eocd + 10);
+	uint64_t cd_size = get_u32(arc + eocd + 12);
+	uint64_t cd_offset = get_u32(arc + eocd + 16);
+
+	//Zip64 end of central directory (more than 65535 entries or huge archives)
+	if (eocd >= ZIP64_LOCATOR_SIZE && get_u32(arc + eocd - ZIP64_LOCATOR_SIZE) == ZIP64_LOCATOR_SIG) {
+		const uint64_t eocd64 = get_u64(arc + eocd - ZIP64_LOCATOR_SIZE + 8);
+		if (eocd64 > arc_size || ZIP64_EOCD_SIZE > arc_size - eocd64 || get_u32(arc + eocd64) != ZIP64_EOCD_SIG)
+			return false;
+		entries_count = get_u64(arc + eocd64 + 32);
+		cd_size = get_u64(arc + eocd64 + 40);
+		cd_offset = get_u64(arc + eocd64 + 48);
+	}
+
+	if (cd_offset > arc_size || cd_size > arc_size - cd_offset)
+		return false;
+	if (entries_count > cd_size / ZIP_CENTRAL_HDR_SIZE)
+		return false;
+
+	_entries.reserve(static_cast<size_t>(entries_count));
+
+	const unsigned char* cd = arc + cd_offset;
+	const unsigned char* cd_end = cd + cd_size;
+	for (uint64_t i = 0; i < entries_count; ++i) {
+		if (cd + ZIP_CENTRAL_HDR_SIZE > cd_end || get_u32(cd) != ZIP_CENTRAL_HDR_SIG)
+			return false;
+		const uint16_t name_len = get_u16(cd + 28);
+		const uint16_t extra_len = get_u16(cd + 30);
+		const uint16_t comment_len = get_u16(cd + 32);
+		const unsigned char* name = cd + ZIP_CENTRAL_HDR_SIZE;
+		const unsigned char* extra = name + name_len;
+		const unsigned char* next = extra + extra_len + comment_len;
+		if (next > cd_end)
+			return false;
+
+		entry e;
+		e.name.assign(reinterpret_cast<const char*>(name), name_len);
+		e.release = 0;
+		e.shadowed = false;
+		e.method = get_u16(cd + 10);
+		e.crc = get_u32(cd + 16);
+		e.compressed_size = get_u32(cd + 20);
+		e.size = get_u32(cd + 24);
+		e.local_offset = get_u32(cd + 42);
+
+		//Zip64 extended information: 64-bit values follow in fixed order for saturated fields only
+		const unsigned char* ext = extra;
+		while (ext + 4 <= extra + extra_len) {
+			const uint16_t id = get_u16(ext);
+			const uint16_t len = get_u16(ext + 2);
+			const unsigned char* val = ext + 4;
+			const unsigned char* val_end = val + len;
+			if (val_end > extra + extra_len)
+				break;
+			if (id == ZIP64_EXTRA_ID) {
+				if (e.size == 0xffffffff && val + 8 <= val_end)				{ e.size = get_u64(val); val += 8; }
+				if (e.compressed_size == 0xffffffff && val + 8 <= val_end)	{ e.compressed_size = get_u64(val); val += 8; }
+				if (e.local_offset == 0xffffffff && val + 8 <= val_end)		{ e.local_offset = get_u64(val); val += 8; }
+				break;
+			}
+			ext = val_end;
+		}
+
+		_entries.push_back(e);
+		cd = next;
+	}
+
+	return true;
+}
+
+
+void jzip::resolve_releases()
+{
+	const size_t prefix_len = strlen(MR_PREFIX);
+
+	for (size_t i = 0; i < _entries.size(); ++i) {
+		entry& e = _entries[i];
+		e.path = e.name;
+
+		//Multi-release entry: META-INF/versions/<N>/<path>
+		if (e.name.compare(0, prefix_len, MR_PREFIX) == 0) {
+			const size_t ver_end = e.name.find('/', prefix_len);
+			if (ver_end != string::npos && ver_end > prefix_len && ver_end + 1 < e.name.length()) {
+				const string ver = e.name.substr(prefix_len, ver_end - prefix_len);
+				if (ver.find_first_not_of("0123456789") == string::npos && ver.length() < 5) {
+					e.release = static_cast<uint16_t>(atoi(ver.c_str()));
+					e.path = e.name.substr(ver_end + 1);
+				}
+			}
+		}
+
+		pair<map<string, size_t>::iterator, bool> ins = _paths.insert(make_pair(e.path, i));
+		if (!ins.second) {
+			entry& prev = _entries[ins.first->second];
+			if (prev.release < e.release) {
+				prev.shadowed = true;
+				ins.first->second = i;
+			}
+			else
+				e.shadowed = true;
+		}
+	}
+}
+
+
+uint32_t jzip::crc32(const unsigned char* data, const size_t len)
+{
+	struct crc_table {
+		crc_table()
+		{
+			for (uint32_t i = 0; i < 256; ++i) {
+				uint32_t c = i;
+				for (int k = 0; k < 8; ++k)
+					c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+				val[i] = c;
+			}
+		}
+		uint32_t val[256];
+	};
+	static const crc_table table;
+
+	uint32_t crc = 0xffffffff;
+	for (size_t i = 0; i < len; ++i)
+		crc = table.val[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return crc ^ 0xffffffff;
+}
+
+
+//! Length and distance codes (RFC 1951, 3.2.5)
+static const short len_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const short len_ext[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const short dist_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const short dist_ext[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+
+/**
+ * Inflate (RFC 1951) decoder state.
+ */
+class inflater
+{
+public:
+	inflater(const unsigned char* src, const size_t src_len, unsigned char* dst, const size_t dst_len)
+	:	_src(src), _src_len(src_len), _src_pos(0), _bit_buf(0), _bit_cnt(0),
+		_dst(dst), _dst_len(dst_len), _dst_pos(0)
+	{
+	}
+
+	/**
+	 * Inflate all blocks.
+	 * \return false if error
+	 */
+	bool run()
+	{
+		bool last = false;
+		while (!last) {
+			int val;
+			if (!bits(1, val))
+				return false;
+			last = (val != 0);
+			int type;
+			if (!bits(2, type))
+				return false;
+			bool rc = false;
+			switch (type) {
+				case 0: rc = stored(); break;
+				case 1: rc = fixed(); break;
+				case 2: rc = dynamic(); break;
+			}
+			if (!rc)
+				return false;
+		}
+		return _dst_pos == _dst_len;
+	}
+
+private:
+	//! Huffman decoding table (canonical code, counts and symbols)
+	struct huffman {
+		short count[16];
+		short symbol[288];
+	};
+
+	bool bits(const int need, int& val)
+	{
+		while (_bit_cnt < need) {
+			if (_src_pos >= _src_len)
+				return false;
+			_bit_buf |= static_cast<unsigned int>(_src[_src_pos++]) << _bit_cnt;
+			_bit_cnt += 8;
+		}
+		val = static_cast<int>(_bit_buf & ((1u << need) - 1));
+		_bit_buf >>= need;
+		_bit_cnt -= need;
+		return true;
+	}
+
+	bool stored()
+	{
+		_bit_buf = 0;
+		_bit_cnt = 0;
+		if (_src_pos + 4 > _src_len)
+			return false;
+		const unsigned int len = _src[_src_pos] | (_src[_src_pos + 1] << 8);
+		const unsigned int nlen = _src[_src_pos + 2] | (_src[_src_pos + 3] << 8);
+		_src_pos += 4;
+		if (len != (~nlen & 0xffff) || _src_pos + len > _src_len || _dst_pos + len > _dst_len)
+			return false;
+		memcpy(_dst + _dst_pos, _src + _src_pos, len);
+		_src_pos += len;
+		_dst_pos += len;
+		return true;
+	}
+
+	static bool build(huffman& h, const short* length, const int n)
+	{
+		for (int i = 0; i < 16; ++i)
+			h.count[i] = 0;
+		for (int i = 0; i < n; ++i)
+			h.count[length[i]]++;
+		if (h.count[0] == n)
+			return true;
+		int left = 1;
+		for (int i = 1; i < 16; ++i) {
+			left <<= 1;
+			left -= h.count[i];
+			if (left < 0)
+				return false;
+		}
+		short offs[16];
+		offs[1] = 0;
+		for (int i = 1; i < 15; ++i)
+			offs[i + 1] = offs[i] + h.count[i];
+		for (int i = 0; i < n; ++i) {
+			if (length[i])
+				h.symbol[offs[length[i]]++] = static_cast<short>(i);
+		}
+		return true;
+	}
+
+	bool decode(const huffman& h, int& sym)
+	{
+		int code = 0, first = 0, index = 0;
+		for (int len = 1; len < 16; ++len) {
+			int b;
+			if (!bits(1, b))
+				return false;
+			code |= b;
+			const int count = h.count[len];
+			if (code - count < first) {
+				sym = h.symbol[index + (code - first)];
+				return true;
+			}
+			index += count;
+			first += count;
+			first <<= 1;
+			code <<= 1;
+		}
+		return false;
+	}
+
+	bool codes(const huffman& lencode, const huffman& distcode)
+	{
+		for (;;) {
+			int sym;
+			if (!decode(lencode, sym))
+				return false;
+			if (sym < 256) {
+				if (_dst_pos >= _dst_len)
+					return false;
+				_dst[_dst_pos++] = static_cast<unsigned char>(sym);
+			}
+			else if (sym == 256)
+				return true;
+			else {
+				sym -= 257;
+				if (sym >= 29)
+					return false;
+				int ext;
+				if (!bits(len_ext[sym], ext))
+					return false;
+				const size_t len = len_base[sym] + ext;
+				int dsym;
+				if (!decode(distcode, dsym) || dsym >= 30)
+					return false;
+				if (!bits(dist_ext[dsym], ext))
+					return false;
+				const size_t dist = dist_base[dsym] + ext;
+				if (dist > _dst_pos || _dst_pos + len > _dst_len)
+					return false;
+				for (size_t i = 0; i < len; ++i, ++_dst_pos)
+					_dst[_dst_pos] = _dst[_dst_pos - dist];
+			}
+		}
+	}
+
+	bool fixed()
+	{
+		struct fixed_tables {
+			fixed_tables()
+			{
+				short lengths[288];
+				int i = 0;
+				for (; i < 144; ++i) lengths[i] = 8;
+				for (; i < 256; ++i) lengths[i] = 9;
+				for (; i < 280; ++i) lengths[i] = 7;
+				for (; i < 288; ++i) lengths[i] = 8;
+				build(lencode, lengths, 288);
+				for (i = 0; i < 30; ++i)
+					lengths[i] = 5;
+				build(distcode, lengths, 30);
+			}
+			huffman lencode;
+			huffman distcode;
+		};
+		static const fixed_tables tables;
+		return codes(tables.lencode, tables.distcode);
+	}
+
+	bool dynamic()
+	{
+		static const short order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		int nlen, ndist, ncode;
+		if (!bits(5, nlen) || !bits(5, ndist) || !bits(4, ncode))
+			return false;
+		nlen += 257;
+		ndist += 1;
+		ncode += 4;
+		if (nlen > 286 || ndist > 30)
+			return false;
+
+		short lengths[320];
+		int i = 0;
+		for (; i < ncode; ++i) {
+			int v;
+			if (!bits(3, v))
+				return false;
+			lengths[order[i]] = static_cast<short>(v);
+		}
+		for (; i < 19; ++i)
+			lengths[order[i]] = 0;
+
+		huffman lencode, distcode;
+		if (!build(lencode, lengths, 19))
+			return false;
+
+		i = 0;
+		while (i < nlen + ndist) {
+			int sym;
+			if (!decode(lencode, sym))
+				return false;
+			if (sym < 16)
+				lengths[i++] = static_cast<short>(sym);
+			else {
+				short len = 0;
+				int rep;
+				if (sym == 16) {
+					if (i == 0 || !bits(2, rep))
+						return false;
+					len = lengths[i - 1];
+					rep += 3;
+				}
+				else if (sym == 17) {
+					if (!bits(3, rep))
+						return false;
+					rep += 3;
+				}
+				else {
+					if (!bits(7, rep))
+						return false;
+					rep += 11;
+				}
+				if (i + rep > nlen + ndist)
+					return false;
+				while (rep--)
+					lengths[i++] = len;
+			}
+		}
+		if (lengths[256] == 0)
+			return false;
+
+		if (!build(lencode, lengths, nlen) || !build(distcode, lengths + nlen, ndist))
+			return false;
+		return codes(lencode, distcode);
+	}
+
+private:
+	const unsigned char*	_src;		///< Compressed data
+	size_t					_src_len;	///< Compressed data size
+	size_t					_src_pos;	///< Current position in compressed data
+	unsigned int			_bit_buf;	///< Bit buffer
+	int						_bit_cnt;	///< Number of bits in bit buffer
+	unsigned char*			_dst;		///< Output buffer
+	size_t					_dst_len;	///< Output buffer size
+	size_t					_dst_pos;	///< Current position in output buffer
+};
+
+
+bool jzip::inflate(const unsigned char* src, const size_t src_len, unsigned char* dst, const size_t dst_len)
+{
+	inflater inf(src, src_len, dst, dst_len);
+	return inf.run();
+}
+
+
+//Deflate encoder parameters
+#define DEFLATE_WINDOW		32768		//Maximum match distance
+#define DEFLATE_HASH_SIZE	32768		//Hash table size (power of 2)
+#define DEFLATE_MAX_CHAIN	128			//Maximum number of match candidates to check
+#define DEFLATE_NO_POS		0xffffffff	//Empty hash slot
+
+/**
+ * Deflate (RFC 1951) encoder: LZ77 with hash chains, one block with fixed Huffman codes.
+ */
+class deflater
+{
+public:
+	deflater(vector<unsigned char>& dst)
+	:	_dst(dst), _bit_buf(0), _bit_cnt(0)
+	{
+	}
+
+	/**
+	 * Compress data.
+	 * \param src source data
+	 * \param len source data size
+	 */
+	void run(const unsigned char* src, const size_t len)
+	{
+		put_bits(1, 1);		//Last block
+		put_bits(1, 2);		//Fixed Huffman codes
+
+		vector<uint32_t> head(DEFLATE_HASH_SIZE, DEFLATE_NO_POS);
+		vector<uint32_t> prev(DEFLATE_WINDOW, DEFLATE_NO_POS);
+
+		size_t pos = 0;
+		while (pos < len) {
+			size_t best_len = 0;
+			size_t best_dist = 0;
+			if (pos + 3 <= len) {
+				const size_t max_len = min<size_t>(258, len - pos);
+				uint32_t cand = head[hash(src + pos)];
+				for (int chain = DEFLATE_MAX_CHAIN; chain && cand != DEFLATE_NO_POS && cand < pos && pos - cand <= DEFLATE_WINDOW; --chain) {
+					size_t l = 0;
+					while (l < max_len && src[cand + l] == src[pos + l])
+						++l;
+					if (l > best_len) {
+						best_len = l;
+						best_dist = pos - cand;
+						if (l == max_len)
+							break;
+					}
+					const uint32_t next = prev[cand & (DEFLATE_WINDOW - 1)];
+					if (next >= cand)
+						break;	//Overwritten by newer position
+					cand = next;
+				}
+			}
+
+			if (best_len >= 3) {
+				put_length(best_len);
+				put_distance(best_dist);
+			}
+			else {
+				best_len = 1;
+				put_symbol(src[pos]);
+			}
+
+			for (const size_t end = pos + best_len; pos < end; ++pos) {
+				if (pos + 3 <= len) {
+					const uint32_t h = hash(src + pos);
+					prev[pos & (DEFLATE_WINDOW - 1)] = head[h];
+					head[h] = static_cast<uint32_t>(pos);
+				}
+			}
+		}
+
+		put_symbol(256);
+		if (_bit_cnt)
+			_dst.push_back(static_cast<unsigned char>(_bit_buf));
+	}
+
+private:
+	static uint32_t hash(const unsigned char* p)
+	{
+		return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (DEFLATE_HASH_SIZE - 1);
+	}
+
+	void put_bits(const unsigned int val, const int count)
+	{
+		_bit_buf |= val << _bit_cnt;
+		_bit_cnt += count;
+		while (_bit_cnt >= 8) {
+			_dst.push_back(static_cast<unsigned char>(_bit_buf));
+			_bit_buf >>= 8;
+			_bit_cnt -= 8;
+		}
+	}
+
+	//! Huffman codes are stored starting from the most significant bit
+	void put_code(const unsigned int code, const int count)
+	{
+		unsigned int rev = 0;
+		for (int i = 0; i < count; ++i)
+			rev |= ((code >> i) & 1) << (count - 1 - i);
+		put_bits(rev, count);
+	}
+
+	void put_symbol(const int sym)
+	{
+		if (sym < 144)
+			put_code(0x30 + sym, 8);
+		else if (sym < 256)
+			put_code(0x190 + sym - 144, 9);
+		else if (sym < 280)
+			put_code(sym - 256, 7);
+		else
+			put_code(0xc0 + sym - 280, 8);
+	}
+
+	void put_length(const size_t len)
+	{
+		int i = 28;
+		while (len_base[i] > static_cast<int>(len))
+			--i;
+		put_symbol(257 + i);
+		put_bits(static_cast<unsigned int>(len - len_base[i]), len_ext[i]);
+	}
+
+	void put_distance(const size_t dist)
+	{
+		int i = 29;
+		while (dist_base[i] > static_cast<int>(dist))
+			--i;
+		put_code(i, 5);
+		put_bits(static_cast<unsigned int>(dist - dist_base[i]), dist_ext[i]);
+	}
+
+private:
+	vector<unsigned char>&	_dst;		///< Output buffer
+	unsigned int			_bit_buf;	///< Bit buffer
+	int						_bit_cnt;	///< Number of bits in bit buffer
+};
+
+
+void jzip::deflate(const unsigned char* src, const size_t src_len, vector<unsigned char>& dst)
+{
+	dst.clear();
+	dst.reserve(src_len / 2 + 16);
+	deflater def(dst);
+	def.run(src, src_len);
+}
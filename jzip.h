@@ -0,0 +1,138 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#include "common.h"
+#include "mapped_file.h"
+
+
+class jzip
+{
+public:
+	jzip() : _data(nullptr), _data_size(0) {}
+
+	//! Archive entry description (from the central directory).
+	struct entry {
+		string		name;				///< Full entry name (UTF-8)
+		string		path;				///< Logical path (without multi-release prefix)
+		uint16_t	release;			///< Java release for multi-release entries (0 for base entries)
+		bool		shadowed;			///< Entry is overridden by a multi-release entry
+		uint16_t	method;				///< Compression method
+		uint32_t	crc;				///< CRC32 of uncompressed data
+		uint64_t	compressed_size;	///< Compressed data size
+		uint64_t	size;				///< Uncompressed data size
+		uint64_t	local_offset;		///< Local header offset
+
+		/**
+		 * Check for directory entry.
+		 * \return true if entry is a directory
+		 */
+		bool is_dir() const { return !name.empty() && name[name.length() - 1] == '/'; }
+	};
+
+	/**
+	 * Check for zip (jar) format of file.
+	 * \param file_hdr file header data pointer
+	 * \param file_hdr_len file header data length
+	 * \return true if it is zip format
+	 */
+	static bool format_supported(const unsigned char* file_hdr, const size_t file_hdr_len);
+
+	/**
+	 * Open archive and read its central directory.
+	 * \param file_name archive file name
+	 * \return false if error
+	 */
+	bool open(const native_char* file_name);
+
+	/**
+	 * Open archive in memory and read its central directory.
+	 * \param data archive data (must be kept until the archive is closed or reopened)
+	 * \param size archive data size
+	 * \return false if error
+	 */
+	bool open(const unsigned char* data, const size_t size);
+
+	/**
+	 * Get archive entries.
+	 * \return entries array
+	 */
+	const vector<entry>& entries() const { return _entries; }
+
+	/**
+	 * Find entry by logical path (the highest release wins for multi-release jars).
+	 * \param path logical entry path
+	 * \return entry index (-1 if not found)
+	 */
+	ptrdiff_t find(const string& path) const;
+
+	/**
+	 * Extract (inflate) entry data.
+	 * \param index entry index
+	 * \param data output data
+	 * \return false if error
+	 */
+	bool extract(const size_t index, vector<unsigned char>& data) const;
+
+	/**
+	 * Inflate (RFC 1951) data.
+	 * \param src compressed data
+	 * \param src_len compressed data size
+	 * \param dst output buffer
+	 * \param dst_len output buffer size (expected uncompressed size)
+	 * \return false if error
+	 */
+	static bool inflate(const unsigned char* src, const size_t src_len, unsigned char* dst, const size_t dst_len);
+
+	/**
+	 * Calculate CRC32.
+	 * \param data source data
+	 * \param len source data size
+	 * \return CRC32
+	 */
+	static uint32_t crc32(const unsigned char* data, const size_t len);
+
+	/**
+	 * Deflate (RFC 1951) data.
+	 * \param src source data
+	 * \param src_len source data size
+	 * \param dst compressed data
+	 */
+	static void deflate(const unsigned char* src, const size_t src_len, vector<unsigned char>& dst);
+
+private:
+	/**
+	 * Read central directory.
+	 * \return false if error
+	 */
+	bool read_central_dir();
+
+	/**
+	 * Resolve logical paths of multi-release entries.
+	 */
+	void resolve_releases();
+
+private:
+	mapped_file				_file;		///< Mapped archive file
+	const unsigned char*	_data;		///< Archive content (mapped view or caller buffer)
+	size_t					_data_size;	///< Archive content size
+	vector<entry>			_entries;	///< Archive entries
+	map<string, size_t>		_paths;		///< Logical path to entry index map
+};
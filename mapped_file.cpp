@@ -0,0 +1,134 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include "mapped_file.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+mapped_file::mapped_file()
+#ifdef _WIN32
+:	_file(INVALID_HANDLE_VALUE),
+	_mapping(nullptr),
+#else
+:	_file(-1),
+#endif
+	_data(nullptr),
+	_size(0)
+{
+}
+
+
+mapped_file::~mapped_file()
+{
+	close();
+}
+
+
+#ifdef _WIN32
+bool mapped_file::open(const native_char* file_name)
+{
+	close();
+
+	_file = CreateFile(file_name, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(_file, &file_size) || file_size.QuadPart == 0 || static_cast<unsigned long long>(file_size.QuadPart) > static_cast<size_t>(-1)) {
+		close();
+		return false;
+	}
+
+	_mapping = CreateFileMapping(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!_mapping) {
+		close();
+		return false;
+	}
+
+	_data = static_cast<const unsigned char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!_data) {
+		close();
+		return false;
+	}
+	_size = static_cast<size_t>(file_size.QuadPart);
+
+	return true;
+}
+
+
+void mapped_file::close()
+{
+	if (_data)
+		UnmapViewOfFile(_data);
+	if (_mapping)
+		CloseHandle(_mapping);
+	if (_file != INVALID_HANDLE_VALUE)
+		CloseHandle(_file);
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = nullptr;
+	_data = nullptr;
+	_size = 0;
+}
+
+#else // _WIN32
+
+bool mapped_file::open(const native_char* file_name)
+{
+	close();
+
+	_file = ::open(file_name, O_RDONLY);
+	if (_file == -1)
+		return false;
+
+	struct stat st;
+	if (fstat(_file, &st) != 0 || st.st_size == 0 || static_cast<unsigned long long>(st.st_size) > static_cast<size_t>(-1)) {
+		close();
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, _file, 0);
+	if (view == MAP_FAILED) {
+		close();
+		return false;
+	}
+	_data = static_cast<const unsigned char*>(view);
+	_size = static_cast<size_t>(st.st_size);
+
+	return true;
+}
+
+
+void mapped_file::close()
+{
+	if (_data)
+		munmap(const_cast<unsigned char*>(_data), _size);
+	if (_file != -1)
+		::close(_file);
+	_file = -1;
+	_data = nullptr;
+	_size = 0;
+}
+
+#endif // _WIN32
@@ -0,0 +1,82 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <stddef.h>
+#include <string>
+
+//! Native file name character type
+#ifdef _WIN32
+typedef wchar_t native_char;
+#else
+typedef char native_char;
+#endif
+
+//! Native file name
+typedef std::basic_string<native_char> native_path;
+
+
+class mapped_file
+{
+public:
+	mapped_file();
+	~mapped_file();
+
+	/**
+	 * Map file into memory (read only).
+	 * \param file_name file name
+	 * \return false if error
+	 */
+	bool open(const native_char* file_name);
+
+	/**
+	 * Unmap file and close all handles.
+	 */
+	void close();
+
+	/**
+	 * Get pointer to mapped data.
+	 * \return pointer to the first byte of file (nullptr if file is not mapped)
+	 */
+	const unsigned char* data() const	{ return _data; }
+
+	/**
+	 * Get mapped data size.
+	 * \return file size in bytes
+	 */
+	size_t size() const					{ return _size; }
+
+private:
+	mapped_file(const mapped_file&);
+	mapped_file& operator=(const mapped_file&);
+
+private:
+#ifdef _WIN32
+	HANDLE	_file;					///< File handle
+	HANDLE	_mapping;				///< File mapping handle
+#else
+	int		_file;					///< File descriptor
+#endif
+	const unsigned char*	_data;	///< Mapped view pointer
+	size_t					_size;	///< Mapped view size
+};
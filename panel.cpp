@@ -22,9 +22,17 @@
 #include "settings.h"
 #include "jdecompiler.h"
 #include "version.h"
+#include "jutf8.h"
+#include "jindex.h"
+#include <algorithm>
+#include <thread>
+#include <chrono>
 
+//! Progress report interval of index build (milliseconds)
+#define PANEL_PROGRESS_TIME	200
 
-panel* panel::open(const wchar_t* file_name, const bool silent)
+
+panel* panel::open(const wchar_t* file_name, const bool silent, const unsigned char* data /*= nullptr*/, const size_t data_size /*= 0*/)
 {
 	assert(file_name && file_name[0]);
 
@@ -32,14 +40,22 @@ panel* panel::open(const wchar_t* file_name, const bool silent)
 
 	jclass jc;
 	jclass::jclassinfo jclass_info;
-	if (!jc.read(file_name, jclass_info, instance->_jmembers)) {
+	const bool rc = (data && data_size) ?
+		jc.read(data, data_size, jclass_info, instance->_jmembers) :
+		jc.read(file_name, jclass_info, instance->_jmembers);
+	if (!rc) {
 		delete instance;
 		instance = nullptr;
+		//Not a class file, try to open it as an archive
+		if (!data)
+			return open_archive(file_name, silent);
 	}
 	else {
 		instance->_file_name = file_name;
+		instance->_class_name = jclass_info.name;
 		instance->_title = jclass_info.name;
 		jtformat::as_java_object(instance->_title);
+		instance->start_prefetch();
 	}
 
 	if (!silent && instance == nullptr) {
@@ -51,6 +67,98 @@ panel* panel::open(const wchar_t* file_name, const bool silent)
 }
 
 
+panel* panel::open_archive(const wchar_t* file_name, const bool silent)
+{
+	assert(file_name && file_name[0]);
+
+	panel* instance = new panel();
+	instance->_archive = new jzip();
+	if (!instance->_archive->open(file_name)) {
+		delete instance;
+		if (!silent) {
+			const wchar_t* err_msg[] = { TEXT(PLUGIN_NAME), L"Unable to open file as Java class or archive", file_name };
+			_PSI.Message(&_FPG, &_FPG, FMSG_WARNING | FMSG_MB_OK, nullptr, err_msg, sizeof(err_msg) / sizeof(err_msg[0]), 0);
+		}
+		return nullptr;
+	}
+
+	instance->_file_name = file_name;
+	instance->_title = _FSF.PointToName(file_name);
+
+	//Only the central directory is loaded, build sorted index of visible entries for directory browsing
+	const vector<jzip::entry>& entries = instance->_archive->entries();
+	vector<size_t>& index = instance->_archive_index;
+	index.reserve(entries.size());
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (!entries[i].shadowed && !entries[i].is_dir())
+			index.push_back(i);
+	}
+	sort(index.begin(), index.end(), [&entries](const size_t a, const size_t b) { return entries[a].path < entries[b].path; });
+
+	return instance;
+}
+
+
+panel* panel::open_search(const vector<wstring>& sources)
+{
+	wchar_t pattern[1024];
+	if (!_PSI.InputBox(&_FPG, &_FPG, TEXT(PLUGIN_NAME), L"Search members (part of name or descriptor):", L"JClassInfoSearch", nullptr, pattern, sizeof(pattern) / sizeof(pattern[0]), nullptr, FIB_BUTTONS) || !pattern[0])
+		return nullptr;
+
+	_PSI.AdvControl(&_FPG, ACTL_SETPROGRESSSTATE, TBPF_INDETERMINATE, nullptr);
+
+	jsearch js(pattern);
+	bool cancelled = false;
+	const bool rc = js.run(sources, [&cancelled](const size_t scanned, const size_t found) {
+		if (!cancelled && jdecompiler::esc_pressed())
+			cancelled = true;
+		const wstring state = L"Scanned " + to_wstring(scanned) + L" classes, found " + to_wstring(found) + L" members";
+		const wchar_t* msg[] = { TEXT(PLUGIN_NAME), state.c_str(), cancelled ? L"Cancelling..." : L"Press Esc to cancel" };
+		_PSI.Message(&_FPG, &_FPG, FMSG_NONE, nullptr, msg, sizeof(msg) / sizeof(msg[0]), 0);
+		return !cancelled;
+	});
+
+	_PSI.AdvControl(&_FPG, ACTL_PROGRESSNOTIFY, 0, nullptr);
+	_PSI.AdvControl(&_FPG, ACTL_SETPROGRESSSTATE, TBPF_NOPROGRESS, nullptr);
+	_PSI.PanelControl(PANEL_ACTIVE, FCTL_REDRAWPANEL, 0, nullptr);
+	_PSI.PanelControl(PANEL_PASSIVE, FCTL_REDRAWPANEL, 0, nullptr);
+
+	if (!rc || js.matches().empty()) {
+		wstring msg = TEXT(PLUGIN_NAME);
+		msg += L'\n';
+		if (!rc)
+			msg += L"Unable to read classes";
+		else {
+			msg += L"No members found in " + to_wstring(js.scanned()) + L" classes";
+			if (cancelled)
+				msg += L"\nCancelled by user";
+		}
+		_PSI.Message(&_FPG, &_FPG, FMSG_ALLINONE | FMSG_MB_OK | (!rc ? FMSG_WARNING : FMSG_NONE), nullptr, reinterpret_cast<const wchar_t* const*>(msg.c_str()), 0, 0);
+		return nullptr;
+	}
+
+	if (js.truncated()) {
+		const wstring state = L"Search stopped after " + to_wstring(js.matches().size()) + L" members";
+		const wchar_t* msg[] = { TEXT(PLUGIN_NAME), state.c_str() };
+		_PSI.Message(&_FPG, &_FPG, FMSG_WARNING | FMSG_MB_OK, nullptr, msg, sizeof(msg) / sizeof(msg[0]), 0);
+	}
+
+	panel* instance = new panel();
+	instance->_search = true;
+	instance->_matches = js.matches();
+	instance->_title = L"Search: ";
+	instance->_title += pattern;
+	return instance;
+}
+
+
+panel::~panel()
+{
+	stop_prefetch();
+	delete _archive;
+}
+
+
 void panel::get_panel_info(OpenPanelInfo& info)
 {
 	//Configure key bar
@@ -59,13 +167,13 @@ void panel::get_panel_info(OpenPanelInfo& info)
 		{ { VK_F4, 0 }, L"Fernfl", L"Fernflower" },
 		{ { VK_F5, 0 }, L"CFR", L"CFR" },
 		{ { VK_F6, 0 }, L"Javap", L"Javap" },
-		{ { VK_F7, 0 }, L"", L"" },
+		{ { VK_F7, 0 }, L"Refs", L"Classes referencing member" },
 		{ { VK_F8, 0 }, L"", L"" },
 		{ { VK_F1, SHIFT_PRESSED }, L"", L"" },
 		{ { VK_F2, SHIFT_PRESSED }, L"", L"" },
-		{ { VK_F3, SHIFT_PRESSED }, L"", L"" },
-		{ { VK_F4, SHIFT_PRESSED }, L"", L"" },
-		{ { VK_F5, SHIFT_PRESSED }, L"", L"" },
+		{ { VK_F3, SHIFT_PRESSED }, L"JAD*", L"Decompile archive with JAD" },
+		{ { VK_F4, SHIFT_PRESSED }, L"Fernf*", L"Decompile archive with Fernflower" },
+		{ { VK_F5, SHIFT_PRESSED }, L"CFR*", L"Decompile archive with CFR" },
 		{ { VK_F6, SHIFT_PRESSED }, L"", L"" },
 		{ { VK_F7, SHIFT_PRESSED }, L"", L"" },
 		{ { VK_F8, SHIFT_PRESSED }, L"", L"" },
@@ -77,6 +185,7 @@ void panel::get_panel_info(OpenPanelInfo& info)
 
 	static KeyBarTitles kbt;
 	static PanelMode panel_modes[10];
+	static PanelMode search_modes[10];
 
 	static bool init = false;
 	if (!init) {
@@ -94,31 +203,57 @@ void panel::get_panel_info(OpenPanelInfo& info)
 			panel_modes[i].StatusColumnWidths = L"0";
 		}
 
+		//Search results: class name is shown next to member, source in status line
+		static const wchar_t* search_titles[] = { L"Member", L"Class" };
+		ZeroMemory(&search_modes, sizeof(search_modes));
+		for (size_t i = 0; i < sizeof(search_modes) / sizeof(search_modes[0]); ++i) {
+			search_modes[i].ColumnTypes =  L"N,C0";
+			search_modes[i].ColumnWidths = L"0,0";
+			search_modes[i].ColumnTitles = search_titles;
+			search_modes[i].StatusColumnTypes =  L"C1";
+			search_modes[i].StatusColumnWidths = L"0";
+		}
+
 		init = true;
 	}
 
 	info.StructSize = sizeof(info);
 	info.PanelTitle = _title.c_str();
-	info.HostFile = _file_name.c_str();
+	info.HostFile = _search ? nullptr : _file_name.c_str();
+	info.CurDir = _cur_dir_name.c_str();
 	info.Flags = OPIF_ADDDOTS | OPIF_DISABLEFILTER | OPIF_DISABLESORTGROUPS | OPIF_SHOWPRESERVECASE;
 	info.StartPanelMode = '0';
 	info.KeyBar = &kbt;
-	info.PanelModesArray = panel_modes;
+	info.PanelModesArray = _search ? search_modes : panel_modes;
 	info.PanelModesNumber = sizeof(panel_modes) / sizeof(panel_modes[0]);
 }
 
 
 void panel::get_panel_list(PluginPanelItem** items, size_t& items_count)
 {
-	items_count = _jmembers.size();
-	*items = new PluginPanelItem[items_count];
-	ZeroMemory(*items, sizeof(PluginPanelItem) * items_count);
+	if (archive_dir_mode()) {
+		get_archive_list(items, items_count);
+		return;
+	}
+	if (_search) {
+		get_search_list(items, items_count);
+		return;
+	}
 
 	jtformat jfmt;
 	jfmt.set_short_type(settings::view_sob);
 	jfmt.set_jo_view(settings::view_as_jo);
 	jfmt.set_access(settings::view_access);
 
+	//Items and all their strings are placed in one block, text size is calculated first
+	items_count = _jmembers.size();
+	size_t text_size = 0;
+	for (vector<jclass::jmember>::const_iterator it = _jmembers.begin(); it != _jmembers.end(); ++it)
+		text_size += jfmt.format(*it, nullptr) + it->name.length() + it->description.length() + 3;
+	const wchar_t** columns;
+	wchar_t* text;
+	*items = alloc_panel_list(items_count, items_count, text_size, columns, text);
+
 	size_t idx = 0;
 	for (vector<jclass::jmember>::const_iterator it = _jmembers.begin(); it != _jmembers.end(); ++it) {
 		PluginPanelItem& item = (*items)[idx];
@@ -129,20 +264,13 @@ void panel::get_panel_list(PluginPanelItem** items, size_t& items_count)
 		item.FileSize = (it->type == jclass::method ? 1 : 0);
 		item.NumberOfLinks = static_cast<DWORD>(idx);
 
-		const wstring descr = jfmt.format(*it);
-		const size_t descr_size = descr.length() + 1;
-		item.FileName = new wchar_t[descr_size];
-		wcscpy_s(const_cast<wchar_t*>(item.FileName), descr_size, descr.c_str());
-
-		const size_t name_size = it->name.length() + 1;
-		item.AlternateFileName = new wchar_t[name_size];
-		wcscpy_s(const_cast<wchar_t*>(item.AlternateFileName), name_size, it->name.c_str());
-
-		wchar_t** custom_column_data = new wchar_t*[1];
-		const size_t cc_size = it->description.length() + 1;
-		custom_column_data[0] = new wchar_t[cc_size];
-		wcscpy_s(custom_column_data[0], cc_size, it->description.c_str());
-		item.CustomColumnData = custom_column_data;
+		item.FileName = text;
+		text += jfmt.format(*it, text) + 1;
+		item.AlternateFileName = text;
+		text = put_text(text, it->name);
+		columns[idx] = text;
+		text = put_text(text, it->description);
+		item.CustomColumnData = &columns[idx];
 		item.CustomColumnNumber = 1;
 
 		++idx;
@@ -154,29 +282,57 @@ void panel::free_panel_list(PluginPanelItem* items, const size_t items_count)
 {
 	assert(items_count == 0 || items);
 
-	for (size_t i = 0; i < items_count; ++i) {
-		PluginPanelItem& item = items[i];
+	//Item strings share the items block
+	delete[] reinterpret_cast<unsigned char*>(items);
+}
 
-		delete[] item.FileName;
-		delete[] item.AlternateFileName;
 
-		for (size_t j = 0; j < item.CustomColumnNumber; ++j)
-			delete[] item.CustomColumnData[j];
-		delete[] item.CustomColumnData;
-	}
+PluginPanelItem* panel::alloc_panel_list(const size_t items_count, const size_t columns_count, const size_t text_size, const wchar_t**& columns, wchar_t*& text)
+{
+	const size_t items_size = sizeof(PluginPanelItem) * items_count;
+	const size_t columns_size = sizeof(const wchar_t*) * columns_count;
+	unsigned char* block = new unsigned char[items_size + columns_size + sizeof(wchar_t) * text_size];
+	ZeroMemory(block, items_size);
+	columns = reinterpret_cast<const wchar_t**>(block + items_size);
+	text = reinterpret_cast<wchar_t*>(block + items_size + columns_size);
+	return reinterpret_cast<PluginPanelItem*>(block);
+}
 
-	delete[] items;
+
+wchar_t* panel::put_text(wchar_t* dst, const wstring& src)
+{
+	wmemcpy(dst, src.c_str(), src.length() + 1);
+	return dst + src.length() + 1;
 }
 
 
 bool panel::handle_keyboard(const KEY_EVENT_RECORD& key_event)
 {
+	if (_archive && key_event.dwControlKeyState == SHIFT_PRESSED && (
+				key_event.wVirtualKeyCode == VK_F3 ||
+				key_event.wVirtualKeyCode == VK_F4 ||
+				key_event.wVirtualKeyCode == VK_F5)) {
+		switch (key_event.wVirtualKeyCode) {
+			case VK_F3: decompile_archive(jdecompiler::jd_jad); break;
+			case VK_F4: decompile_archive(jdecompiler::jd_fernflower); break;
+			case VK_F5: decompile_archive(jdecompiler::jd_cfr); break;
+		}
+		return true;
+	}
+
+	if (archive_dir_mode())
+		return false;
+
+	if (key_event.dwControlKeyState == 0 && key_event.wVirtualKeyCode == VK_F7) {
+		show_referrers();
+		return true;
+	}
+
 	if (key_event.dwControlKeyState == 0 && (
 				key_event.wVirtualKeyCode == VK_F3 ||
 				key_event.wVirtualKeyCode == VK_F4 ||
 				key_event.wVirtualKeyCode == VK_F5 ||
 				key_event.wVirtualKeyCode == VK_F6)) {
-		jdecompiler jd;
 		jdecompiler::decompiler mode = jdecompiler::jd_jad;
 		switch (key_event.wVirtualKeyCode) {
 			case VK_F3: mode = jdecompiler::jd_jad; break;
@@ -185,26 +341,570 @@ bool panel::handle_keyboard(const KEY_EVENT_RECORD& key_event)
 			case VK_F6: mode = jdecompiler::jd_javap; break;
 		}
 
-		if (jd.decompile(_file_name.c_str(), mode)) {
+		//Get currently selected item (member) to determine line number
+		const size_t members_count = _search ? _matches.size() : _jmembers.size();
+		const size_t cur_item = current_member();
+		//Search result is decompiled with its own class
+		if (_search && cur_item == members_count)
+			return true;
+
+		//Decompiler of background job takes its result or attaches to it
+		jdecompiler local_jd;
+		jdecompiler& jd = _prefetch ? *_prefetch : local_jd;
+
+		bool temporary = false;
+		const wstring file_name = _prefetch ? _prefetch_file : (_search ? match_file(_matches[cur_item], temporary) : class_file(temporary));
+		if (file_name.empty())
+			return true;
+
+		//Line numbers are not read with the member list, get it for the selected method only
+		jclass::jmember member;
+		if (cur_item < members_count) {
+			member = _search ? _matches[cur_item].member : _jmembers[cur_item];
+			member.line = first_line(file_name, member);
+		}
+
+		const bool rc = jd.decompile(file_name.c_str(), mode);
+		if (temporary)
+			delete_temp_file(file_name);
+
+		if (rc) {
 			intptr_t line_num = 1;
+			if (cur_item < members_count)
+				line_num = jd.find_line(member);
 
-			//Get currently selected item (member) to determine line number
-			const intptr_t ppi_len = _PSI.PanelControl(PANEL_ACTIVE, FCTL_GETCURRENTPANELITEM, 0, nullptr);
-			if (ppi_len != 0) {
-				vector<unsigned char> buffer(ppi_len);
-				PluginPanelItem* ppi = reinterpret_cast<PluginPanelItem*>(&buffer.front());
-				FarGetPluginPanelItem fgppi;
-				ZeroMemory(&fgppi, sizeof(fgppi));
-				fgppi.StructSize = sizeof(fgppi);
-				fgppi.Size = buffer.size();
-				fgppi.Item = ppi;
-				if (_PSI.PanelControl(PANEL_ACTIVE, FCTL_GETCURRENTPANELITEM, 0, &fgppi) && ppi->NumberOfLinks < _jmembers.size())
-					line_num = jd.find_line(_jmembers[ppi->NumberOfLinks]);
+			wstring title = _title;
+			if (_search) {
+				title = _matches[cur_item].class_name;
+				jtformat::as_java_object(title);
 			}
 
-			_PSI.Editor(jd.source_file(), _title.c_str(), 0, 0, -1, -1, EF_DELETEONCLOSE | EF_DISABLESAVEPOS | EF_DISABLEHISTORY, line_num, 1, CP_REDETECT);
+			const wchar_t* source_file = jd.source_file();
+			if (source_file)
+				_PSI.Editor(source_file, title.c_str(), 0, 0, -1, -1, EF_DELETEONCLOSE | EF_DISABLESAVEPOS | EF_DISABLEHISTORY, line_num, 1, CP_REDETECT);
 		}
 		return true;
 	}
 	return false;
 }
+
+
+bool panel::set_directory(const wchar_t* dir)
+{
+	assert(dir);
+
+	if (!_archive)
+		return false;
+
+	wstring dir_name = dir;
+	replace(dir_name.begin(), dir_name.end(), L'\\', L'/');
+
+	if (dir_name == L"..") {
+		if (_class_entry >= 0) {
+			stop_prefetch();
+			_class_entry = -1;
+			_jmembers.clear();
+			_class_data.clear();
+			_title = _FSF.PointToName(_file_name.c_str());
+		}
+		else if (_cur_dir.empty())
+			return false;
+		const size_t pos = _cur_dir.rfind('/');
+		_cur_dir.erase(pos == string::npos ? 0 : pos);
+	}
+	else if (dir_name == L"/") {
+		stop_prefetch();
+		_class_entry = -1;
+		_jmembers.clear();
+		_class_data.clear();
+		_title = _FSF.PointToName(_file_name.c_str());
+		_cur_dir.clear();
+	}
+	else {
+		if (_class_entry >= 0)
+			return false;
+
+		string path;
+		if (dir_name[0] == L'/')
+			path = w2a(dir_name.substr(1));
+		else {
+			path = _cur_dir;
+			if (!path.empty())
+				path += '/';
+			path += w2a(dir_name);
+		}
+		while (!path.empty() && path[path.length() - 1] == '/')
+			path.erase(path.length() - 1);
+		if (path.empty())
+			return false;
+
+		const vector<jzip::entry>& entries = _archive->entries();
+		const ptrdiff_t idx = _archive->find(path);
+		if (idx >= 0) {
+			//Class entry: inflate and show its members
+			if (!open_entry(static_cast<size_t>(idx)))
+				return false;
+		}
+		else {
+			//Package directory: at least one entry must exist under the path
+			const string prefix = path + '/';
+			const vector<size_t>::const_iterator it = lower_bound(_archive_index.begin(), _archive_index.end(), prefix,
+				[&entries](const size_t i, const string& v) { return entries[i].path < v; });
+			if (it == _archive_index.end() || entries[*it].path.compare(0, prefix.length(), prefix) != 0)
+				return false;
+		}
+		_cur_dir = path;
+	}
+
+	_cur_dir_name = a2w(_cur_dir);
+	replace(_cur_dir_name.begin(), _cur_dir_name.end(), L'/', L'\\');
+
+	//Class file name of archive entry depends on current directory
+	if (_class_entry >= 0 && !_prefetch)
+		start_prefetch();
+	return true;
+}
+
+
+intptr_t panel::compare(const PluginPanelItem& item1, const PluginPanelItem& item2) const
+{
+	//Archive directories are sorted by Far
+	if (archive_dir_mode())
+		return -2;
+	//Search results keep source order
+	if (_search)
+		return static_cast<intptr_t>(item1.NumberOfLinks) - static_cast<intptr_t>(item2.NumberOfLinks);
+	if (item1.FileSize != item2.FileSize)
+		return (static_cast<intptr_t>(item2.FileSize) - static_cast<intptr_t>(item1.FileSize));
+	return wcscmp(item1.AlternateFileName, item2.AlternateFileName);
+}
+
+
+bool panel::open_entry(const size_t index)
+{
+	assert(_archive);
+
+	const jzip::entry& e = _archive->entries()[index];
+	if (e.path.length() < 6 || e.path.compare(e.path.length() - 6, 6, ".class") != 0)
+		return false;
+
+	vector<unsigned char> data;
+	if (!_archive->extract(index, data) || data.empty())
+		return false;
+
+	jclass jc;
+	jclass::jclassinfo jclass_info;
+	vector<jclass::jmember> jmembers;
+	if (!jc.read(&data.front(), data.size(), jclass_info, jmembers))
+		return false;
+
+	_jmembers.swap(jmembers);
+	_class_data.swap(data);
+	_class_entry = static_cast<ptrdiff_t>(index);
+	_class_name = jclass_info.name;
+	_title = jclass_info.name;
+	jtformat::as_java_object(_title);
+	return true;
+}
+
+
+void panel::start_prefetch()
+{
+	if (!settings::prefetch_decompiler || _prefetch)
+		return;
+
+	_prefetch_file = class_file(_prefetch_temporary);
+	if (_prefetch_file.empty())
+		return;
+
+	_prefetch = new jdecompiler();
+	_prefetch->prefetch(_prefetch_file.c_str(), static_cast<jdecompiler::decompiler>(settings::prefetch_decompiler - 1));
+}
+
+
+void panel::stop_prefetch()
+{
+	//Job is cancelled and its output is removed unless it was taken by a keypress
+	delete _prefetch;
+	_prefetch = nullptr;
+	if (_prefetch_temporary)
+		delete_temp_file(_prefetch_file);
+	_prefetch_file.clear();
+	_prefetch_temporary = false;
+}
+
+
+size_t panel::current_member() const
+{
+	const size_t members_count = _search ? _matches.size() : _jmembers.size();
+	const intptr_t ppi_len = _PSI.PanelControl(PANEL_ACTIVE, FCTL_GETCURRENTPANELITEM, 0, nullptr);
+	if (ppi_len == 0)
+		return members_count;
+	vector<unsigned char> buffer(ppi_len);
+	PluginPanelItem* ppi = reinterpret_cast<PluginPanelItem*>(&buffer.front());
+	FarGetPluginPanelItem fgppi;
+	ZeroMemory(&fgppi, sizeof(fgppi));
+	fgppi.StructSize = sizeof(fgppi);
+	fgppi.Size = buffer.size();
+	fgppi.Item = ppi;
+	if (!_PSI.PanelControl(PANEL_ACTIVE, FCTL_GETCURRENTPANELITEM, 0, &fgppi) || ppi->NumberOfLinks >= members_count)
+		return members_count;
+	return ppi->NumberOfLinks;
+}
+
+
+void panel::show_referrers()
+{
+	const size_t cur_item = current_member();
+	if (cur_item >= (_search ? _matches.size() : _jmembers.size()))
+		return;
+
+	//Class path is the archive or the package tree of class file
+	wstring source, owner;
+	const jclass::jmember* member;
+	if (_search) {
+		const jsearch::match& m = _matches[cur_item];
+		owner = m.class_name;
+		source = m.entry.empty() ? package_root(m.source, owner) : m.source;
+		member = &m.member;
+	}
+	else {
+		owner = _class_name;
+		source = _archive ? _file_name : package_root(_file_name, owner);
+		member = &_jmembers[cur_item];
+	}
+
+	//Only new and changed classes are parsed, the index is kept in cache.
+	//Index is built on worker thread, UI thread reports progress and handles Esc
+	_PSI.AdvControl(&_FPG, ACTL_SETPROGRESSSTATE, TBPF_INDETERMINATE, nullptr);
+	jindex index;
+	atomic<bool> cancel(false);
+	atomic<bool> finished(false);
+	bool rc = false;
+	thread worker([&index, &source, &cancel, &finished, &rc]() {
+		rc = index.open(source, 0, &cancel);
+		finished = true;
+	});
+	const ULONGLONG start_time = GetTickCount64();
+	while (!finished) {
+		if (!cancel && jdecompiler::esc_pressed())
+			cancel = true;
+		const wstring state = L"Indexing class references... " + to_wstring((GetTickCount64() - start_time) / 1000) + L" s";
+		const wchar_t* msg[] = { TEXT(PLUGIN_NAME), state.c_str(), source.c_str(), cancel ? L"Cancelling..." : L"Press Esc to cancel" };
+		_PSI.Message(&_FPG, &_FPG, FMSG_NONE, nullptr, msg, sizeof(msg) / sizeof(msg[0]), 0);
+		this_thread::sleep_for(chrono::milliseconds(PANEL_PROGRESS_TIME));
+	}
+	worker.join();
+
+	_PSI.AdvControl(&_FPG, ACTL_PROGRESSNOTIFY, 0, nullptr);
+	_PSI.AdvControl(&_FPG, ACTL_SETPROGRESSSTATE, TBPF_NOPROGRESS, nullptr);
+	_PSI.PanelControl(PANEL_ACTIVE, FCTL_REDRAWPANEL, 0, nullptr);
+	_PSI.PanelControl(PANEL_PASSIVE, FCTL_REDRAWPANEL, 0, nullptr);
+	if (cancel)
+		return;
+	if (!rc) {
+		const wchar_t* err_msg[] = { TEXT(PLUGIN_NAME), L"Unable to read classes from", source.c_str() };
+		_PSI.Message(&_FPG, &_FPG, FMSG_WARNING | FMSG_MB_OK, nullptr, err_msg, sizeof(err_msg) / sizeof(err_msg[0]), 0);
+		return;
+	}
+
+	vector<size_t> classes;
+	index.referrers(owner, *member, classes);
+	wstring title = member->name + L": " + to_wstring(classes.size()) + L" referencing classes";
+	//Number of overriders shows if calls of the method are likely monomorphic
+	if (member->type == jclass::method)
+		title += L", " + to_wstring(index.overriders(owner, *member)) + L" overriders";
+	if (classes.empty()) {
+		const wchar_t* msg[] = { TEXT(PLUGIN_NAME), title.c_str() };
+		_PSI.Message(&_FPG, &_FPG, FMSG_MB_OK, nullptr, msg, sizeof(msg) / sizeof(msg[0]), 0);
+		return;
+	}
+
+	vector<wstring> names(classes.size());
+	vector<FarMenuItem> items(classes.size());
+	for (size_t i = 0; i < classes.size(); ++i) {
+		names[i] = index.classes()[classes[i]].info.name;
+		jtformat::as_java_object(names[i]);
+		ZeroMemory(&items[i], sizeof(items[i]));
+		items[i].Text = names[i].c_str();
+	}
+	const intptr_t sel = _PSI.Menu(&_FPG, &_FPG, -1, -1, 0, FMENU_WRAPMODE, title.c_str(), source.c_str(), nullptr, nullptr, nullptr, &items.front(), items.size());
+
+	//Referencing class of the same archive is opened in panel
+	if (sel >= 0 && _archive && !_search) {
+		const wstring path = L"/" + a2w(index.classes()[classes[static_cast<size_t>(sel)]].path);
+		if (set_directory(L"/") && set_directory(path.c_str())) {
+			_PSI.PanelControl(PANEL_ACTIVE, FCTL_UPDATEPANEL, 0, nullptr);
+			_PSI.PanelControl(PANEL_ACTIVE, FCTL_REDRAWPANEL, 0, nullptr);
+		}
+	}
+}
+
+
+wstring panel::package_root(const wstring& file_name, const wstring& class_name)
+{
+	const size_t dir_pos = file_name.rfind(L'\\');
+	if (dir_pos == wstring::npos)
+		return file_name;
+	const wstring dir = file_name.substr(0, dir_pos);
+
+	//Package directories must match the class name
+	const size_t pkg_pos = class_name.rfind(L'/');
+	if (pkg_pos == wstring::npos)
+		return dir;
+	wstring package = L"\\" + class_name.substr(0, pkg_pos);
+	replace(package.begin(), package.end(), L'/', L'\\');
+	if (dir.length() <= package.length() || lstrcmpi(dir.c_str() + dir.length() - package.length(), package.c_str()) != 0)
+		return dir;
+	return dir.substr(0, dir.length() - package.length());
+}
+
+
+void panel::decompile_archive(const jdecompiler::decompiler jd)
+{
+	assert(_archive);
+
+	//Default output directory is next to the archive
+	wstring out_dir = _file_name;
+	const size_t ext_pos = out_dir.rfind(L'.');
+	if (ext_pos != wstring::npos && ext_pos > out_dir.rfind(L'\\'))
+		out_dir.erase(ext_pos);
+	out_dir += L"-src";
+
+	wchar_t dst_dir[MAX_PATH * 4];
+	if (!_PSI.InputBox(&_FPG, &_FPG, TEXT(PLUGIN_NAME), L"Decompile archive to directory:", L"JClassInfoSrcDir", out_dir.c_str(), dst_dir, sizeof(dst_dir) / sizeof(dst_dir[0]), nullptr, FIB_BUTTONS | FIB_EXPANDENV | FIB_EDITPATH | FIB_NOUSELASTHISTORY) || !dst_dir[0])
+		return;
+
+	jdecompiler decompiler;
+	decompiler.decompile_tree(_file_name.c_str(), dst_dir, jd);
+}
+
+
+void panel::get_archive_list(PluginPanelItem** items, size_t& items_count)
+{
+	assert(_archive);
+
+	const vector<jzip::entry>& entries = _archive->entries();
+	const string prefix = _cur_dir.empty() ? string() : _cur_dir + '/';
+
+	const auto path_less = [&entries](const size_t i, const string& v) { return entries[i].path < v; };
+
+	//Collect direct children of current directory, packages are contiguous in sorted index
+	vector<pair<string, ptrdiff_t> > children;	//Name and entry index (-1 for packages)
+	vector<size_t>::const_iterator it = lower_bound(_archive_index.begin(), _archive_index.end(), prefix, path_less);
+	while (it != _archive_index.end() && entries[*it].path.compare(0, prefix.length(), prefix) == 0) {
+		const string& path = entries[*it].path;
+		const size_t slash = path.find('/', prefix.length());
+		if (slash == string::npos) {
+			children.push_back(make_pair(path.substr(prefix.length()), static_cast<ptrdiff_t>(*it)));
+			++it;
+		}
+		else {
+			children.push_back(make_pair(path.substr(prefix.length(), slash - prefix.length()), -1));
+			//Skip whole package: '0' follows '/' in ASCII
+			it = lower_bound(it, _archive_index.cend(), path.substr(0, slash) + '0', path_less);
+		}
+	}
+
+	//Names are converted before allocation to know the text size
+	vector<wstring> names(children.size());
+	size_t text_size = 0;
+	for (size_t i = 0; i < children.size(); ++i) {
+		names[i] = a2w(children[i].first);
+		text_size += names[i].length() + 1;
+	}
+
+	items_count = children.size();
+	const wchar_t** columns;
+	wchar_t* text;
+	*items = alloc_panel_list(items_count, 0, text_size, columns, text);
+
+	for (size_t i = 0; i < items_count; ++i) {
+		PluginPanelItem& item = (*items)[i];
+		const wstring& name = names[i];
+		const ptrdiff_t idx = children[i].second;
+
+		const bool is_class = idx >= 0 && name.length() > 6 && name.compare(name.length() - 6, 6, L".class") == 0;
+		if (idx < 0 || is_class)
+			item.FileAttributes = FILE_ATTRIBUTE_DIRECTORY;
+		if (idx >= 0) {
+			item.FileSize = entries[idx].size;
+			item.AllocationSize = entries[idx].compressed_size;
+		}
+
+		//Short name is the same string
+		item.FileName = text;
+		item.AlternateFileName = text;
+		text = put_text(text, name);
+	}
+}
+
+
+void panel::get_search_list(PluginPanelItem** items, size_t& items_count)
+{
+	assert(_search);
+
+	jtformat jfmt;
+	jfmt.set_short_type(settings::view_sob);
+	jfmt.set_jo_view(settings::view_as_jo);
+	jfmt.set_access(settings::view_access);
+
+	//Class names and sources are converted before allocation to know the text size
+	items_count = _matches.size();
+	vector<wstring> classes(items_count), sources(items_count);
+	size_t text_size = 0;
+	for (size_t i = 0; i < items_count; ++i) {
+		const jsearch::match& m = _matches[i];
+		classes[i] = m.class_name;
+		if (settings::view_as_jo)
+			jtformat::as_java_object(classes[i]);
+		sources[i] = m.source;
+		if (!m.entry.empty()) {
+			wstring entry = a2w(m.entry);
+			replace(entry.begin(), entry.end(), L'/', L'\\');
+			sources[i] += L'\\' + entry;
+		}
+		text_size += jfmt.format(m.member, nullptr) + m.member.name.length() + classes[i].length() + sources[i].length() + 4;
+	}
+	const wchar_t** columns;
+	wchar_t* text;
+	*items = alloc_panel_list(items_count, items_count * 2, text_size, columns, text);
+
+	for (size_t i = 0; i < items_count; ++i) {
+		PluginPanelItem& item = (*items)[i];
+		const jclass::jmember& member = _matches[i].member;
+
+		if (!jtformat::is_public(member))
+			item.FileAttributes = FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_HIDDEN;
+
+		item.FileSize = (member.type == jclass::method ? 1 : 0);
+		item.NumberOfLinks = static_cast<DWORD>(i);
+
+		item.FileName = text;
+		text += jfmt.format(member, text) + 1;
+		item.AlternateFileName = text;
+		text = put_text(text, member.name);
+		columns[i * 2] = text;
+		text = put_text(text, classes[i]);
+		columns[i * 2 + 1] = text;
+		text = put_text(text, sources[i]);
+		item.CustomColumnData = &columns[i * 2];
+		item.CustomColumnNumber = 2;
+	}
+}
+
+
+wstring panel::class_file(bool& temporary) const
+{
+	temporary = false;
+	if (!_archive)
+		return _file_name;
+
+	//Decompilers work with files, extract class entry into temporary directory
+	const wstring file_name = temp_class_file(_FSF.PointToName(_cur_dir_name.c_str()), _class_data);
+	temporary = !file_name.empty();
+	return file_name;
+}
+
+
+wstring panel::match_file(const jsearch::match& m, bool& temporary)
+{
+	temporary = false;
+	if (m.entry.empty())
+		return m.source;
+
+	jzip archive;
+	vector<unsigned char> data;
+	if (!archive.open(m.source.c_str()))
+		return wstring();
+	const ptrdiff_t idx = archive.find(m.entry);
+	if (idx < 0 || !archive.extract(static_cast<size_t>(idx), data) || data.empty())
+		return wstring();
+
+	const size_t pos = m.entry.rfind('/');
+	const wstring file_name = temp_class_file(a2w(m.entry.substr(pos == string::npos ? 0 : pos + 1)).c_str(), data);
+	temporary = !file_name.empty();
+	return file_name;
+}
+
+
+uint16_t panel::first_line(const wstring& class_file, const jclass::jmember& member)
+{
+	if (member.type != jclass::method)
+		return 0;
+
+	mapped_file file;
+	jclass jc;
+	jclass::jclassinfo jclass_info;
+	if (!file.open(class_file.c_str()) || !jc.read(file.data(), file.size(), jclass_info))
+		return 0;
+
+	for (size_t i = 0; i < jc.methods().size(); ++i) {
+		if (jc.member_name(jclass::method, i) == member.name && jc.member_descriptor(jclass::method, i) == member.description)
+			return jc.first_line(i);
+	}
+	return 0;
+}
+
+
+wstring panel::temp_class_file(const wchar_t* name, const vector<unsigned char>& data)
+{
+	wchar_t tmp_path[MAX_PATH];
+	if (!GetTempPath(MAX_PATH, tmp_path))
+		return wstring();
+	wstring dir_name = tmp_path;
+	if (!dir_name.empty() && dir_name[dir_name.length() - 1] != L'\\')
+		dir_name += L'\\';
+
+	//Every file has its own directory: panels and Far instances may extract classes with the same simple name,
+	//decompilers need the original name
+	static volatile LONG counter = 0;
+	dir_name += L"JClassInfo." + to_wstring(GetCurrentProcessId()) + L'.' + to_wstring(InterlockedIncrement(&counter));
+	if (!CreateDirectory(dir_name.c_str(), nullptr))
+		return wstring();
+	const wstring file_name = dir_name + L'\\' + name;
+
+	HANDLE file = CreateFile(file_name.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		RemoveDirectory(dir_name.c_str());
+		return wstring();
+	}
+	DWORD written = 0;
+	const bool rc = WriteFile(file, &data.front(), static_cast<DWORD>(data.size()), &written, nullptr) && written == data.size();
+	CloseHandle(file);
+	if (!rc) {
+		delete_temp_file(file_name);
+		return wstring();
+	}
+
+	return file_name;
+}
+
+
+void panel::delete_temp_file(const wstring& file_name)
+{
+	DeleteFile(file_name.c_str());
+	const size_t pos = file_name.rfind(L'\\');
+	if (pos != wstring::npos)
+		RemoveDirectory(file_name.substr(0, pos).c_str());
+}
+
+
+wstring panel::a2w(const string& val)
+{
+	wstring wide;
+	jutf8::decode(reinterpret_cast<const unsigned char*>(val.c_str()), val.length(), wide);
+	return wide;
+}
+
+
+string panel::w2a(const wstring& val)
+{
+	string enc;
+	const int req = WideCharToMultiByte(CP_UTF8, 0, val.c_str(), static_cast<int>(val.length()), 0, 0, nullptr, nullptr);
+	if (req) {
+		enc.resize(static_cast<size_t>(req));
+		WideCharToMultiByte(CP_UTF8, 0, val.c_str(), static_cast<int>(val.length()), &enc.front(), req, nullptr, nullptr);
+	}
+	return enc;
+}
@@ -20,21 +20,43 @@
 #pragma once
 
 #include "jclass.h"
+#include "jdecompiler.h"
+#include "jzip.h"
+#include "jsearch.h"
 
 
 class panel
 {
 private:
-	panel() {}
+	panel() : _archive(nullptr), _class_entry(-1), _search(false), _prefetch(nullptr), _prefetch_temporary(false) {}
 
 public:
+	~panel();
+
 	/**
 	 * Open java class file.
 	 * \param file_name java class file name
 	 * \param silent silent mode flag (true to show error message)
+	 * \param data file content if already loaded by caller (nullptr to read file)
+	 * \param data_size file content size
+	 * \return panel instance (nullptr on error)
+	 */
+	static panel* open(const wchar_t* file_name, const bool silent, const unsigned char* data = nullptr, const size_t data_size = 0);
+
+	/**
+	 * Open java archive (jar/zip) file.
+	 * \param file_name archive file name
+	 * \param silent silent mode flag (true to show error message)
 	 * \return panel instance (nullptr on error)
 	 */
-	static panel* open(const wchar_t* file_name, const bool silent);
+	static panel* open_archive(const wchar_t* file_name, const bool silent);
+
+	/**
+	 * Search members in class files, archives and directories (pattern is asked).
+	 * \param sources class files, archives and directories
+	 * \return results panel instance (nullptr if nothing found or cancelled)
+	 */
+	static panel* open_search(const vector<wstring>& sources);
 
 	/**
 	 * Get panel info.
@@ -63,8 +85,171 @@ public:
 	 */
 	bool handle_keyboard(const KEY_EVENT_RECORD& key_event);
 
+	/**
+	 * Set current directory (archive mode only).
+	 * \param dir directory name (or "..", "\\")
+	 * \return false if error
+	 */
+	bool set_directory(const wchar_t* dir);
+
+	/**
+	 * Compare panel items.
+	 * \param item1 first item
+	 * \param item2 second item
+	 * \return compare result (-2 to use Far internal sorting)
+	 */
+	intptr_t compare(const PluginPanelItem& item1, const PluginPanelItem& item2) const;
+
+private:
+	/**
+	 * Open class entry from archive.
+	 * \param index entry index
+	 * \return false if error
+	 */
+	bool open_entry(const size_t index);
+
+	/**
+	 * Start preferred decompiler in background for opened class (if enabled in settings).
+	 */
+	void start_prefetch();
+
+	/**
+	 * Abandon background decompilation and remove its class file.
+	 */
+	void stop_prefetch();
+
+	/**
+	 * Get index of current panel item in members (or search results) list.
+	 * \return item index (list size if there is no current member)
+	 */
+	size_t current_member() const;
+
+	/**
+	 * Show classes that reference current member (the class path is indexed on demand).
+	 */
+	void show_referrers();
+
+	/**
+	 * Get root directory of package tree with class file.
+	 * \param file_name class file name
+	 * \param class_name class name ("a/b/C")
+	 * \return root directory ("x" for "x\\a\\b\\C.class", class file directory if it is not placed in package tree)
+	 */
+	static wstring package_root(const wstring& file_name, const wstring& class_name);
+
+	/**
+	 * Decompile whole archive into source tree (output directory is asked).
+	 * \param jd used decompilator
+	 */
+	void decompile_archive(const jdecompiler::decompiler jd);
+
+	/**
+	 * Allocate panel items list, item strings are stored in the same block.
+	 * \param items_count number of items
+	 * \param columns_count number of custom column pointers
+	 * \param text_size size of all item strings in characters (with last nulls)
+	 * \param columns custom column pointers storage
+	 * \param text strings storage
+	 * \return allocated items (zeroed, released by free_panel_list)
+	 */
+	static PluginPanelItem* alloc_panel_list(const size_t items_count, const size_t columns_count, const size_t text_size, const wchar_t**& columns, wchar_t*& text);
+
+	/**
+	 * Copy string with last null into list strings storage.
+	 * \param dst destination
+	 * \param src source string
+	 * \return position next to copied string
+	 */
+	static wchar_t* put_text(wchar_t* dst, const wstring& src);
+
+	/**
+	 * Get archive directory list.
+	 * \param items far panel items list
+	 * \param items_count number of items
+	 */
+	void get_archive_list(PluginPanelItem** items, size_t& items_count);
+
+	/**
+	 * Get search results list.
+	 * \param items far panel items list
+	 * \param items_count number of items
+	 */
+	void get_search_list(PluginPanelItem** items, size_t& items_count);
+
+	/**
+	 * Get class file name for decompiler (archive entries are extracted to temporary file).
+	 * \param temporary output flag: file must be removed after use
+	 * \return class file name (empty on error)
+	 */
+	wstring class_file(bool& temporary) const;
+
+	/**
+	 * Get class file name of search result for decompiler (archive entries are extracted to temporary file).
+	 * \param m search result
+	 * \param temporary output flag: file must be removed after use
+	 * \return class file name (empty on error)
+	 */
+	static wstring match_file(const jsearch::match& m, bool& temporary);
+
+	/**
+	 * Get first source line of method, the class file is read again to parse its Code attribute.
+	 * \param class_file class file name
+	 * \param member class member
+	 * \return first source line (0 for fields and classes without line numbers)
+	 */
+	static uint16_t first_line(const wstring& class_file, const jclass::jmember& member);
+
+	/**
+	 * Write class data to temporary file in its own temporary directory.
+	 * \param name file name (without path)
+	 * \param data class file content
+	 * \return file name (empty on error)
+	 */
+	static wstring temp_class_file(const wchar_t* name, const vector<unsigned char>& data);
+
+	/**
+	 * Delete temporary class file and its directory.
+	 * \param file_name file name returned by temp_class_file
+	 */
+	static void delete_temp_file(const wstring& file_name);
+
+	/**
+	 * Check for archive directory list mode.
+	 * \return true if panel shows archive directory
+	 */
+	bool archive_dir_mode() const { return _archive && _class_entry < 0; }
+
+	/**
+	 * Convert UTF-8 string to wide string.
+	 * \param val source string
+	 * \return wide string
+	 */
+	static wstring a2w(const string& val);
+
+	/**
+	 * Convert wide string to UTF-8 string.
+	 * \param val source string
+	 * \return UTF-8 string
+	 */
+	static string w2a(const wstring& val);
+
 private:
 	wstring	_title;						///< Panel title
 	wstring	_file_name;					///< Host file name
+	wstring	_class_name;				///< Opened class name
 	vector<jclass::jmember>	_jmembers;	///< Java class members descriptions
+
+	jzip*			_archive;			///< Opened archive (nullptr in class file mode)
+	vector<size_t>	_archive_index;		///< Visible archive entries sorted by logical path
+	string			_cur_dir;			///< Current archive directory (without trailing slash)
+	wstring			_cur_dir_name;		///< Current archive directory for Far (backslash delimited)
+	ptrdiff_t		_class_entry;		///< Opened class entry index in archive (-1 if none)
+	vector<unsigned char>	_class_data;	///< Opened class entry data
+
+	bool					_search;	///< Search results mode flag
+	vector<jsearch::match>	_matches;	///< Search results
+
+	jdecompiler*	_prefetch;				///< Decompiler with background job for opened class (nullptr if none)
+	wstring			_prefetch_file;			///< Class file name used by background job
+	bool			_prefetch_temporary;	///< Background job class file must be removed
 };
@@ -20,11 +20,14 @@
 #include "common.h"
 #include "panel.h"
 #include "jclass.h"
+#include "jzip.h"
 #include "settings.h"
 #include "version.h"
 
 //! Plugin GUID {9963EEF7-260B-4B46-89AA-FB7BC9ABD5CD}
 const GUID _FPG = { 0x9963eef7, 0x260b, 0x4b46, { 0x89, 0xaa, 0xfb, 0x7b, 0xc9, 0xab, 0xd5, 0xcd } };
+//! Search menu item GUID {4B1E2D6A-93C5-4F08-A7D2-5E61C0B8F3A4}
+static const GUID _search_menu_guid = { 0x4b1e2d6a, 0x93c5, 0x4f08, { 0xa7, 0xd2, 0x5e, 0x61, 0xc0, 0xb8, 0xf3, 0xa4 } };
 
 PluginStartupInfo    _PSI;
 FarStandardFunctions _FSF;
@@ -71,9 +74,11 @@ void WINAPI GetPluginInfoW(PluginInfo* info)
 	if (!settings::add_to_panel_menu)
 		info->Flags |= PF_DISABLEPANELS;
 	else {
-		info->PluginMenu.Guids = &_FPG;
-		info->PluginMenu.Strings = menu_strings;
-		info->PluginMenu.Count = sizeof(menu_strings) / sizeof(menu_strings[0]);
+		static const GUID panel_menu_guids[] = { _FPG, _search_menu_guid };
+		static const wchar_t* panel_menu_strings[] = { TEXT(PLUGIN_NAME), TEXT(PLUGIN_NAME) L": search members" };
+		info->PluginMenu.Guids = panel_menu_guids;
+		info->PluginMenu.Strings = panel_menu_strings;
+		info->PluginMenu.Count = sizeof(panel_menu_strings) / sizeof(panel_menu_strings[0]);
 	}
 
 #ifdef _DEBUG
@@ -82,12 +87,73 @@ void WINAPI GetPluginInfoW(PluginInfo* info)
 }
 
 
+/**
+ * Get full name of active panel item.
+ * \param cmd panel command (FCTL_GETPANELITEM or FCTL_GETSELECTEDPANELITEM)
+ * \param index item index
+ * \return full file name (empty on error)
+ */
+static wstring panel_item_path(const FILE_CONTROL_COMMANDS cmd, const size_t index)
+{
+	const intptr_t ppi_len = _PSI.PanelControl(PANEL_ACTIVE, cmd, static_cast<intptr_t>(index), nullptr);
+	if (ppi_len == 0)
+		return wstring();
+	vector<unsigned char> buffer(ppi_len);
+	PluginPanelItem* ppi = reinterpret_cast<PluginPanelItem*>(&buffer.front());
+	FarGetPluginPanelItem fgppi;
+	ZeroMemory(&fgppi, sizeof(fgppi));
+	fgppi.StructSize = sizeof(fgppi);
+	fgppi.Size = buffer.size();
+	fgppi.Item = ppi;
+	if (!_PSI.PanelControl(PANEL_ACTIVE, cmd, static_cast<intptr_t>(index), &fgppi))
+		return wstring();
+	wstring file_name;
+	const size_t file_name_len = _FSF.ConvertPath(CPM_FULL, ppi->FileName, nullptr, 0);
+	if (file_name_len) {
+		file_name.resize(file_name_len);
+		_FSF.ConvertPath(CPM_FULL, ppi->FileName, &file_name[0], file_name_len);
+		file_name.resize(lstrlen(file_name.c_str()));
+	}
+	return file_name;
+}
+
+
+/**
+ * Check for java archive file name extension.
+ * Other zip files (docx, apk e t.c.) are left to archive plugins,
+ * they still can be opened with the plugin menu or command prefix.
+ * \param file_name file name
+ * \return true if file is a java archive
+ */
+static bool java_archive(const wchar_t* file_name)
+{
+	static const wchar_t* java_archive_ext[] = { L".jar", L".war", L".ear" };
+	const size_t len = lstrlen(file_name);
+	for (size_t i = 0; i < sizeof(java_archive_ext) / sizeof(java_archive_ext[0]); ++i) {
+		const size_t ext_len = lstrlen(java_archive_ext[i]);
+		if (len > ext_len && lstrcmpi(file_name + len - ext_len, java_archive_ext[i]) == 0)
+			return true;
+	}
+	return false;
+}
+
+
 HANDLE WINAPI AnalyseW(const AnalyseInfo* info)
 {
 	if (!info || info->StructSize < sizeof(AnalyseInfo) || !info->FileName)
 		return nullptr;
-	if (!jclass::format_supported(static_cast<const unsigned char*>(info->Buffer), info->BufferSize))
+	const unsigned char* buffer = static_cast<const unsigned char*>(info->Buffer);
+	if (jzip::format_supported(buffer, info->BufferSize))
+		return java_archive(info->FileName) ? panel::open_archive(info->FileName, true) : nullptr;
+	if (!jclass::format_supported(buffer, info->BufferSize))
 		return nullptr;
+
+	//Parse the analyse buffer directly if it holds the whole file
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	if (GetFileAttributesEx(info->FileName, GetFileExInfoStandard, &fad) &&
+		fad.nFileSizeHigh == 0 && fad.nFileSizeLow == info->BufferSize)
+		return panel::open(info->FileName, true, buffer, info->BufferSize);
+
 	return panel::open(info->FileName, true);
 }
 
@@ -134,23 +200,27 @@ HANDLE WINAPI OpenW(const OpenInfo* info)
 		pi.StructSize = sizeof(pi);
 		if (!_PSI.PanelControl(PANEL_ACTIVE, FCTL_GETPANELINFO, 0, &pi))
 			return nullptr;
-		const intptr_t ppi_len = _PSI.PanelControl(PANEL_ACTIVE, FCTL_GETPANELITEM, static_cast<intptr_t>(pi.CurrentItem), nullptr);
-		if (ppi_len == 0)
-			return nullptr;
-		vector<unsigned char> buffer(ppi_len);
-		PluginPanelItem* ppi = reinterpret_cast<PluginPanelItem*>(&buffer.front());
-		FarGetPluginPanelItem fgppi;
-		ZeroMemory(&fgppi, sizeof(fgppi));
-		fgppi.StructSize = sizeof(fgppi);
-		fgppi.Size = buffer.size();
-		fgppi.Item = ppi;
-		if (!_PSI.PanelControl(PANEL_ACTIVE, FCTL_GETPANELITEM, static_cast<intptr_t>(pi.CurrentItem), &fgppi))
-			return nullptr;
-		const size_t file_name_len = _FSF.ConvertPath(CPM_FULL, ppi->FileName, nullptr, 0);
-		if (file_name_len) {
-			file_name.resize(file_name_len);
-			_FSF.ConvertPath(CPM_FULL, ppi->FileName, &file_name[0], file_name_len);
+
+		if (info->Guid && IsEqualGUID(*info->Guid, _search_menu_guid)) {
+			//Search in selected files and directories, current directory is used instead of ".."
+			vector<wstring> sources;
+			for (size_t i = 0; i < pi.SelectedItemsNumber; ++i) {
+				const wstring path = panel_item_path(FCTL_GETSELECTEDPANELITEM, i);
+				if (!path.empty() && lstrcmp(_FSF.PointToName(path.c_str()), L"..") != 0)
+					sources.push_back(path);
+			}
+			if (sources.empty()) {
+				wstring cur_dir = panel_item_path(FCTL_GETPANELITEM, static_cast<size_t>(pi.CurrentItem));
+				const size_t pos = cur_dir.rfind(L'\\');
+				if (pos == wstring::npos)
+					return nullptr;
+				cur_dir.erase(pos);
+				sources.push_back(cur_dir);
+			}
+			return panel::open_search(sources);
 		}
+
+		file_name = panel_item_path(FCTL_GETPANELITEM, static_cast<size_t>(pi.CurrentItem));
 	}
 
 	return file_name.empty() ? nullptr : panel::open(file_name.c_str(), false);
@@ -187,6 +257,14 @@ void WINAPI FreeFindDataW(const FreeFindDataInfo* info)
 }
 
 
+intptr_t WINAPI SetDirectoryW(const SetDirectoryInfo* info)
+{
+	if (!info || info->StructSize < sizeof(SetDirectoryInfo) || !info->hPanel || !info->Dir)
+		return 0;
+	return reinterpret_cast<panel*>(info->hPanel)->set_directory(info->Dir) ? 1 : 0;
+}
+
+
 intptr_t WINAPI ProcessPanelInputW(const ProcessPanelInputInfo* info)
 {
 	if (!info || info->StructSize < sizeof(ProcessPanelInputInfo) || info->Rec.EventType != KEY_EVENT || !info->hPanel)
@@ -197,11 +275,9 @@ intptr_t WINAPI ProcessPanelInputW(const ProcessPanelInputInfo* info)
 
 intptr_t WINAPI CompareW(const CompareInfo* info)
 {
-	if (!info || info->StructSize < sizeof(CompareInfo))
+	if (!info || info->StructSize < sizeof(CompareInfo) || !info->hPanel)
 		return -1;
-	if (info->Item1->FileSize != info->Item2->FileSize)
-		return (static_cast<intptr_t>(info->Item2->FileSize) - static_cast<intptr_t>(info->Item1->FileSize));
-	return wcscmp(info->Item1->AlternateFileName, info->Item2->AlternateFileName);
+	return reinterpret_cast<panel*>(info->hPanel)->compare(*info->Item1, *info->Item2);
 }
 
 
@@ -18,6 +18,7 @@
  **************************************************************************/
 
 #include "settings.h"
+#include "jtoolchain.h"
 #include "version.h"
 
 bool settings::view_access = true;
@@ -25,6 +26,10 @@ bool settings::view_as_jo = true;
 bool settings::view_sob = true;
 bool settings::add_to_panel_menu = false;
 wstring settings::cmd_prefix = L"jclassinfo";
+unsigned int settings::source_cache_size = 256;
+unsigned int settings::prefetch_decompiler = 0;
+wstring settings::java_home;
+wstring settings::java_runtimes;
 
 
 #define SAVE_SETTINGS(s, p) s.set(L ## #p, p);
@@ -159,6 +164,10 @@ void settings::load()
 	LOAD_SETTINGS(s, view_sob);
 	LOAD_SETTINGS(s, add_to_panel_menu);
 	LOAD_SETTINGS(s, cmd_prefix);
+	LOAD_SETTINGS(s, source_cache_size);
+	LOAD_SETTINGS(s, prefetch_decompiler);
+	LOAD_SETTINGS(s, java_home);
+	LOAD_SETTINGS(s, java_runtimes);
 }
 
 
@@ -170,6 +179,10 @@ void settings::save()
 	SAVE_SETTINGS(s, view_sob);
 	SAVE_SETTINGS(s, add_to_panel_menu);
 	SAVE_SETTINGS(s, cmd_prefix);
+	SAVE_SETTINGS(s, source_cache_size);
+	SAVE_SETTINGS(s, prefetch_decompiler);
+	SAVE_SETTINGS(s, java_home);
+	SAVE_SETTINGS(s, java_runtimes);
 }
 
 
@@ -177,8 +190,37 @@ bool settings::configure()
 {
 	bool sett_changed = false;
 
-	const FarDialogItem dlg_items[] = {
-		/*  0 */ { DI_DOUBLEBOX, 3, 1, 47, 10, 0, nullptr, nullptr, LIF_NONE, TEXT(PLUGIN_NAME) },
+	const wstring cache_size = to_wstring(source_cache_size);
+
+	FarListItem prefetch_items[] = {
+		{ LIF_NONE, L"Off" },
+		{ LIF_NONE, L"JAD" },
+		{ LIF_NONE, L"Fernflower" },
+		{ LIF_NONE, L"CFR" },
+		{ LIF_NONE, L"Javap" }
+	};
+	const size_t prefetch_count = sizeof(prefetch_items) / sizeof(prefetch_items[0]);
+	prefetch_items[prefetch_decompiler < prefetch_count ? prefetch_decompiler : 0].Flags = LIF_SELECTED;
+	FarList prefetch_list = { sizeof(FarList), prefetch_count, prefetch_items };
+
+	//Installed Java runtimes, the first item is the newest one
+	const vector<jtoolchain::runtime>& runtimes = jtoolchain::runtimes();
+	vector<wstring> java_names(1, L"Newest");
+	for (size_t i = 0; i < runtimes.size(); ++i)
+		java_names.push_back(runtimes[i].version + L"  " + runtimes[i].home);
+	vector<FarListItem> java_items(java_names.size());
+	size_t java_sel = 0;
+	for (size_t i = 0; i < java_items.size(); ++i) {
+		ZeroMemory(&java_items[i], sizeof(java_items[i]));
+		java_items[i].Text = java_names[i].c_str();
+		if (i && !java_home.empty() && _wcsicmp(runtimes[i - 1].home.c_str(), java_home.c_str()) == 0)
+			java_sel = i;
+	}
+	java_items[java_sel].Flags = LIF_SELECTED;
+	FarList java_list = { sizeof(FarList), java_items.size(), &java_items.front() };
+
+	FarDialogItem dlg_items[] = {
+		/*  0 */ { DI_DOUBLEBOX, 3, 1, 47, 13, 0, nullptr, nullptr, LIF_NONE, TEXT(PLUGIN_NAME) },
 		/*  1 */ { DI_CHECKBOX,  5, 2, 45, 2, view_access ? 1 : 0, nullptr, nullptr, LIF_NONE, L"View access modifiers" },
 		/*  2 */ { DI_CHECKBOX,  5, 3, 45, 3, view_as_jo ? 1 : 0, nullptr, nullptr, LIF_NONE, L"Replace slashes to dots" },
 		/*  3 */ { DI_CHECKBOX,  5, 4, 45, 4, view_sob ? 1 : 0, nullptr, nullptr, LIF_NONE, L"Short objects names" },
@@ -186,12 +228,20 @@ bool settings::configure()
 		/*  5 */ { DI_CHECKBOX,  5, 6, 45, 6, add_to_panel_menu ? 1 : 0, nullptr, nullptr, LIF_NONE, L"Add plug-in to the panel plug-in menu" },
 		/*  6 */ { DI_TEXT,      5, 7, 45, 7, 0, nullptr, nullptr, LIF_NONE, L"Plug-in command prefix:" },
 		/*  7 */ { DI_EDIT,     29, 7, 45, 7, 0, nullptr, nullptr, LIF_NONE, cmd_prefix.c_str() },
-		/*  8 */ { DI_TEXT,      0, 8,  0, 8, 0, nullptr, nullptr, DIF_SEPARATOR },
-		/*  9 */ { DI_BUTTON,    0, 9,  0, 9, 0, nullptr, nullptr, DIF_CENTERGROUP | DIF_DEFAULTBUTTON, L"Save" },
-		/* 10 */ { DI_BUTTON,    0, 9,  0, 9, 0, nullptr, nullptr, DIF_CENTERGROUP, L"Cancel" }
+		/*  8 */ { DI_TEXT,      5, 8, 45, 8, 0, nullptr, nullptr, LIF_NONE, L"Decompiled sources cache, MiB:" },
+		/*  9 */ { DI_EDIT,     37, 8, 45, 8, 0, nullptr, nullptr, LIF_NONE, cache_size.c_str() },
+		/* 10 */ { DI_TEXT,      5, 9, 45, 9, 0, nullptr, nullptr, LIF_NONE, L"Decompile on open:" },
+		/* 11 */ { DI_COMBOBOX, 29, 9, 45, 9, 0, nullptr, nullptr, DIF_DROPDOWNLIST, L"" },
+		/* 12 */ { DI_TEXT,      5, 10, 45, 10, 0, nullptr, nullptr, LIF_NONE, L"Java runtime:" },
+		/* 13 */ { DI_COMBOBOX, 19, 10, 45, 10, 0, nullptr, nullptr, DIF_DROPDOWNLIST, L"" },
+		/* 14 */ { DI_TEXT,      0, 11, 0, 11, 0, nullptr, nullptr, DIF_SEPARATOR },
+		/* 15 */ { DI_BUTTON,    0, 12, 0, 12, 0, nullptr, nullptr, DIF_CENTERGROUP | DIF_DEFAULTBUTTON, L"Save" },
+		/* 16 */ { DI_BUTTON,    0, 12, 0, 12, 0, nullptr, nullptr, DIF_CENTERGROUP, L"Cancel" }
 	};
+	dlg_items[11].ListItems = &prefetch_list;
+	dlg_items[13].ListItems = &java_list;
 
-	const HANDLE dlg = _PSI.DialogInit(&_FPG, &_FPG, -1, -1, 51, 12, nullptr, dlg_items, sizeof(dlg_items) / sizeof(dlg_items[0]), 0, FDLG_NONE, nullptr, nullptr);
+	const HANDLE dlg = _PSI.DialogInit(&_FPG, &_FPG, -1, -1, 51, 15, nullptr, dlg_items, sizeof(dlg_items) / sizeof(dlg_items[0]), 0, FDLG_NONE, nullptr, nullptr);
 	const intptr_t rc = _PSI.DialogRun(dlg);
 	sett_changed = (rc >= 0 && rc != sizeof(dlg_items) / sizeof(dlg_items[0]) - 1);
 	if (sett_changed) {
@@ -200,6 +250,10 @@ bool settings::configure()
 		view_sob = _PSI.SendDlgMessage(dlg, DM_GETCHECK, 3, nullptr) != 0;
 		add_to_panel_menu = _PSI.SendDlgMessage(dlg, DM_GETCHECK, 5, nullptr) != 0;
 		cmd_prefix = reinterpret_cast<const wchar_t*>(_PSI.SendDlgMessage(dlg, DM_GETCONSTTEXTPTR, 7, nullptr));
+		source_cache_size = wcstoul(reinterpret_cast<const wchar_t*>(_PSI.SendDlgMessage(dlg, DM_GETCONSTTEXTPTR, 9, nullptr)), nullptr, 10);
+		prefetch_decompiler = static_cast<unsigned int>(_PSI.SendDlgMessage(dlg, DM_LISTGETCURPOS, 11, nullptr));
+		const size_t java_idx = static_cast<size_t>(_PSI.SendDlgMessage(dlg, DM_LISTGETCURPOS, 13, nullptr));
+		java_home = (java_idx && java_idx <= runtimes.size()) ? runtimes[java_idx - 1].home : wstring();
 		save();
 	}
 	_PSI.DialogFree(dlg);
@@ -36,7 +36,6 @@ public:
 	 */
 	static bool configure();
 
-private:
 	/**
 	 * Save settings.
 	 */
@@ -48,4 +47,8 @@ public:
 	static bool view_sob;			///< Short objects names flag
 	static bool add_to_panel_menu;	///< Add plug-in to the panel plug-in menu flag
 	static wstring cmd_prefix;		///< Plug-in command prefix
+	static unsigned int source_cache_size;	///< Decompiled sources cache size limit in MiB (0 to disable)
+	static unsigned int prefetch_decompiler;	///< Decompiler started in background on panel open (jdecompiler::decompiler + 1, 0 to disable)
+	static wstring java_home;		///< Preferred Java home directory (empty for the newest runtime)
+	static wstring java_runtimes;	///< Discovered Java runtimes (see jtoolchain)
 };
@@ -0,0 +1,181 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include "source_cache.h"
+#include "dir_walker.h"
+#include "jzip.h"
+#include <stdio.h>
+#include <algorithm>
+
+//Cache entry format: header and deflated source
+#define SOURCE_MAGIC		0x4352534a	//"JSRC"
+#define SOURCE_VERSION		2
+#define SOURCE_HDR_SIZE		20
+#define SOURCE_EXT			".jsz"
+
+//Maximal source size and deflate compression ratio, larger header values are never allocated
+#define SOURCE_MAX_SIZE		0x4000000
+#define SOURCE_MAX_RATIO	1032
+
+mutex source_cache::_total_lock;
+bool source_cache::_total_known = false;
+uint64_t source_cache::_total = 0;
+
+
+//! Little endian writer/reader for cache entry header
+static void put_u32(vector<unsigned char>& buf, const uint32_t v)
+{
+	for (int i = 0; i < 4; ++i)
+		buf.push_back(static_cast<unsigned char>(v >> (i * 8)));
+}
+static uint32_t get_u32(const unsigned char* p)
+{
+	return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+
+source_cache::source_cache(const uint64_t max_size)
+:	_max_size(max_size)
+{
+	if (_max_size)
+		_dir = dir_walker::cache_dir("sources");
+}
+
+
+string source_cache::key(const unsigned char* data, const size_t size, const string& tool)
+{
+	//FNV-1a of decompiler identity and class bytes, CRC32 and size make collisions practically impossible
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < tool.length(); ++i) {
+		hash ^= static_cast<unsigned char>(tool[i]);
+		hash *= 0x100000001b3ull;
+	}
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= data[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	char key[48];
+	snprintf(key, sizeof(key), "%016llx%08x%08x", static_cast<unsigned long long>(hash), jzip::crc32(data, size), static_cast<uint32_t>(size));
+	return key;
+}
+
+
+bool source_cache::get(const string& key, string& source) const
+{
+	if (_dir.empty())
+		return false;
+
+	const native_path entry_name = entry_file(key);
+	{
+		mapped_file entry;
+		if (!entry.open(entry_name.c_str()) || entry.size() <= SOURCE_HDR_SIZE)
+			return false;
+		const unsigned char* data = entry.data();
+		if (get_u32(data) != SOURCE_MAGIC || get_u32(data + 4) != SOURCE_VERSION)
+			return false;
+
+		//Damaged entry is rejected before the output is allocated
+		const unsigned char* packed = data + SOURCE_HDR_SIZE;
+		const size_t packed_size = entry.size() - SOURCE_HDR_SIZE;
+		const uint32_t size = get_u32(data + 8);
+		if (!size || size > SOURCE_MAX_SIZE || size / SOURCE_MAX_RATIO > packed_size || jzip::crc32(packed, packed_size) != get_u32(data + 16))
+			return false;
+
+		source.resize(size);
+		unsigned char* out = reinterpret_cast<unsigned char*>(&source[0]);
+		if (!jzip::inflate(packed, packed_size, out, source.size()) ||
+			jzip::crc32(out, source.size()) != get_u32(data + 12)) {
+			source.clear();
+			return false;
+		}
+	}
+
+	//Modification time is the last use time for eviction
+	dir_walker::touch(entry_name);
+	return true;
+}
+
+
+bool source_cache::put(const string& key, const string& source) const
+{
+	if (_dir.empty() || source.empty() || source.size() > SOURCE_MAX_SIZE)
+		return false;
+
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(source.data());
+	vector<unsigned char> entry;
+	jzip::deflate(data, source.size(), entry);
+	vector<unsigned char> hdr;
+	put_u32(hdr, SOURCE_MAGIC);
+	put_u32(hdr, SOURCE_VERSION);
+	put_u32(hdr, static_cast<uint32_t>(source.size()));
+	put_u32(hdr, jzip::crc32(data, source.size()));
+	put_u32(hdr, jzip::crc32(&entry.front(), entry.size()));
+	entry.insert(entry.begin(), hdr.begin(), hdr.end());
+
+	if (!dir_walker::replace_file(entry_file(key), &entry.front(), entry.size()))
+		return false;
+
+	//Directory is walked once per session and then only when the running total passes the limit
+	bool walk;
+	{
+		lock_guard<mutex> lock(_total_lock);
+		_total += entry.size();
+		walk = !_total_known || _total > _max_size;
+	}
+	if (walk)
+		evict();
+	return true;
+}
+
+
+native_path source_cache::entry_file(const string& key) const
+{
+	native_path name = _dir;
+#ifdef _WIN32
+	name += L'\\';
+#else
+	name += '/';
+#endif
+	name.append(key.begin(), key.end());
+	name.append(SOURCE_EXT, SOURCE_EXT + sizeof(SOURCE_EXT) - 1);
+	return name;
+}
+
+
+void source_cache::evict() const
+{
+	vector<dir_walker::file> entries;
+	uint64_t total = 0;
+	dir_walker::walk(_dir, SOURCE_EXT, [&entries, &total](const dir_walker::file& f) {
+		entries.push_back(f);
+		total += f.size;
+	});
+	if (total > _max_size) {
+		sort(entries.begin(), entries.end(), [](const dir_walker::file& a, const dir_walker::file& b) { return a.mtime < b.mtime; });
+		for (size_t i = 0; i < entries.size() && total > _max_size; ++i) {
+			if (dir_walker::remove_file(entries[i].full_path))
+				total -= entries[i].size;
+		}
+	}
+
+	lock_guard<mutex> lock(_total_lock);
+	_total = total;
+	_total_known = true;
+}
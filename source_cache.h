@@ -0,0 +1,86 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#include "mapped_file.h"
+#include <stdint.h>
+#include <string>
+#include <mutex>
+
+using namespace std;
+
+
+class source_cache
+{
+public:
+	/**
+	 * Constructor.
+	 * \param max_size cache size limit in bytes (0 to disable cache)
+	 */
+	explicit source_cache(const uint64_t max_size);
+
+	/**
+	 * Build cache key (content address) of decompiled class.
+	 * The same class bytes give the same key wherever the class comes from.
+	 * \param data class file content
+	 * \param size class file content size
+	 * \param tool decompiler identity (name, version and options)
+	 * \return cache key
+	 */
+	static string key(const unsigned char* data, const size_t size, const string& tool);
+
+	/**
+	 * Get decompiled source from cache.
+	 * \param key cache key
+	 * \param source output source
+	 * \return false if source is not cached
+	 */
+	bool get(const string& key, string& source) const;
+
+	/**
+	 * Put decompiled source to cache (least recently used sources are evicted).
+	 * \param key cache key
+	 * \param source decompiled source
+	 * \return false if error
+	 */
+	bool put(const string& key, const string& source) const;
+
+private:
+	/**
+	 * Get cache entry file name.
+	 * \param key cache key
+	 * \return entry file name
+	 */
+	native_path entry_file(const string& key) const;
+
+	/**
+	 * Remove least recently used entries to fit size limit.
+	 * The cache directory is walked and the size total is updated.
+	 */
+	void evict() const;
+
+private:
+	native_path	_dir;		///< Cache directory (empty if cache is disabled)
+	uint64_t	_max_size;	///< Cache size limit in bytes
+
+	static mutex	_total_lock;	///< Size total lock
+	static bool		_total_known;	///< Cache directory was walked in this session
+	static uint64_t	_total;			///< Cache size total (entries put since the walk are added)
+};
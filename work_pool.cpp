@@ -0,0 +1,148 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include "work_pool.h"
+
+
+work_pool::work_pool(const size_t threads /*= 0*/)
+:	_queues(threads ? threads : (thread::hardware_concurrency() ? thread::hardware_concurrency() : 1)),
+	_task(nullptr),
+	_generation(0),
+	_active(0),
+	_stop(false)
+{
+	_threads.reserve(_queues.size());
+	for (size_t i = 0; i < _queues.size(); ++i) {
+		_queues[i].begin = _queues[i].end = 0;
+		_threads.push_back(thread(&work_pool::worker_proc, this, i));
+	}
+}
+
+
+work_pool::~work_pool()
+{
+	{
+		lock_guard<mutex> lock(_lock);
+		_stop = true;
+	}
+	_job_cv.notify_all();
+	for (size_t i = 0; i < _threads.size(); ++i)
+		_threads[i].join();
+}
+
+
+void work_pool::run(const size_t count, const task& fn)
+{
+	if (!count)
+		return;
+
+	unique_lock<mutex> lock(_lock);
+
+	//Initial distribution: contiguous chunks keep neighbour entries on the same worker
+	const size_t workers = _queues.size();
+	for (size_t i = 0; i < workers; ++i) {
+		lock_guard<mutex> qlock(_queues[i].lock);
+		_queues[i].begin = count * i / workers;
+		_queues[i].end = count * (i + 1) / workers;
+	}
+
+	_task = &fn;
+	_active = workers;
+	++_generation;
+	_job_cv.notify_all();
+
+	_done_cv.wait(lock, [this]() { return _active == 0; });
+	_task = nullptr;
+}
+
+
+void work_pool::worker_proc(const size_t worker)
+{
+	size_t generation = 0;
+	for (;;) {
+		const task* fn;
+		{
+			unique_lock<mutex> lock(_lock);
+			_job_cv.wait(lock, [this, generation]() { return _stop || _generation != generation; });
+			if (_stop)
+				return;
+			generation = _generation;
+			fn = _task;
+		}
+
+		size_t index;
+		while (next_item(worker, index))
+			(*fn)(index, worker);
+
+		lock_guard<mutex> lock(_lock);
+		if (--_active == 0)
+			_done_cv.notify_all();
+	}
+}
+
+
+bool work_pool::next_item(const size_t worker, size_t& index)
+{
+	//Own queue
+	{
+		queue& q = _queues[worker];
+		lock_guard<mutex> lock(q.lock);
+		if (q.begin < q.end) {
+			index = q.begin++;
+			return true;
+		}
+	}
+
+	//Steal upper half of the largest remaining range
+	for (;;) {
+		size_t victim = worker;
+		size_t victim_size = 0;
+		for (size_t i = 0; i < _queues.size(); ++i) {
+			if (i == worker)
+				continue;
+			queue& q = _queues[i];
+			lock_guard<mutex> lock(q.lock);
+			if (q.end - q.begin > victim_size) {
+				victim = i;
+				victim_size = q.end - q.begin;
+			}
+		}
+		if (victim == worker)
+			return false;
+
+		size_t steal_begin, steal_end;
+		{
+			queue& q = _queues[victim];
+			lock_guard<mutex> lock(q.lock);
+			if (q.begin >= q.end)
+				continue;	//Drained meanwhile, look again
+			const size_t half = (q.end - q.begin + 1) / 2;
+			steal_end = q.end;
+			steal_begin = q.end - half;
+			q.end = steal_begin;
+		}
+
+		queue& own = _queues[worker];
+		lock_guard<mutex> lock(own.lock);
+		own.begin = steal_begin + 1;
+		own.end = steal_end;
+		index = steal_begin;
+		return true;
+	}
+}
@@ -0,0 +1,99 @@
+/**************************************************************************
+ *  JClassInfo plug-in for FAR 3.0                                        *
+ *  Copyright (C) 2012-2014 by Artem Senichev <artemsen@gmail.com>        *
+ *  https://sourceforge.net/projects/farplugs/                            *
+ *                                                                        *
+ *  This program is free software: you can redistribute it and/or modify  *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  This program is distributed in the hope that it will be useful,       *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+
+class work_pool
+{
+public:
+	//! Task function: item index and worker number (0..size()-1).
+	typedef function<void(size_t index, size_t worker)> task;
+
+	/**
+	 * Constructor: start worker threads.
+	 * \param threads number of workers (0 to use all hardware threads)
+	 */
+	explicit work_pool(const size_t threads = 0);
+
+	/**
+	 * Destructor: stop worker threads.
+	 */
+	~work_pool();
+
+	/**
+	 * Get number of workers.
+	 * \return number of workers
+	 */
+	size_t size() const { return _threads.size(); }
+
+	/**
+	 * Execute task for every index in range [0, count) and wait for completion.
+	 * Every worker starts with its own contiguous part of the range and steals
+	 * the upper half of a busy worker's remaining part when it runs dry.
+	 * \param count number of items
+	 * \param fn task function (must not throw)
+	 */
+	void run(const size_t count, const task& fn);
+
+private:
+	work_pool(const work_pool&);
+	work_pool& operator=(const work_pool&);
+
+	//! Per-worker range of pending items.
+	struct queue {
+		mutex	lock;
+		size_t	begin;
+		size_t	end;
+	};
+
+	/**
+	 * Worker thread function.
+	 * \param worker worker number
+	 */
+	void worker_proc(const size_t worker);
+
+	/**
+	 * Get next item for worker (own queue first, then steal).
+	 * \param worker worker number
+	 * \param index output item index
+	 * \return false if no more items
+	 */
+	bool next_item(const size_t worker, size_t& index);
+
+private:
+	vector<thread>		_threads;		///< Worker threads
+	vector<queue>		_queues;		///< Per-worker item ranges
+	mutex				_lock;			///< Job state lock
+	condition_variable	_job_cv;		///< New job signal
+	condition_variable	_done_cv;		///< Job completion signal
+	const task*			_task;			///< Current task
+	size_t				_generation;	///< Job generation counter
+	size_t				_active;		///< Number of workers busy with current job
+	bool				_stop;			///< Stop flag
+};